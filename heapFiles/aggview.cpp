@@ -0,0 +1,384 @@
+#include <limits.h>
+#include <string.h>
+#include "aggview.h"
+#include "error.h"
+
+// aggregate view implementation
+
+// names of the attributes of a view after the key
+static const char* aggNames[] = { "cnt", "sum", "min", "max" };
+
+// views by base relation.  an entry, once made, stays for the life of
+// the process, so heap files may hold on to it
+static mutex basesMutex;
+static map<string, AggViews*> bases;
+
+AggViews* AggViews::baseOf(const string & relName)
+{
+    AggViews* & entry = bases[relName];
+    if (entry == NULL)
+    {
+        entry = new AggViews;
+        entry->relName = relName;
+        entry->viewCnt = 0;
+    }
+    return entry;
+}
+
+AggViews* AggViews::of(const string & fileName)
+{
+    lock_guard<mutex> lk(basesMutex);
+    return baseOf(fileName);
+}
+
+AggViews* AggViews::find(const string & viewName)
+{
+    vector<AggViews*> all;
+    {
+        lock_guard<mutex> lk(basesMutex);
+        for (map<string, AggViews*>::iterator it = bases.begin(); it != bases.end(); it++)
+            all.push_back(it->second);
+    }
+    for (unsigned i = 0; i < all.size(); i++)
+    {
+        lock_guard<mutex> lk(all[i]->mtx);
+        if (all[i]->indexOf(viewName) >= 0) return all[i];
+    }
+    return NULL;
+}
+
+const int AggViews::indexOf(const string & viewName) const
+{
+    for (unsigned i = 0; i < views.size(); i++)
+        if (views[i]->name == viewName) return i;
+    return -1;
+}
+
+// true if rec holds attribute attr
+static inline bool holds(const Record & rec, const AttrDesc & attr)
+{
+    return rec.length >= attr.attrOffset + attr.attrLen;
+}
+
+// the group key of rec.  keys that a scan filter takes as equal are
+// the same, as in an InSet: STRING up to the first NUL, padded with
+// zeros, and FLOAT -0 as 0
+static inline string keyOf(const Record & rec, const AttrDesc & key)
+{
+    const char* p = (const char*) rec.data + key.attrOffset;
+    if (key.attrType == STRING)
+    {
+        string k(p, strnlen(p, key.attrLen));
+        k.resize(key.attrLen, '\0');
+        return k;
+    }
+    if (key.attrType == FLOAT)
+    {
+        float f;
+        memcpy(&f, p, sizeof f);
+        if (f == 0) return string(key.attrLen, '\0');
+    }
+    return string(p, key.attrLen);
+}
+
+static inline double valueOf(const Record & rec, const AttrDesc & val)
+{
+    const char* p = (const char*) rec.data + val.attrOffset;
+    if (val.attrType == INTEGER)
+    {
+        int i;
+        memcpy(&i, p, sizeof i);
+        return i;
+    }
+    float f;
+    memcpy(&f, p, sizeof f);
+    return f;
+}
+
+// store v as an attribute of type type at p
+static inline void putValue(char* p, const int type, const double v)
+{
+    if (type == INTEGER)
+    {
+        int i = (int) v;
+        memcpy(p, &i, sizeof i);
+    }
+    else
+    {
+        float f = (float) v;
+        memcpy(p, &f, sizeof f);
+    }
+}
+
+// add a value to the aggregates of a group
+static inline void addValue(AggView* view, const string & key, const double v)
+{
+    map<string, AggGroup>::iterator it = view->groups.find(key);
+    if (it == view->groups.end())
+    {
+        AggGroup g;
+        g.count = 1;
+        g.sum = g.min = g.max = v;
+        g.stale = false;
+        view->groups[key] = g;
+        return;
+    }
+    AggGroup & g = it->second;
+    g.count++;
+    g.sum += v;
+    if (v < g.min) g.min = v;
+    if (v > g.max) g.max = v;
+}
+
+
+// A record was inserted into the base relation.
+
+void AggViews::inserted(const Record & rec)
+{
+    if (!any()) return;
+    lock_guard<mutex> lk(mtx);
+    for (unsigned i = 0; i < views.size(); i++)
+    {
+        AggView* view = views[i];
+        if (!holds(rec, view->key) || !holds(rec, view->val)) continue;
+        addValue(view, keyOf(rec, view->key), valueOf(rec, view->val));
+        view->dirty = true;
+    }
+}
+
+// A record is about to be deleted from the base relation.  A group
+// that loses its minimum or maximum gets them back at the next refresh.
+
+void AggViews::deleted(const Record & rec)
+{
+    if (!any()) return;
+    lock_guard<mutex> lk(mtx);
+    for (unsigned i = 0; i < views.size(); i++)
+    {
+        AggView* view = views[i];
+        if (!holds(rec, view->key) || !holds(rec, view->val)) continue;
+
+        // a record the view never saw, inserted while the view was
+        // being built, may have no group
+        map<string, AggGroup>::iterator it = view->groups.find(keyOf(rec, view->key));
+        if (it == view->groups.end()) continue;
+
+        AggGroup & g = it->second;
+        double v = valueOf(rec, view->val);
+        view->dirty = true;
+        if (--g.count == 0)
+        {
+            if (g.stale) view->staleCnt--;
+            view->groups.erase(it);
+            continue;
+        }
+        g.sum -= v;
+        if (!g.stale && (v <= g.min || v >= g.max))
+        {
+            g.stale = true;
+            view->staleCnt++;
+        }
+    }
+}
+
+
+// Create a view: check the attributes, compute the groups with one
+// scan of the base relation and create the view relation.
+
+const Status createAggView(const string & viewName,
+                           const string & relName,
+                           const string & keyAttr,
+                           const string & valAttr)
+{
+    Status status, scanStatus;
+    AttrDesc attrs[5];
+    RID rid;
+    Record rec;
+
+    if (relCat == NULL) return BADCATPARM;
+
+    AggView* view = new AggView;
+    view->name = viewName;
+    view->dirty = true;
+    view->staleCnt = 0;
+    if ((status = relCat->getAttrInfo(relName, keyAttr, view->key)) != OK ||
+        (status = relCat->getAttrInfo(relName, valAttr, view->val)) != OK)
+    {
+        delete view;
+        return status;
+    }
+    if (view->val.attrType != INTEGER && view->val.attrType != FLOAT)
+    {
+        delete view;
+        return ATTRTYPEMISMATCH;
+    }
+
+    // key, then the aggregates in the type of the value
+    memset(attrs, 0, sizeof attrs);
+    attrs[0] = view->key;
+    for (int i = 1; i < 5; i++)
+    {
+        strcpy(attrs[i].attrName, aggNames[i - 1]);
+        attrs[i].attrType = i == 1 ? INTEGER : view->val.attrType;
+        attrs[i].attrLen = sizeof(int);
+    }
+    if ((status = relCat->createRel(viewName, 5, attrs)) != OK)
+    {
+        delete view;
+        return status;
+    }
+
+    // the base relation as it is now
+    {
+        HeapFileScan scan(relName, status);
+        if (status != OK) { relCat->destroyRel(viewName); delete view; return status; }
+        scan.startScan(0, 0, STRING, NULL, EQ);
+        while ((scanStatus = scan.scanNext(rid)) == OK)
+        {
+            scan.getRecord(rec);
+            if (holds(rec, view->key) && holds(rec, view->val))
+                addValue(view, keyOf(rec, view->key), valueOf(rec, view->val));
+        }
+        if (scanStatus != FILEEOF)
+        {
+            relCat->destroyRel(viewName);
+            delete view;
+            return scanStatus;
+        }
+    }
+
+    // from now on heap files of the base relation keep the view current
+    AggViews* base;
+    {
+        lock_guard<mutex> lk(basesMutex);
+        base = AggViews::baseOf(relName);
+    }
+    lock_guard<mutex> lk(base->mtx);
+    base->views.push_back(view);
+    base->viewCnt = base->views.size();
+    return OK;
+}
+
+const Status destroyAggView(const string & viewName)
+{
+    AggViews* base = AggViews::find(viewName);
+    AggView* view;
+    if (base == NULL) return RELNOTFOUND;
+
+    // look again under the mutex: another destroy may have come first
+    {
+        lock_guard<mutex> lk(base->mtx);
+        int i = base->indexOf(viewName);
+        if (i < 0) return RELNOTFOUND;
+        view = base->views[i];
+        base->views.erase(base->views.begin() + i);
+        base->viewCnt = base->views.size();
+    }
+    delete view;
+    return relCat->destroyRel(viewName);
+}
+
+
+// Refresh a view.  The stale groups get their minimum and maximum back
+// from one scan of the base relation, then the records of the view
+// relation are replaced by one record per group.
+
+const Status refreshAggView(const string & viewName)
+{
+    Status status, scanStatus;
+    AggViews* base;
+    vector<AttrDesc> attrs;
+    RID rid;
+    Record rec;
+
+    if ((base = AggViews::find(viewName)) == NULL) return RELNOTFOUND;
+    if ((status = relCat->getRelAttrs(viewName, attrs)) != OK) return status;
+
+    // the view may have been destroyed since find
+    lock_guard<mutex> lk(base->mtx);
+    int i = base->indexOf(viewName);
+    if (i < 0) return RELNOTFOUND;
+    AggView* view = base->views[i];
+    if (view->staleCnt > 0)
+    {
+        map<string, AggGroup>::iterator it;
+
+        // a single stale group needs only its own records
+        HeapFileScan scan(base->relName, status);
+        if (status != OK) return status;
+        if (view->staleCnt == 1)
+        {
+            for (it = view->groups.begin(); !it->second.stale; it++) ;
+            status = scan.startScan(view->key.attrOffset, view->key.attrLen,
+                                    (Datatype) view->key.attrType,
+                                    it->first.data(), EQ);
+        }
+        else
+            status = scan.startScan(0, 0, STRING, NULL, EQ);
+        if (status != OK) return status;
+
+        map<string, bool> seen;		// stale groups with a value so far
+        while ((scanStatus = scan.scanNext(rid)) == OK)
+        {
+            scan.getRecord(rec);
+            if (!holds(rec, view->key) || !holds(rec, view->val)) continue;
+            string key = keyOf(rec, view->key);
+            it = view->groups.find(key);
+            if (it == view->groups.end() || !it->second.stale) continue;
+
+            double v = valueOf(rec, view->val);
+            AggGroup & g = it->second;
+            if (seen.insert(make_pair(key, true)).second)
+                g.min = g.max = v;
+            else
+            {
+                if (v < g.min) g.min = v;
+                if (v > g.max) g.max = v;
+            }
+        }
+        if (scanStatus != FILEEOF) return scanStatus;
+
+        for (it = view->groups.begin(); it != view->groups.end(); it++)
+            it->second.stale = false;
+        view->staleCnt = 0;
+    }
+    if (!view->dirty) return OK;
+
+    // an INTEGER sum must fit the attribute; the view relation is left
+    // as it is until it does
+    if (attrs[2].attrType == INTEGER)
+        for (map<string, AggGroup>::iterator it = view->groups.begin();
+             it != view->groups.end(); it++)
+            if (it->second.sum < INT_MIN || it->second.sum > INT_MAX)
+                return VALOVERFLOW;
+
+    // replace the records of the view relation
+    {
+        HeapFileScan scan(viewName, status);
+        if (status != OK) return status;
+        scan.startScan(0, 0, STRING, NULL, EQ);
+        while ((scanStatus = scan.scanNext(rid)) == OK)
+            if ((status = scan.deleteRecord()) != OK) return status;
+        if (scanStatus != FILEEOF) return scanStatus;
+    }
+    {
+        InsertFileScan scan(viewName, status);
+        if (status != OK) return status;
+        vector<char> row(attrs.back().attrOffset + attrs.back().attrLen);
+        rec.data = &row[0];
+        rec.length = row.size();
+        for (map<string, AggGroup>::iterator it = view->groups.begin();
+             it != view->groups.end(); it++)
+        {
+            const AggGroup & g = it->second;
+            memcpy(&row[attrs[0].attrOffset], it->first.data(), attrs[0].attrLen);
+            memcpy(&row[attrs[1].attrOffset], &g.count, sizeof(int));
+            putValue(&row[attrs[2].attrOffset], attrs[2].attrType, g.sum);
+            putValue(&row[attrs[3].attrOffset], attrs[3].attrType, g.min);
+            putValue(&row[attrs[4].attrOffset], attrs[4].attrType, g.max);
+            if ((status = scan.insertRecord(rec, rid)) != OK) return status;
+        }
+    }
+    view->dirty = false;
+    return OK;
+}
@@ -0,0 +1,104 @@
+#ifndef AGGVIEW_H
+#define AGGVIEW_H
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include "catalog.h"
+
+// Materialized aggregate views.
+//
+// An aggregate view groups the records of a catalog relation by a key
+// attribute and keeps COUNT, SUM, MIN and MAX of a value attribute
+// (INTEGER or FLOAT) for every group.  It is built with one scan of
+// the relation when it is created and from then on is updated by every
+// insert (InsertFileScan) and delete (HeapFileScan) of the relation,
+// at the cost of one group lookup.  A delete of the minimum or maximum
+// of a group marks that group stale; the next refresh recomputes the
+// stale groups together, with one scan of the relation.
+//
+// The view is also a catalog relation, with attributes key (named
+// after the key attribute), cnt, sum, min and max, the last three of
+// the type of the value attribute.  refreshAggView brings its records
+// up to date, which costs time proportional to the number of groups,
+// so it can then be queried like any other relation.  Keys equal to a
+// scan filter are one group (STRING keys up to the first NUL).  While
+// an INTEGER sum does not fit in an int, refreshAggView returns
+// VALOVERFLOW and leaves the view relation as it was.
+//
+// Views live as long as the process; destroyAggView removes the view
+// relation.  Heap files of the relation that are open when the view is
+// created update it from then on, as do those opened later.
+
+// create view viewName over relation relName
+const Status createAggView(const string & viewName,
+                           const string & relName,
+                           const string & keyAttr,
+                           const string & valAttr);
+
+// remove view viewName and its relation
+const Status destroyAggView(const string & viewName);
+
+// bring the relation of view viewName up to date
+const Status refreshAggView(const string & viewName);
+
+
+// aggregates of one group
+struct AggGroup
+{
+  int		count;
+  double	sum;
+  double	min;
+  double	max;
+  bool		stale;		// min and max need recomputing
+};
+
+struct AggView
+{
+  string		name;
+  AttrDesc		key;		// of the base relation
+  AttrDesc		val;
+  map<string, AggGroup>	groups;		// by keyOf the records
+  bool			dirty;		// relation of view is out of date
+  int			staleCnt;	// stale groups
+};
+
+// The views over one relation.  Used by HeapFile.  There is one for
+// every heap file opened, also one without views, so that the heap
+// files that are open see the views created later.
+
+class AggViews
+{
+public:
+  // the views of heap file fileName.  the object is never deleted
+  static AggViews* of(const string & fileName);
+
+  // true if there are views to update
+  const bool any() const { return viewCnt > 0; }
+
+  void inserted(const Record & rec);
+  void deleted(const Record & rec);
+
+private:
+  string		relName;
+  mutex			mtx;		// guards the views and their groups
+  vector<AggView*>	views;
+  atomic<int>		viewCnt;	// views.size(), read without mtx
+
+  // the views of relName, made if there are none; basesMutex is held
+  static AggViews* baseOf(const string & relName);
+
+  // the views view viewName is one of, NULL if there is no such view.
+  // the view may be gone once the mutex of the views is taken again
+  static AggViews* find(const string & viewName);
+
+  // the index of view viewName in views, -1 if gone; mtx is held
+  const int indexOf(const string & viewName) const;
+
+  friend const Status createAggView(const string &, const string &,
+                                    const string &, const string &);
+  friend const Status destroyAggView(const string &);
+  friend const Status refreshAggView(const string &);
+};
+
+#endif
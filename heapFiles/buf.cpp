@@ -5,12 +5,14 @@
 #include <fcntl.h>
 #include <iostream>
 #include <stdio.h>
+#include <algorithm>
+#include <sys/mman.h>
 #include "page.h"
 #include "buf.h"
 
 #define ASSERT(c)  { if (!(c)) { \
-		       cerr << "At line " << __LINE__ << ":" << endl << "  "; \
-                       cerr << "This condition should hold: " #c << endl; \
+		       LOGERROR("At line " << __LINE__ << ":\n  " \
+				<< "This condition should hold: " #c); \
                        exit(1); \
 		     } \
                    }
@@ -19,151 +21,354 @@
 // Constructor of the class BufMgr
 //----------------------------------------
 
+// The buffer pool, the frame descriptors and the hash table come
+// zero-filled from the OS and are faulted in as frames are first used,
+// so constructing a BufMgr costs the same for any pool size. An all
+// zero BufDesc is a free frame: not valid, unpinned, without a file.
+
 BufMgr::BufMgr(const int bufs)
 {
     numBufs = bufs;
 
-    bufTable = new BufDesc[bufs];
-    memset(bufTable, 0, bufs * sizeof(BufDesc));
-    for (int i = 0; i < bufs; i++) 
-    {
-        bufTable[i].frameNo = i;
-        bufTable[i].valid = false;
-    }
-
-    bufPool = new Page[bufs];
-    memset(bufPool, 0, bufs * sizeof(Page));
+    bufTable = (BufDesc*) bufAlloc(bufs * sizeof(BufDesc));
+    bufPool = (Page*) bufAlloc(bufs * sizeof(Page));
 
     int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
     hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
 
     clockHand = bufs - 1;
+    useClock = 0;
+    nextFresh = 0;
+    numBorrowed = 0;
+    pfNext = pfLeft = 0;
+    sweepRequested = stopSweeper = false;
+    sweeper = thread(&BufMgr::sweepLoop, this);
 }
 
 
 BufMgr::~BufMgr() {
 
+    {
+        lock_guard<mutex> lk(bufMutex);
+        stopSweeper = true;
+    }
+    sweepWanted.notify_one();
+    sweeper.join();
+
+    finishPrefetch();
+
     // flush out all unwritten pages
     for (int i = 0; i < numBufs; i++) 
     {
         BufDesc* tmpbuf = &bufTable[i];
         if (tmpbuf->valid == true && tmpbuf->dirty == true) {
 
-#ifdef DEBUGBUF
-            cout << "flushing page " << tmpbuf->pageNo
-                 << " from frame " << i << endl;
-#endif
+            LOGTRACE("flushing page " << tmpbuf->pageNo << " from frame " << i);
 
             tmpbuf->file->writePage(tmpbuf->pageNo, &(bufPool[i]));
         }
     }
-delete hashTable;
-    delete [] bufTable;
-    delete [] bufPool;
+    for (unsigned i = 0; i < faultThreads.size(); i++)
+        faultThreads[i].join();
+
+    delete hashTable;
+    bufFree(bufTable, numBufs * sizeof(BufDesc));
+    bufFree(bufPool, numBufs * sizeof(Page));
+}
+
+
+// Get bytes of zero-filled memory. The memory is mapped but not
+// touched, so it costs nothing until it is used.
+
+void* bufAlloc(const size_t bytes)
+{
+    void* p = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+    {
+        LOGERROR("bufAlloc: mmap of " << bytes << " bytes failed");
+        exit(1);
+    }
+    return p;
+}
+
+void bufFree(void* p, const size_t bytes)
+{
+    munmap(p, bytes);
+}
+
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+// Fault in the buffer pool in the background, so that the first use of
+// a frame doesn't take a page fault. The pool is split into one range
+// per thread. The contents of the frames are not touched: the kernel
+// only populates the page tables, which is safe while the pool is in
+// use. On kernels without MADV_POPULATE_WRITE nothing is done.
+
+void BufMgr::prefault(const int threads)
+{
+    size_t bytes = (size_t) numBufs * sizeof(Page);
+    size_t osPage = sysconf(_SC_PAGESIZE);
+    int n = threads < 1 ? 1 : threads;
+    size_t chunk = (bytes / n + osPage - 1) / osPage * osPage;
+
+    for (size_t start = 0; start < bytes; start += chunk)
+    {
+        char* p = (char*) bufPool + start;
+        size_t len = start + chunk > bytes ? bytes - start : chunk;
+        faultThreads.push_back(thread([p, len]() {
+            if (madvise(p, len, MADV_POPULATE_WRITE) < 0)
+                LOGDEBUG("prefault of buffer pool failed: " << strerror(errno));
+        }));
+    }
 }
 
 
 const Status BufMgr::allocBuf(int & frame) 
 {
-    // perform first part of clock algorithm to search for 
-    // open buffer frame
-    // Assumes non-concurrent access to buffer manager
+    // the caller holds bufMutex
     Status status = OK;
-    int numScanned = 0;
-    bool found = 0;
-    while (numScanned < 2*numBufs)
+
+    // frames reserved by a prefetch can't be used until it is done
+    if (!pfPages.empty())
+        installPrefetched(false);
+
+    // a free frame, if there is one
+    if (takeFreeFrame(frame))
     {
-        // advance the clock
-        advanceClock();
-        numScanned++;
+        bufTable[frame].frameNo = frame;
+        return OK;
+    }
 
-        // if invalid, use frame
-        if (! bufTable[clockHand].valid)
+    while (true)
+    {
+        while (!victims.empty())
         {
-            break;
+            int victim = victims.front();
+            victims.pop_front();
+
+            // have the sweeper refill the queue before it runs dry
+            if (victims.size() <= (unsigned) VICTIMQUEUE / 2 && !sweepRequested)
+            {
+                sweepRequested = true;
+                sweepWanted.notify_one();
+            }
+
+            BufDesc* tmpbuf = &bufTable[victim];
+            tmpbuf->queued = false;
+
+            // skip it if it has been used since it was queued
+            if (!tmpbuf->valid || tmpbuf->pinCnt > 0 || tmpbuf->refbit)
+                continue;
+
+            // flush any existing changes to disk if necessary
+            if (tmpbuf->dirty)
+            {
+                bufStats.diskwrites++;
+                status = tmpbuf->file->writePage(tmpbuf->pageNo, &bufPool[victim]);
+                if (status != OK) return status;
+            }
+
+            // remove previous entry from hash table
+            hashTable->remove(tmpbuf->file, tmpbuf->pageNo);
+            tmpbuf->Clear();
+            tmpbuf->frameNo = victim;
+
+            // return new frame number
+            frame = victim;
+            return OK;
         }
 
-        // is valid, check referenced bit
-        if (! bufTable[clockHand].refbit)
+        // the queue has run dry: run the clock until it finds a victim
+        if (sweepVictims(2*numBufs, false) == 0)
         {
-            // check to see if someone has it pinned
-            if (bufTable[clockHand].pinCnt == 0)
+            // check for full buffer pool
+            if (!pfPages.empty())
             {
-                // hasn't been referenced and is not pinned, use it
-
-                // remove previous entry from hash table
-                status = hashTable->remove(bufTable[clockHand].file, 
-                                           bufTable[clockHand].pageNo);
-                found = true;
-                //if (status != OK) return status;
-                break;
+                finishPrefetch();
+                return allocBuf(frame);
             }
+            return BUFFEREXCEEDED;
         }
-        else
+    }
+} // end allocBuf
+
+
+// Advance the clock over at most maxScan frames, queueing unpinned
+// frames that have not been referenced since the clock last passed
+// them. Returns the number of frames queued. Reference bits cleared
+// by the sweeper are not counted as accesses, as they happen at no
+// particular point of the caller's work.
+
+const int BufMgr::sweepVictims(const int maxScan, const bool background)
+{
+    int queued = 0;
+
+    for (int numScanned = 0;
+         numScanned < maxScan && victims.size() < (unsigned) VICTIMQUEUE;
+         numScanned++)
+    {
+        // advance the clock
+        advanceClock();
+        BufDesc* tmpbuf = &bufTable[clockHand];
+
+        // free frames are on the free list
+        if (!tmpbuf->valid || tmpbuf->queued || tmpbuf->pinCnt > 0)
+            continue;
+
+        if (tmpbuf->refbit)
         {
             // has been referenced, clear the bit
-            bufStats.accesses++;
-            bufTable[clockHand].refbit = false;
+            if (!background) bufStats.accesses++;
+            tmpbuf->refbit = false;
+            continue;
         }
+
+        // hasn't been referenced and is not pinned
+        tmpbuf->queued = true;
+        victims.push_back(clockHand);
+        queued++;
     }
-    
-    // check for full buffer pool
-    if (!found && numScanned >= 2*numBufs)
+    return queued;
+}
+
+// Body of the sweeper thread. It runs the clock VICTIMSCAN frames at a
+// time, letting other threads have the latch in between, until the
+// victim queue is full or it has been twice around the pool.
+
+void BufMgr::sweepLoop()
+{
+    unique_lock<mutex> lk(bufMutex);
+
+    while (true)
     {
-        return BUFFEREXCEEDED;
+        sweepWanted.wait(lk, [this]() { return stopSweeper || sweepRequested; });
+        if (stopSweeper) return;
+
+        for (int scanned = 0;
+             scanned < 2*numBufs && victims.size() < (unsigned) VICTIMQUEUE &&
+             !stopSweeper;
+             scanned += VICTIMSCAN)
+        {
+            sweepVictims(VICTIMSCAN, true);
+            lk.unlock();
+            this_thread::yield();
+            lk.lock();
+        }
+        sweepRequested = false;
+        bufStats.sweeps++;
     }
-    
-    // flush any existing changes to disk if necessary
-    if (bufTable[clockHand].dirty)
-    {
-        bufStats.diskwrites++;
+}
 
-        status = bufTable[clockHand].file->writePage(bufTable[clockHand].pageNo,
-                                                     &bufPool[clockHand]);
-        if (status != OK) return status;
+// take a free frame, preferring frames that were used before
+
+const bool BufMgr::takeFreeFrame(int & frame)
+{
+    if (!freeFrames.empty())
+    {
+        frame = freeFrames.back();
+        freeFrames.pop_back();
+        return true;
     }
+    if (nextFresh < numBufs)
+    {
+        frame = nextFresh++;
+        return true;
+    }
+    return false;
+}
 
-    // return new frame number
-    frame = clockHand;
+// clear a frame and put it on the free list
 
-    return OK;
-} // end allocBuf
+void BufMgr::freeFrame(const int frame)
+{
+    bool queued = bufTable[frame].queued;
+    bufTable[frame].Clear();
+    bufTable[frame].queued = queued;
+    freeFrames.push_back(frame);
+}
 
 	
 const Status BufMgr::readPage(File* file, const int PageNo, Page*& page)
 {
+    unique_lock<mutex> lk(bufMutex);
+
     // check to see if it is already in the buffer pool
     // cout << "readPage called on file.page " << file << "." << PageNo << endl;
     int frameNo = 0;
-    Status status = hashTable->lookup(file, PageNo, frameNo);
+
+    // enter what a prefetch has read so far, waiting for this page if
+    // it is still being read
+    if (!pfPages.empty())
+    {
+        installPrefetched(false);
+        while (pfIndex.find(make_pair(file, PageNo)) != pfIndex.end())
+            installPrefetched(true);
+    }
+
+    Status status;
+    while ((status = hashTable->lookup(file, PageNo, frameNo)) == OK &&
+           bufTable[frameNo].ioInProgress)
+    {
+        // another thread is reading the page: wait for its read
+        // instead of issuing a second one, then look again, as the
+        // read may have failed
+        bufStats.iowaits++;
+        ioDone.wait(lk);
+    }
+
     if (status == OK)
     {
         // set the referenced bit
         bufTable[frameNo].refbit = true;
+        bufTable[frameNo].lastUse = ++useClock;
         bufTable[frameNo].pinCnt++;
         page = &bufPool[frameNo];
+        return OK;
     }
-    else // not in the buffer pool, must allocate a new page
-    {
-        // alloc a new frame
-        status = allocBuf(frameNo);
-        if (status != OK) return status;
 
-        // read the page into the new frame
-        bufStats.diskreads++;
-        status = file->readPage(PageNo, &bufPool[frameNo]);
-        if (status != OK) return status;
+    // not in the buffer pool, must allocate a new page
+    status = allocBuf(frameNo);
+    if (status != OK) return status;
 
-        // set up the entry properly
-        bufTable[frameNo].Set(file, PageNo);
-        page = &bufPool[frameNo];
+    // set up the entry and publish it in the hash table before the
+    // read, marked as being read, so that other requests for the
+    // page wait for this read
+    bufTable[frameNo].Set(file, PageNo);
+    bufTable[frameNo].lastUse = ++useClock;
+    bufTable[frameNo].ioInProgress = true;
+    status = hashTable->insert(file, PageNo, frameNo);
+    if (status != OK)
+    {
+        freeFrame(frameNo);
+        return status;
+    }
 
-        // insert in the hash table
-        status = hashTable->insert(file, PageNo, frameNo);
-        if (status != OK) { return status; }
+    // read the page into the new frame. pages of a temporary file that
+    // is held in memory are read under the latch
+    bufStats.diskreads++;
+    if (file->isTemp())
+        status = file->readPage(PageNo, &bufPool[frameNo]);
+    else
+    {
+        lk.unlock();
+        status = file->readPage(PageNo, &bufPool[frameNo]);
+        lk.lock();
+    }
 
+    bufTable[frameNo].ioInProgress = false;
+    ioDone.notify_all();
+    if (status != OK)
+    {
+        hashTable->remove(file, PageNo);
+        freeFrame(frameNo);
+        return status;
     }
 
+    page = &bufPool[frameNo];
     return OK;
 }
 
@@ -171,6 +376,7 @@ const Status BufMgr::readPage(File* file, const int PageNo, Page*& page)
 const Status BufMgr::unPinPage(File* file, const int PageNo, 
 			       const bool dirty) 
 {
+    lock_guard<mutex> lk(bufMutex);
     // lookup in hashtable
     Status status = OK;
     int frameNo = 0;
@@ -195,8 +401,11 @@ const Status BufMgr::unPinPage(File* file, const int PageNo,
 
 const Status BufMgr::flushFile(const File* file) 
 {
+    lock_guard<mutex> lk(bufMutex);
   Status status;
 
+  finishPrefetch();
+
   for (int i = 0; i < numBufs; i++) {
     BufDesc* tmpbuf = &(bufTable[i]);
     if (tmpbuf->valid == true && tmpbuf->file == file) {
@@ -205,10 +414,7 @@ const Status BufMgr::flushFile(const File* file)
 	  return PAGEPINNED;
 
       if (tmpbuf->dirty == true) {
-#ifdef DEBUGBUF
-	cout << "flushing page " << tmpbuf->pageNo
-             << " from frame " << i << endl;
-#endif
+	LOGTRACE("flushing page " << tmpbuf->pageNo << " from frame " << i);
 	if ((status = tmpbuf->file->writePage(tmpbuf->pageNo,
 					      &(bufPool[i]))) != OK)
 	  return status;
@@ -217,10 +423,7 @@ const Status BufMgr::flushFile(const File* file)
       }
 
       hashTable->remove(file,tmpbuf->pageNo);
-
-      tmpbuf->file = NULL;
-      tmpbuf->pageNo = -1;
-      tmpbuf->valid = false;
+      freeFrame(i);
     }
 
     else if (tmpbuf->valid == false && tmpbuf->file == file)
@@ -234,14 +437,16 @@ const Status BufMgr::flushFile(const File* file)
 
 const Status BufMgr::disposePage(File* file, const int pageNo) 
 {
+    lock_guard<mutex> lk(bufMutex);
     // see if it is in the buffer pool
     Status status = OK;
     int frameNo = 0;
+    finishPrefetch();
     status = hashTable->lookup(file, pageNo, frameNo);
     if (status == OK)
     {
         // clear the page
-        bufTable[frameNo].Clear();
+        freeFrame(frameNo);
     }
     status = hashTable->remove(file, pageNo);
 
@@ -252,6 +457,7 @@ const Status BufMgr::disposePage(File* file, const int pageNo)
 
 const Status BufMgr::allocPage(File* file, int& pageNo, Page*& page) 
 {
+    lock_guard<mutex> lk(bufMutex);
     int frameNo;
 
     // allocate a new page in the file
@@ -264,6 +470,7 @@ const Status BufMgr::allocPage(File* file, int& pageNo, Page*& page)
 
      // set up the entry properly
      bufTable[frameNo].Set(file, pageNo);
+     bufTable[frameNo].lastUse = ++useClock;
      page = &bufPool[frameNo];
 
      // insert in thehash table
@@ -276,6 +483,7 @@ const Status BufMgr::allocPage(File* file, int& pageNo, Page*& page)
 
 void BufMgr::printSelf(void) 
 {
+    lock_guard<mutex> lk(bufMutex);
     BufDesc* tmpbuf;
   
     cout << endl << "Print buffer...\n";
@@ -291,3 +499,241 @@ void BufMgr::printSelf(void)
 }
 
 
+
+void BufMgr::getHotPages(vector<BufTag> & tags) const
+{
+    lock_guard<mutex> lk(bufMutex);
+    vector<pair<unsigned, int> > frames;
+
+    for (int i = 0; i < numBufs; i++)
+        if (bufTable[i].valid && bufTable[i].file != NULL &&
+            pfIndex.find(make_pair(bufTable[i].file, bufTable[i].pageNo)) == pfIndex.end())
+            frames.push_back(make_pair(bufTable[i].lastUse, i));
+    sort(frames.rbegin(), frames.rend());
+
+    tags.clear();
+    for (unsigned i = 0; i < frames.size(); i++)
+    {
+        BufTag tag;
+        tag.file = bufTable[frames[i].second].file;
+        tag.pageNo = bufTable[frames[i].second].pageNo;
+        tags.push_back(tag);
+    }
+}
+
+
+// A lent frame is pinned but not valid: the clock, flushFile and
+// getHotPages all pass it by, and it is on neither the free list nor
+// in the hash table.
+
+const Status BufMgr::borrowFrames(const int n, vector<Page*> & frames)
+{
+    lock_guard<mutex> lk(bufMutex);
+    vector<int> taken;
+    Status status = OK;
+
+    if (n < 0 || numBorrowed + n > numBufs / 2) return BUFFEREXCEEDED;
+    while ((int) taken.size() < n)
+    {
+        int frameNo;
+        if ((status = allocBuf(frameNo)) != OK) break;
+        bufTable[frameNo].Clear();
+        bufTable[frameNo].pinCnt = 1;
+        taken.push_back(frameNo);
+    }
+    if (status != OK)
+    {
+        for (unsigned i = 0; i < taken.size(); i++)
+            freeFrame(taken[i]);
+        return status;
+    }
+
+    numBorrowed += n;
+    for (unsigned i = 0; i < taken.size(); i++)
+        frames.push_back(&bufPool[taken[i]]);
+    return OK;
+}
+
+const Status BufMgr::returnFrames(const vector<Page*> & frames)
+{
+    lock_guard<mutex> lk(bufMutex);
+
+    for (unsigned i = 0; i < frames.size(); i++)
+    {
+        int frameNo = frames[i] - bufPool;
+        if (frameNo < 0 || frameNo >= numBufs || bufTable[frameNo].valid ||
+            bufTable[frameNo].pinCnt != 1)
+            return BADBUFFER;
+    }
+    for (unsigned i = 0; i < frames.size(); i++)
+    {
+        int frameNo = frames[i] - bufPool;
+        freeFrame(frameNo);
+    }
+    numBorrowed -= frames.size();
+    return OK;
+}
+
+
+// sort order of prefetched pages: by file, then by page number
+static bool prefetchBefore(const PrefetchPage & a, const PrefetchPage & b)
+{
+    if (a.file != b.file) return a.file < b.file;
+    return a.pageNo < b.pageNo;
+}
+
+// Start reading the given pages into the free frames of the pool. The
+// pages are sorted and cut into batches of consecutive pages, which
+// PREFETCHTHREADS threads read with one system call each. The frames
+// are reserved (valid and pinned, but not in the hash table) until
+// the batch reading them has been installed.
+
+const Status BufMgr::prefetch(const vector<BufTag> & tags)
+{
+    lock_guard<mutex> lk(bufMutex);
+    finishPrefetch();
+
+    // take the pages in the order given until the free frames run out
+    for (unsigned i = 0; i < tags.size(); i++)
+    {
+        int frameNo;
+        pair<File*, int> key(tags[i].file, tags[i].pageNo);
+        if (tags[i].file == NULL || tags[i].pageNo < 1) continue;
+        if (hashTable->lookup(tags[i].file, tags[i].pageNo, frameNo) == OK) continue;
+        if (pfIndex.find(key) != pfIndex.end()) continue;
+        if (!takeFreeFrame(frameNo)) break;
+
+        PrefetchPage p;
+        p.file = tags[i].file;
+        p.pageNo = tags[i].pageNo;
+        p.frameNo = frameNo;
+        p.batch = -1;
+        pfIndex[key] = pfPages.size();
+        pfPages.push_back(p);
+    }
+    if (pfPages.empty()) return OK;
+
+    sort(pfPages.begin(), pfPages.end(), prefetchBefore);
+    for (unsigned i = 0; i < pfPages.size(); i++)
+    {
+        PrefetchPage & p = pfPages[i];
+        if (i == 0 || p.file != pfPages[i-1].file ||
+            p.pageNo != pfPages[i-1].pageNo + 1 ||
+            (int) i - pfBatchStart.back() >= PREFETCHBATCH)
+            pfBatchStart.push_back(i);
+        p.batch = pfBatchStart.size() - 1;
+        pfIndex[make_pair(p.file, p.pageNo)] = i;
+
+        // reserve the frame
+        bufTable[p.frameNo].frameNo = p.frameNo;
+        bufTable[p.frameNo].Set(p.file, p.pageNo);
+        bufTable[p.frameNo].refbit = false;
+    }
+    int numBatches = pfBatchStart.size();
+    pfBatchStart.push_back(pfPages.size());
+
+    pfStatus.assign(numBatches, OK);
+    pfDone.clear();
+    pfNext = 0;
+    pfLeft = numBatches;
+
+    for (int i = 0; i < PREFETCHTHREADS && i < numBatches; i++)
+        pfThreads.push_back(thread(&BufMgr::prefetchReader, this));
+
+    LOGDEBUG("prefetching " << pfPages.size() << " pages in "
+             << numBatches << " batches");
+    return OK;
+}
+
+// body of a prefetch thread: read batches until none are left
+
+void BufMgr::prefetchReader()
+{
+    Page* pages[PREFETCHBATCH];
+
+    while (true)
+    {
+        int batch;
+        {
+            lock_guard<mutex> lk(pfMutex);
+            if (pfNext == (int) pfStatus.size()) return;
+            batch = pfNext++;
+        }
+
+        int first = pfBatchStart[batch];
+        int n = pfBatchStart[batch + 1] - first;
+        for (int i = 0; i < n; i++)
+            pages[i] = &bufPool[pfPages[first + i].frameNo];
+        Status status = pfPages[first].file->readPages(pfPages[first].pageNo, n, pages);
+
+        {
+            lock_guard<mutex> lk(pfMutex);
+            pfStatus[batch] = status;
+            pfDone.push_back(batch);
+        }
+        pfCond.notify_all();
+    }
+}
+
+// Enter the pages of finished batches in the hash table and unpin
+// their frames; frames of batches that failed are freed. With wait
+// set, block until at least one batch has finished.
+
+void BufMgr::installPrefetched(const bool wait)
+{
+    vector<int> done;
+    {
+        unique_lock<mutex> lk(pfMutex);
+        if (wait)
+            pfCond.wait(lk, [this]() { return !pfDone.empty(); });
+        done.swap(pfDone);
+    }
+
+    for (unsigned d = 0; d < done.size(); d++)
+    {
+        int batch = done[d];
+        for (int i = pfBatchStart[batch]; i < pfBatchStart[batch + 1]; i++)
+        {
+            PrefetchPage & p = pfPages[i];
+            BufDesc & desc = bufTable[p.frameNo];
+            if (pfStatus[batch] == OK &&
+                hashTable->insert(p.file, p.pageNo, p.frameNo) == OK)
+            {
+                bufStats.diskreads++;
+                desc.pinCnt = 0;
+                desc.refbit = true;
+            }
+            else
+                freeFrame(p.frameNo);
+            pfIndex.erase(make_pair(p.file, p.pageNo));
+        }
+        if (pfStatus[batch] != OK)
+            LOGWARN("prefetch of " << pfBatchStart[batch + 1] - pfBatchStart[batch]
+                    << " pages failed with status " << pfStatus[batch]);
+        pfLeft--;
+    }
+
+    if (pfLeft == 0 && !pfPages.empty())
+    {
+        for (unsigned i = 0; i < pfThreads.size(); i++)
+            pfThreads[i].join();
+        pfThreads.clear();
+        pfPages.clear();
+        pfBatchStart.clear();
+        pfStatus.clear();
+        pfIndex.clear();
+    }
+}
+
+void BufMgr::finishPrefetch()
+{
+    while (!pfPages.empty())
+        installPrefetched(true);
+}
+
+const Status BufMgr::waitPrefetch()
+{
+    lock_guard<mutex> lk(bufMutex);
+    finishPrefetch();
+    return OK;
+}
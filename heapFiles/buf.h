@@ -1,9 +1,11 @@
 #ifndef BUF_H
 #define BUF_H
 
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
 #include "db.h"
-// define if debug output wanted
-//#define DEBUGBUF
 
 // declarations for buffer pool hash table
 struct hashBucket
@@ -42,6 +44,12 @@ public:
 };
 
 
+// zero-filled memory for the buffer pool and its tables; pages of it
+// are only touched when first used
+void* bufAlloc(const size_t bytes);
+void bufFree(void* p, const size_t bytes);
+
+
 class BufMgr;  //forward declaration of BufMgr class 
 
 // class for maintaining information about buffer pool frames
@@ -55,9 +63,13 @@ private:
   bool 	dirty;	  // true if dirty;  false otherwise
   bool 	valid;   // true if page is valid
   bool  refbit;	 // has this buffer frame been reference recently
+  unsigned lastUse; // value of the use clock at the last pin
+  bool  queued;  // frame is on the victim queue
+  bool  ioInProgress; // page is being read into the frame
 
   void Clear() {  // initialize buffer frame for a new user
     	pinCnt = 0;
+	ioInProgress = false;
 	file = NULL;
 	pageNo = -1;
     	dirty = false;
@@ -71,6 +83,8 @@ private:
       dirty = false;
       valid = true;
       refbit = true;
+      lastUse = 0;
+      ioInProgress = false;
   }
 
   BufDesc() {
@@ -84,10 +98,12 @@ struct BufStats
   int accesses;    // Total number of accesses to buffer pool
   int diskreads;   // Number of pages read from disk (including allocs)
   int diskwrites;  // Number of pages written back to disk
+  int iowaits;     // Number of reads that waited for a read in progress
+  int sweeps;      // Number of victim queue refills by the sweeper thread
 
   void clear()
     {
-      accesses = diskreads = diskwrites = 0;
+      accesses = diskreads = diskwrites = iowaits = sweeps = 0;
     }
       
   BufStats()
@@ -97,14 +113,85 @@ struct BufStats
 };
 
 
+// identifies a page in the buffer pool
+struct BufTag
+{
+  File*	file;
+  int	pageNo;
+};
+
+const int VICTIMQUEUE = 16;	// eviction candidates kept ready
+const int VICTIMSCAN = 32;	// frames the sweeper examines between
+				// releases of the latch
+const int PREFETCHTHREADS = 4;	// threads reading prefetched pages
+const int PREFETCHBATCH = 32;	// max pages read by one system call
+
+// a page being prefetched into a reserved frame
+struct PrefetchPage
+{
+  File*	file;
+  int	pageNo;
+  int	frameNo;
+  int	batch;		// batch that reads the page
+};
+
+// The buffer manager may be used by several threads. All state is
+// guarded by bufMutex, which is released while a page is read in; the
+// frame is then marked ioInProgress so that other requests for the
+// same page wait for that read.
+
 class BufMgr 
 {
 private:
+  mutable mutex	 bufMutex;	// latch on the buffer manager
+  condition_variable ioDone;	// signalled when a read completes
+
   unsigned int 	 clockHand;
   int   	 numBufs;    	// Number of pages in buffer pool
   BufHashTbl*    hashTable;  	// hash table mapping (File, page) to frame
   BufDesc*	 bufTable;  	// vector of status info, 1 per page
   BufStats	 bufStats;	// buffer pool statistics
+  unsigned	 useClock;	// stamps BufDesc::lastUse
+  int		 numBorrowed;	// frames lent out by borrowFrames
+
+  // frames ready for allocBuf: free frames, and frames picked by the
+  // clock as eviction victims ahead of need.  a queued victim is
+  // checked again when it is taken, as it may have been used since
+  vector<int>	 freeFrames;	// invalid frames below nextFresh
+  int		 nextFresh;	// frames from here on were never used
+  deque<int>	 victims;	// unpinned, unreferenced frames
+
+  const bool takeFreeFrame(int & frame);
+  void freeFrame(const int frame);
+  const int sweepVictims(const int maxScan, const bool background);
+
+  // the sweeper thread refills the victim queue when allocBuf has
+  // taken it down to half, so that allocBuf seldom runs the clock
+  thread	 sweeper;
+  condition_variable sweepWanted;	// signalled when a refill is wanted
+  bool		 sweepRequested;
+  bool		 stopSweeper;
+  void sweepLoop();
+
+  // state of a prefetch.  the reader threads only fill in page
+  // contents and report finished batches in pfDone; the frames are
+  // entered in the hash table by the thread using the buffer manager
+  vector<PrefetchPage> pfPages;	// sorted by file and page number
+  vector<int>	 pfBatchStart;	// first entry of each batch, plus end
+  vector<Status> pfStatus;	// outcome of each batch
+  map<pair<File*, int>, int> pfIndex; // (file, page) -> entry
+  vector<int>	 pfDone;	// finished batches not yet installed
+  int		 pfNext;	// next batch for a reader
+  int		 pfLeft;	// batches not yet installed
+  mutex		 pfMutex;	// guards pfDone and pfNext
+  condition_variable pfCond;	// signalled when a batch finishes
+  vector<thread> pfThreads;
+
+  vector<thread> faultThreads;	// threads of prefault
+
+  void prefetchReader();
+  void installPrefetched(const bool wait);
+  void finishPrefetch();
 
   const Status allocBuf(int & frame);   // allocate a free frame.  
   const void releaseBuf(int frame); // return unused frame to end of list
@@ -128,6 +215,42 @@ public:
   const Status disposePage(File* file, const int PageNo); // dispose of page in file
   void  printSelf();
 
+  // fault in the memory of the pool in the background, using the
+  // given number of threads
+  void prefault(const int threads);
+
+  // the valid pages in the pool, most recently used first
+  void getHotPages(vector<BufTag> & tags) const;
+
+  // read the given pages into free frames in the background.  pages
+  // already in the pool and pages beyond the free frames are skipped.
+  // a readPage of a page that is still being read waits for it
+  const Status prefetch(const vector<BufTag> & tags);
+
+  // wait for a prefetch to complete
+  const Status waitPrefetch();
+
+  // lend n frames to an operator as working memory.  they are taken as
+  // allocPage takes a frame, evicting pages if need be, and are out of
+  // the pool until returned.  at most half of the pool is lent out at
+  // a time; beyond that BUFFEREXCEEDED is returned and nothing is lent
+  const Status borrowFrames(const int n, vector<Page*> & frames);
+  const Status returnFrames(const vector<Page*> & frames);
+
+  const int getNumBufs() const { return numBufs; }
+  const int getBorrowed() const
+  {
+	lock_guard<mutex> lk(bufMutex);
+	return numBorrowed;
+  }
+
+  // eviction victims queued for allocBuf
+  const int getQueuedVictims() const
+  {
+	lock_guard<mutex> lk(bufMutex);
+	return victims.size();
+  }
+
   const BufStats & getBufStats() const // get buffer pool usage
   {
 	return bufStats;
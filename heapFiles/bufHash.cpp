@@ -12,9 +12,11 @@
 
 int BufHashTbl::hash(const File* file, const int pageNo)
 {
-  int tmp, value;
-  tmp = (long)file;  // cast of pointer to the file object to an integer
-  value = (tmp + pageNo) % HTSIZE;
+  unsigned long tmp;
+  int value;
+  tmp = (unsigned long)file;  // cast of pointer to the file object to an integer
+  // unsigned so that high address bits can't produce a negative index
+  value = (int) ((tmp + pageNo) % HTSIZE);
   return value;
 }
 
@@ -22,10 +24,8 @@ int BufHashTbl::hash(const File* file, const int pageNo)
 BufHashTbl::BufHashTbl(int htSize)
 {
   HTSIZE = htSize;
-  // allocate an array of pointers to hashBuckets
-  ht = new hashBucket* [htSize];
-  for(int i=0; i < HTSIZE; i++)
-    ht[i] = NULL;
+  // allocate an array of pointers to hashBuckets, all NULL
+  ht = (hashBucket**) bufAlloc(htSize * sizeof(hashBucket*));
 }
 
 
@@ -39,7 +39,7 @@ BufHashTbl::~BufHashTbl()
       delete tmpBuf;
     }
   }
-  delete [] ht;
+  bufFree(ht, HTSIZE * sizeof(hashBucket*));
 }
 
 
@@ -0,0 +1,437 @@
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <algorithm>
+#include "catalog.h"
+#include "error.h"
+
+extern const Status createHeapFile(const string fileName);
+extern const Status destroyHeapFile(const string fileName);
+
+// relation catalog implementation
+
+// sort attribute descriptors by offset
+static bool attrBefore(const AttrDesc & a, const AttrDesc & b)
+{
+    return a.attrOffset < b.attrOffset;
+}
+
+// delete every record of a catalog relation whose leading relName
+// field equals relName
+
+static const Status deleteCatRecords(const char* catName, const string & relName)
+{
+    Status status, scanStatus;
+    RID rid;
+    char name[MAXNAMESIZE];
+
+    memset(name, 0, MAXNAMESIZE);
+    strncpy(name, relName.c_str(), MAXNAMESIZE - 1);
+
+    HeapFileScan scan(catName, scanStatus);
+    if (scanStatus != OK) return scanStatus;
+    scanStatus = scan.startScan(0, MAXNAMESIZE, STRING, name, EQ);
+    if (scanStatus != OK) return scanStatus;
+
+    while ((scanStatus = scan.scanNext(rid)) == OK)
+    {
+        status = scan.deleteRecord();
+        if (status != OK && status != NORECORDS) return status;
+    }
+    return scanStatus == FILEEOF ? OK : scanStatus;
+}
+
+
+// Open the catalog and read all descriptors into memory.
+
+RelCatalog::RelCatalog(Status & status)
+{
+    Status scanStatus;
+    RID rid;
+    Record rec;
+
+    numCached = 0;
+    useClock = 0;
+
+    // create the catalog relations the first time around
+    status = createHeapFile(RELCATNAME);
+    if (status != OK && status != FILEEXISTS) return;
+    status = createHeapFile(ATTRCATNAME);
+    if (status != OK && status != FILEEXISTS) return;
+
+    // relation descriptors
+    {
+        HeapFileScan scan(RELCATNAME, status);
+        if (status != OK) return;
+        scan.startScan(0, 0, STRING, NULL, EQ);
+        while ((scanStatus = scan.scanNext(rid)) == OK)
+        {
+            scan.getRecord(rec);
+            RelInfo* info = new RelInfo;
+            memcpy(&info->desc, rec.data, sizeof(RelDesc));
+            info->file = NULL;
+            info->headerPageNo = -1;
+            info->lastUse = 0;
+            rels[info->desc.relName] = info;
+        }
+        if (scanStatus != FILEEOF) { status = scanStatus; return; }
+    }
+
+    // attribute descriptors
+    {
+        HeapFileScan scan(ATTRCATNAME, status);
+        if (status != OK) return;
+        scan.startScan(0, 0, STRING, NULL, EQ);
+        while ((scanStatus = scan.scanNext(rid)) == OK)
+        {
+            AttrDesc attr;
+            scan.getRecord(rec);
+            memcpy(&attr, rec.data, sizeof(AttrDesc));
+            map<string, RelInfo*>::iterator it = rels.find(attr.relName);
+            if (it != rels.end()) it->second->attrs.push_back(attr);
+        }
+        if (scanStatus != FILEEOF) { status = scanStatus; return; }
+    }
+
+    for (map<string, RelInfo*>::iterator it = rels.begin(); it != rels.end(); it++)
+        sort(it->second->attrs.begin(), it->second->attrs.end(), attrBefore);
+
+    LOGDEBUG("catalog holds " << rels.size() << " relations");
+    status = OK;
+}
+
+// Close the files the catalog keeps open and release the descriptors.
+
+RelCatalog::~RelCatalog()
+{
+    if (!warmList.empty())
+    {
+        Status status = saveWarmList(warmList);
+        if (status != OK)
+            LOGWARN("could not save warm list " << warmList << ": status " << status);
+    }
+    for (map<string, RelInfo*>::iterator it = rels.begin(); it != rels.end(); it++)
+    {
+        if (it->second->file != NULL) uncache(it->second);
+        delete it->second;
+    }
+}
+
+
+// Create a relation: check the attribute list, create the heap file
+// and enter the relation in relcat, attrcat and the cache.
+
+const Status RelCatalog::createRel(const string & relName,
+                                   const int attrCnt,
+                                   const AttrDesc attrs[])
+{
+    Status status;
+    RID rid;
+    Record rec;
+
+    if (relName.empty() || attrCnt < 1) return BADCATPARM;
+    if (relName.length() >= MAXNAMESIZE) return NAMETOOLONG;
+    if (rels.find(relName) != rels.end()) return RELEXISTS;
+
+    RelInfo* info = new RelInfo;
+    memset(&info->desc, 0, sizeof(RelDesc));
+    strcpy(info->desc.relName, relName.c_str());
+    info->desc.attrCnt = attrCnt;
+    info->file = NULL;
+    info->headerPageNo = -1;
+    info->lastUse = 0;
+
+    // lay the attributes out one after another
+    int offset = 0;
+    for (int i = 0; i < attrCnt; i++)
+    {
+        AttrDesc attr;
+        memset(&attr, 0, sizeof(AttrDesc));
+        strcpy(attr.relName, relName.c_str());
+        status = OK;
+        if (strnlen(attrs[i].attrName, MAXNAMESIZE) >= MAXNAMESIZE)
+            status = NAMETOOLONG;
+        else if (attrs[i].attrName[0] == '\0')
+            status = BADCATPARM;
+        else if ((attrs[i].attrType == INTEGER && attrs[i].attrLen != sizeof(int)) ||
+                 (attrs[i].attrType == FLOAT && attrs[i].attrLen != sizeof(float)) ||
+                 (attrs[i].attrType == STRING && attrs[i].attrLen < 1) ||
+                 (attrs[i].attrType != INTEGER && attrs[i].attrType != FLOAT &&
+                  attrs[i].attrType != STRING))
+            status = BADCATPARM;
+        for (int j = 0; j < i && status == OK; j++)
+            if (strncmp(attrs[i].attrName, attrs[j].attrName, MAXNAMESIZE) == 0)
+                status = DUPLATTR;
+        if (status != OK) { delete info; return status; }
+
+        strcpy(attr.attrName, attrs[i].attrName);
+        attr.attrType = attrs[i].attrType;
+        attr.attrLen = attrs[i].attrLen;
+        attr.attrOffset = offset;
+        offset += attr.attrLen;
+        info->attrs.push_back(attr);
+    }
+    if ((unsigned) offset > PAGESIZE - DPFIXED) { delete info; return ATTRTOOLONG; }
+    info->desc.recLen = offset;
+
+    if ((status = createHeapFile(relName)) != OK) { delete info; return status; }
+
+    // enter the relation in the catalog relations
+    {
+        InsertFileScan relScan(RELCATNAME, status);
+        if (status != OK) { delete info; return status; }
+        rec.data = &info->desc;
+        rec.length = sizeof(RelDesc);
+        if ((status = relScan.insertRecord(rec, rid)) != OK)
+        {
+            delete info;
+            return status;
+        }
+    }
+    {
+        InsertFileScan attrScan(ATTRCATNAME, status);
+        if (status != OK) { delete info; return status; }
+        for (int i = 0; i < attrCnt; i++)
+        {
+            rec.data = &info->attrs[i];
+            rec.length = sizeof(AttrDesc);
+            if ((status = attrScan.insertRecord(rec, rid)) != OK)
+            {
+                delete info;
+                return status;
+            }
+        }
+    }
+
+    rels[relName] = info;
+    return OK;
+}
+
+
+// Destroy a relation: remove it from the catalog relations and the
+// cache, then destroy its heap file.
+
+const Status RelCatalog::destroyRel(const string & relName)
+{
+    Status status;
+
+    map<string, RelInfo*>::iterator it = rels.find(relName);
+    if (it == rels.end()) return RELNOTFOUND;
+
+    RelInfo* info = it->second;
+    if (info->file != NULL && (status = uncache(info)) != OK) return status;
+
+    if ((status = deleteCatRecords(RELCATNAME, relName)) != OK) return status;
+    if ((status = deleteCatRecords(ATTRCATNAME, relName)) != OK) return status;
+
+    rels.erase(it);
+    delete info;
+
+    return destroyHeapFile(relName);
+}
+
+
+const Status RelCatalog::getRelInfo(const string & relName, RelDesc & desc) const
+{
+    map<string, RelInfo*>::const_iterator it = rels.find(relName);
+    if (it == rels.end()) return RELNOTFOUND;
+    desc = it->second->desc;
+    return OK;
+}
+
+const Status RelCatalog::getAttrInfo(const string & relName,
+                                     const string & attrName,
+                                     AttrDesc & attr) const
+{
+    map<string, RelInfo*>::const_iterator it = rels.find(relName);
+    if (it == rels.end()) return RELNOTFOUND;
+
+    const vector<AttrDesc> & attrs = it->second->attrs;
+    for (unsigned i = 0; i < attrs.size(); i++)
+        if (attrName == attrs[i].attrName)
+        {
+            attr = attrs[i];
+            return OK;
+        }
+    return ATTRNOTFOUND;
+}
+
+const Status RelCatalog::getRelAttrs(const string & relName,
+                                     vector<AttrDesc> & attrs) const
+{
+    map<string, RelInfo*>::const_iterator it = rels.find(relName);
+    if (it == rels.end()) return RELNOTFOUND;
+    attrs = it->second->attrs;
+    return OK;
+}
+
+
+// Return the header page of a relation's heap file. The first call
+// opens the file and reads the DB header page to find it; the catalog
+// then holds on to the open file, so later calls cost nothing. When
+// too many relations are held open the least recently used one is
+// closed.
+
+const Status RelCatalog::getHeaderPage(const string & relName, int & headerPageNo)
+{
+    Status status;
+
+    map<string, RelInfo*>::iterator it = rels.find(relName);
+    if (it == rels.end()) return RELNOTFOUND;
+    RelInfo* info = it->second;
+
+    if (info->file == NULL)
+    {
+        if (numCached >= MAXCACHEDRELS)
+        {
+            RelInfo* victim = NULL;
+            for (it = rels.begin(); it != rels.end(); it++)
+                if (it->second->file != NULL &&
+                    (victim == NULL || it->second->lastUse < victim->lastUse))
+                    victim = it->second;
+            if (victim != NULL && (status = uncache(victim)) != OK) return status;
+        }
+
+        if ((status = db.openFile(relName, info->file)) != OK)
+        {
+            info->file = NULL;
+            return status;
+        }
+        if ((status = info->file->getFirstPage(info->headerPageNo)) != OK)
+        {
+            db.closeFile(info->file);
+            info->file = NULL;
+            return status;
+        }
+        numCached++;
+        LOGDEBUG("catalog caching relation " << relName);
+    }
+
+    info->lastUse = ++useClock;
+    headerPageNo = info->headerPageNo;
+    return OK;
+}
+
+// drop the catalog's hold on the file of a relation, e.g. before the
+// file is destroyed
+
+const Status RelCatalog::release(const string & relName)
+{
+    map<string, RelInfo*>::iterator it = rels.find(relName);
+    if (it == rels.end()) return RELNOTFOUND;
+    if (it->second->file == NULL) return OK;
+    return uncache(it->second);
+}
+
+const Status RelCatalog::uncache(RelInfo* info)
+{
+    Status status = db.closeFile(info->file);
+    info->file = NULL;
+    info->headerPageNo = -1;
+    numCached--;
+    return status;
+}
+
+
+// Write the warm list: the pages of open catalog relations that are
+// in the buffer pool, most recently used first. The list is written
+// to a scratch file that then replaces the old list.
+
+const Status RelCatalog::saveWarmList(const string & listName) const
+{
+    vector<BufTag> tags;
+    map<File*, const RelInfo*> open;
+    vector<WarmEntry> entries;
+
+    for (map<string, RelInfo*>::const_iterator it = rels.begin(); it != rels.end(); it++)
+        if (it->second->file != NULL)
+            open[it->second->file] = it->second;
+
+    bufMgr->getHotPages(tags);
+    for (unsigned i = 0; i < tags.size(); i++)
+    {
+        map<File*, const RelInfo*>::iterator it = open.find(tags[i].file);
+        if (it == open.end()) continue;
+        WarmEntry entry;
+        memset(&entry, 0, sizeof entry);
+        strcpy(entry.relName, it->second->desc.relName);
+        entry.pageNo = tags[i].pageNo;
+        entries.push_back(entry);
+    }
+
+    string scratch = listName + ".new";
+    int fd = ::open(scratch.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0666);
+    if (fd < 0) return UNIXERR;
+
+    int header[2] = { WARMMAGIC, (int) entries.size() };
+    ssize_t len = entries.size() * sizeof(WarmEntry);
+    if (write(fd, header, sizeof header) != sizeof header ||
+        (len > 0 && write(fd, &entries[0], len) != len))
+    {
+        ::close(fd);
+        unlink(scratch.c_str());
+        return UNIXERR;
+    }
+    if (::close(fd) < 0 || rename(scratch.c_str(), listName.c_str()) < 0)
+        return UNIXERR;
+
+    LOGDEBUG("saved " << entries.size() << " pages to warm list " << listName);
+    return OK;
+}
+
+// Read warm list listName, open the relations it names through the
+// catalog, which keeps them open, and hand their pages to the buffer
+// manager for prefetching. Only as many relations as the catalog
+// holds open at once are warmed.
+
+const Status RelCatalog::warmUp(const string & listName)
+{
+    Status status;
+    int header[2];
+    vector<WarmEntry> entries;
+
+    int fd = ::open(listName.c_str(), O_RDONLY);
+    if (fd < 0) return errno == ENOENT ? OK : UNIXERR;
+    if (read(fd, header, sizeof header) != sizeof header || header[0] != WARMMAGIC ||
+        header[1] < 0)
+    {
+        ::close(fd);
+        return BADFILE;
+    }
+    entries.resize(header[1]);
+    ssize_t len = entries.size() * sizeof(WarmEntry);
+    if (len > 0 && read(fd, &entries[0], len) != len)
+    {
+        ::close(fd);
+        return BADFILE;
+    }
+    ::close(fd);
+
+    vector<BufTag> tags;
+    map<string, RelInfo*> warmed;
+    for (unsigned i = 0; i < entries.size(); i++)
+    {
+        string relName(entries[i].relName, strnlen(entries[i].relName, MAXNAMESIZE));
+        map<string, RelInfo*>::iterator it = warmed.find(relName);
+        if (it == warmed.end())
+        {
+            int headerPageNo;
+            if (warmed.size() == (unsigned) MAXCACHEDRELS) continue;
+            // a relation destroyed since the list was saved is skipped
+            if (getHeaderPage(relName, headerPageNo) != OK) continue;
+            it = warmed.insert(make_pair(relName, rels[relName])).first;
+        }
+        BufTag tag;
+        tag.file = it->second->file;
+        tag.pageNo = entries[i].pageNo;
+        tags.push_back(tag);
+    }
+
+    if ((status = bufMgr->prefetch(tags)) != OK) return status;
+
+    LOGDEBUG("warming " << tags.size() << " pages of " << warmed.size()
+             << " relations from " << listName);
+    return OK;
+}
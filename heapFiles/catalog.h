@@ -0,0 +1,118 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <map>
+#include "heapfile.h"
+
+// names of the catalog relations
+#define RELCATNAME   "relcat"
+#define ATTRCATNAME  "attrcat"
+
+const int MAXCACHEDRELS = 64;	// relations the catalog keeps open
+
+// schema of relation relcat
+struct RelDesc
+{
+  char	relName[MAXNAMESIZE];	// relation name
+  int	attrCnt;		// number of attributes
+  int	recLen;			// length of a record
+};
+
+// schema of relation attrcat
+struct AttrDesc
+{
+  char	relName[MAXNAMESIZE];	// relation name
+  char	attrName[MAXNAMESIZE];	// attribute name
+  int	attrOffset;		// offset of attribute within record
+  int	attrType;		// type of attribute (a Datatype)
+  int	attrLen;		// length of attribute
+};
+
+// a warm list names the pages of catalog relations that were in the
+// buffer pool, most recently used first
+#define WARMMAGIC    0x57524d4c
+
+struct WarmEntry
+{
+  char	relName[MAXNAMESIZE];	// relation name
+  int	pageNo;			// page of relation
+};
+
+// cached descriptor of one relation
+struct RelInfo
+{
+  RelDesc		desc;
+  vector<AttrDesc>	attrs;		// in offset order
+  File*			file;		// open file, NULL when not cached
+  int			headerPageNo;	// page number of heap file header
+  int			lastUse;	// for choosing a relation to close
+};
+
+
+// The relation catalog. Descriptors of all relations in relcat and
+// attrcat are read once, when the catalog is constructed, and are
+// answered from memory afterwards. The catalog also keeps the files
+// of up to MAXCACHEDRELS recently used relations open, together with
+// the page number of their heap file header, so that opening one of
+// them again needs no I/O: the open count is bumped and the header and
+// first data page are found in the buffer pool.
+
+class RelCatalog
+{
+public:
+  // open the catalog, creating relcat and attrcat if they don't exist
+  RelCatalog(Status & status);
+  ~RelCatalog();
+
+  // create relation relName with the given attributes.  the offsets of
+  // the attributes are assigned in order; attrOffset is ignored
+  const Status createRel(const string & relName,
+                         const int attrCnt,
+                         const AttrDesc attrs[]);
+
+  // destroy relation relName and its heap file
+  const Status destroyRel(const string & relName);
+
+  // get the descriptor of relation relName
+  const Status getRelInfo(const string & relName, RelDesc & desc) const;
+
+  // get the descriptor of attribute attrName of relation relName
+  const Status getAttrInfo(const string & relName,
+                           const string & attrName,
+                           AttrDesc & attr) const;
+
+  // get the descriptors of all attributes of relation relName
+  const Status getRelAttrs(const string & relName,
+                           vector<AttrDesc> & attrs) const;
+
+  // return the heap file header page of relation relName, keeping
+  // its file open for later opens.  used by HeapFile
+  const Status getHeaderPage(const string & relName, int & headerPageNo);
+
+  // close the file of relation relName if the catalog holds it open
+  const Status release(const string & relName);
+
+  // write the warm list of the relations the catalog holds open.  may
+  // be called at any time; the old list is replaced atomically
+  const Status saveWarmList(const string & listName) const;
+
+  // open the relations on warm list listName and start reading their
+  // pages into the buffer pool in the background.  a missing list is
+  // not an error
+  const Status warmUp(const string & listName);
+
+  // save the warm list to listName when the catalog is destroyed
+  void setWarmList(const string & listName) { warmList = listName; }
+
+private:
+  map<string, RelInfo*> rels;	// all relations, by name
+  int numCached;		// relations with an open file
+  int useClock;			// counter for RelInfo::lastUse
+  string warmList;		// warm list saved at shutdown, if any
+
+  const Status uncache(RelInfo* info);
+};
+
+extern RelCatalog* relCat;
+
+#endif
@@ -0,0 +1,336 @@
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <map>
+#include "changes.h"
+#include "error.h"
+
+// change log implementation
+
+// change logs of heap files, by heap file name.  kept, also without a
+// log, while heap files hold on to them
+static mutex logsMutex;
+static map<string, ChangeLog*> logs;
+
+static const string logName(const string & fileName)
+{
+  return fileName + ".chg";
+}
+
+static const bool writeAll(const int fd, const char* p, size_t n)
+{
+  while (n > 0)
+    {
+      ssize_t written = ::write(fd, p, n);
+      if (written < 0)
+	{
+	  if (errno == EINTR) continue;
+	  return false;
+	}
+      p += written;
+      n -= written;
+    }
+  return true;
+}
+
+// read up to n bytes at offset; the number read, or -1
+static const long readAt(const int fd, char* p, const long n, const long long offset)
+{
+  long done = 0;
+  while (done < n)
+    {
+      ssize_t got = pread(fd, p + done, n - done, offset + done);
+      if (got < 0)
+	{
+	  if (errno == EINTR) continue;
+	  return -1;
+	}
+      if (got == 0) break;
+      done += got;
+    }
+  return done;
+}
+
+// find the end of the complete entries of a log and the sequence
+// number of the last one
+static const Status scanLog(const int fd, long long & end, long long & lastSeq)
+{
+  vector<char> buf(CHGBUFSIZE);
+  long long bufOffset = sizeof(int);	// log offset of buf[0]
+  long len = 0;				// bytes in buf
+  long pos = 0;				// next entry in buf
+  int magic;
+
+  if (readAt(fd, (char*) &magic, sizeof magic, 0) != sizeof magic ||
+      magic != CHGMAGIC)
+    return BADFILE;
+
+  lastSeq = 0;
+  while (true)
+    {
+      ChangeEntry e;
+      if (len - pos >= (long) sizeof e)
+	{
+	  memcpy(&e, &buf[pos], sizeof e);
+	  if (e.length < 0)
+	    {
+	      bufOffset += pos;
+	      break;
+	    }
+	  if (len - pos >= (long) sizeof e + e.length)
+	    {
+	      pos += sizeof e + e.length;
+	      lastSeq = e.seq;
+	      continue;
+	    }
+	}
+
+      // entry not in buffer: refill it from the entry on
+      bufOffset += pos;
+      long need = len - pos >= (long) sizeof e ? sizeof e + e.length : sizeof e;
+      if ((long) buf.size() < need) buf.resize(need);
+      len = readAt(fd, &buf[0], buf.size(), bufOffset);
+      if (len < 0) return UNIXERR;
+      pos = 0;
+      if (len < need) break;		// end of log, maybe a torn entry
+    }
+  end = bufOffset;
+  return OK;
+}
+
+
+const Status createChangeLog(const string & fileName)
+{
+  int magic = CHGMAGIC;
+  int fd;
+
+  lock_guard<mutex> lk(logsMutex);
+  fd = ::open(logName(fileName).c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+  if (fd < 0) return errno == EEXIST ? FILEEXISTS : UNIXERR;
+  bool ok = writeAll(fd, (const char*) &magic, sizeof magic);
+  ::close(fd);
+  if (!ok)
+    {
+      unlink(logName(fileName).c_str());
+      return UNIXERR;
+    }
+
+  // the heap files that are open log their changes from now on
+  map<string, ChangeLog*>::iterator it = logs.find(fileName);
+  if (it == logs.end()) return OK;
+  fd = ::open(logName(fileName).c_str(), O_RDWR);
+  if (fd < 0 || lseek(fd, 0, SEEK_END) < 0)
+    {
+      if (fd >= 0) ::close(fd);
+      unlink(logName(fileName).c_str());
+      return UNIXERR;
+    }
+  ChangeLog* log = it->second;
+  lock_guard<mutex> llk(log->mtx);
+  if (log->fd >= 0) ::close(log->fd);
+  log->fd = fd;
+  log->nextSeq = 1;
+  log->buf.clear();
+  log->buf.reserve(CHGBUFSIZE);
+  return OK;
+}
+
+const Status destroyChangeLog(const string & fileName)
+{
+  lock_guard<mutex> lk(logsMutex);
+  map<string, ChangeLog*>::iterator it = logs.find(fileName);
+  if (it != logs.end())
+    {
+      // the heap files still open stop logging
+      ChangeLog* log = it->second;
+      {
+        lock_guard<mutex> llk(log->mtx);
+        if (log->fd >= 0) ::close(log->fd);
+        log->fd = -1;
+        log->buf.clear();
+      }
+      if (log->opens == 0)
+        {
+          delete log;
+          logs.erase(it);
+        }
+    }
+  if (unlink(logName(fileName).c_str()) < 0)
+    return errno == ENOENT ? FILEEOF : UNIXERR;
+  return OK;
+}
+
+const Status changeLogFlush(const string & fileName)
+{
+  lock_guard<mutex> lk(logsMutex);
+  map<string, ChangeLog*>::iterator it = logs.find(fileName);
+  if (it == logs.end()) return OK;
+  lock_guard<mutex> llk(it->second->mtx);
+  return it->second->flushLocked();
+}
+
+
+// ChangeLog
+
+// Find the log of fileName.  The first open in the process looks for
+// the log file and reads it once to find the last sequence number; an
+// entry cut short by a crash is removed.
+
+ChangeLog* ChangeLog::open(const string & fileName)
+{
+  long long end, lastSeq;
+
+  lock_guard<mutex> lk(logsMutex);
+  map<string, ChangeLog*>::iterator it = logs.find(fileName);
+  if (it != logs.end())
+    {
+      it->second->opens++;
+      return it->second;
+    }
+
+  ChangeLog* log = new ChangeLog;
+  log->fileName = logName(fileName);
+  log->fd = -1;
+  log->opens = 1;
+  log->nextSeq = 1;
+  int fd = ::open(logName(fileName).c_str(), O_RDWR);
+  if (fd >= 0)
+    {
+      if (scanLog(fd, end, lastSeq) != OK || ftruncate(fd, end) < 0 ||
+	  lseek(fd, end, SEEK_SET) < 0)
+	{
+	  LOGERROR("change log of " << fileName << " is unusable");
+	  ::close(fd);
+	}
+      else
+	{
+	  log->fd = fd;
+	  log->nextSeq = lastSeq + 1;
+	  log->buf.reserve(CHGBUFSIZE);
+	}
+    }
+  logs[fileName] = log;
+  return log;
+}
+
+// the last release writes out what is left in memory
+void ChangeLog::release()
+{
+  lock_guard<mutex> lk(logsMutex);
+  if (--opens == 0)
+    {
+      lock_guard<mutex> llk(mtx);
+      if (flushLocked() != OK)
+	LOGERROR("write of change log " << fileName << " failed");
+    }
+}
+
+const Status ChangeLog::append(const ChangeOp op, const RID & rid,
+                               const Record & rec)
+{
+  ChangeEntry e;
+  lock_guard<mutex> lk(mtx);
+
+  if (fd < 0) return OK;
+  e.seq = nextSeq++;
+  e.op = op;
+  e.rid = rid;
+  e.length = rec.length;
+  buf.insert(buf.end(), (const char*) &e, (const char*) (&e + 1));
+  buf.insert(buf.end(), (const char*) rec.data,
+             (const char*) rec.data + rec.length);
+  if (buf.size() >= (unsigned) CHGBUFSIZE) return flushLocked();
+  return OK;
+}
+
+const Status ChangeLog::flush()
+{
+  lock_guard<mutex> lk(mtx);
+  return flushLocked();
+}
+
+const Status ChangeLog::flushLocked()
+{
+  if (buf.empty() || fd < 0) return OK;
+  bool ok = writeAll(fd, &buf[0], buf.size());
+  buf.clear();
+  return ok ? OK : UNIXERR;
+}
+
+
+// ChangeReader
+
+ChangeReader::ChangeReader(const string & fileName, const ChangePos & from,
+                           Status & status)
+{
+  int magic;
+
+  heapName = fileName;
+  pos = from;
+  bufStart = 0;
+  fd = ::open(logName(fileName).c_str(), O_RDONLY);
+  if (fd < 0)
+    {
+      status = errno == ENOENT ? FILEEOF : UNIXERR;
+      return;
+    }
+  if (readAt(fd, (char*) &magic, sizeof magic, 0) != sizeof magic ||
+      magic != CHGMAGIC)
+    {
+      status = BADFILE;
+      return;
+    }
+  if (pos.offset < (long long) sizeof magic) pos.offset = sizeof magic;
+  bufOffset = pos.offset;
+  status = OK;
+}
+
+ChangeReader::~ChangeReader()
+{
+  if (fd >= 0) ::close(fd);
+}
+
+// make need bytes from bufStart on available; false at end of log
+const bool ChangeReader::fill(const unsigned need)
+{
+  if (buf.size() - bufStart >= need) return true;
+
+  buf.erase(buf.begin(), buf.begin() + bufStart);
+  bufStart = 0;
+  long long at = bufOffset + buf.size();
+  unsigned have = buf.size();
+  unsigned want = need > (unsigned) CHGBUFSIZE ? need : CHGBUFSIZE;
+  buf.resize(want);
+  long got = readAt(fd, &buf[have], want - have, at);
+  buf.resize(have + (got > 0 ? got : 0));
+  return buf.size() >= need;
+}
+
+const Status ChangeReader::next(ChangeEntry & entry, Record & rec)
+{
+  if (fd < 0) return BADFILE;
+
+  for (int attempt = 0; attempt < 2; attempt++)
+    {
+      if (fill(sizeof entry))
+	{
+	  memcpy(&entry, &buf[bufStart], sizeof entry);
+	  if (pos.seq > 0 && entry.seq != pos.seq + 1) return BADFILE;
+	  if (fill(sizeof entry + entry.length))
+	    {
+	      rec.data = &buf[bufStart + sizeof entry];
+	      rec.length = entry.length;
+	      bufStart += sizeof entry + entry.length;
+	      bufOffset += sizeof entry + entry.length;
+	      pos.seq = entry.seq;
+	      pos.offset = bufOffset;
+	      return OK;
+	    }
+	}
+      // at the end: entries may still be in memory in this process
+      if (attempt == 0) changeLogFlush(heapName);
+    }
+  return FILEEOF;
+}
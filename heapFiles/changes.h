@@ -0,0 +1,130 @@
+#ifndef CHANGES_H
+#define CHANGES_H
+
+#include <atomic>
+#include <mutex>
+#include "heapfile.h"
+
+// Change logs.
+//
+// A heap file may have a change log, kept in file <name>.chg.  While
+// it exists, every record inserted into the heap file (through
+// InsertFileScan) and every record deleted (through HeapFileScan) is
+// appended to the log with the next sequence number, as a ChangeEntry
+// followed by the bytes of the record inserted or deleted.
+//
+// Entries are collected in memory and written out when CHGBUFSIZE
+// bytes have accumulated, when the last open of the heap file is
+// closed and when changeLogFlush is called.  A reader in the same
+// process sees entries as soon as they are made.
+//
+// A consumer reads the log with a ChangeReader and saves its position
+// (a ChangePos) as a checkpoint.  A reader opened at a checkpoint
+// starts there directly, so catching up costs time proportional to the
+// number of changes since, not to the size of the relation or log.
+//
+// Heap files that are open when the change log is created log their
+// changes from then on, as do those opened later.
+
+#define CHGMAGIC	0x43484731
+
+const int CHGBUFSIZE = 64 * 1024;	// bytes of entries kept in memory
+
+enum ChangeOp { CHGINSERT = 1, CHGDELETE };
+
+// one entry of a change log; length bytes of record data follow
+struct ChangeEntry
+{
+  long long	seq;		// sequence number, from 1
+  int		op;		// a ChangeOp
+  RID		rid;		// record inserted or deleted
+  int		length;		// length of record
+};
+
+// a position in a change log
+struct ChangePos
+{
+  long long	seq;		// sequence number of last entry read
+  long long	offset;		// byte offset of the following entry
+};
+
+const ChangePos LOGSTART = { 0, 0 };
+
+// start logging the changes of heap file fileName
+const Status createChangeLog(const string & fileName);
+
+// stop logging the changes of heap file fileName and remove its log
+const Status destroyChangeLog(const string & fileName);
+
+// write out the entries of the change log of fileName kept in memory
+const Status changeLogFlush(const string & fileName);
+
+
+// The writing side of a change log, shared by all opens of the heap
+// file.  Used by HeapFile.  There is one for every heap file opened,
+// also one without a log, so that createChangeLog can start the log of
+// the heap files that are open.
+
+class ChangeLog
+{
+public:
+  // the change log of heap file fileName.  every open must be matched
+  // by a release
+  static ChangeLog* open(const string & fileName);
+  void release();
+
+  // true while the heap file has a log
+  const bool logging() const { return fd >= 0; }
+
+  // add an entry; does nothing while the heap file has no log
+  const Status append(const ChangeOp op, const RID & rid, const Record & rec);
+
+  const Status flush();
+
+private:
+  string		fileName;	// of the log
+  atomic<int>		fd;		// -1 while there is no log
+  int			opens;		// opens not yet released
+  long long		nextSeq;
+  vector<char>		buf;		// entries not yet written
+  mutex			mtx;		// guards nextSeq and buf
+
+  ChangeLog() {}
+  const Status flushLocked();
+
+  friend const Status createChangeLog(const string & fileName);
+  friend const Status destroyChangeLog(const string & fileName);
+  friend const Status changeLogFlush(const string & fileName);
+};
+
+
+// Reads a change log from a position on.  At the end of the log next
+// returns FILEEOF; it may be called again later to pick up entries
+// added since.
+
+class ChangeReader
+{
+public:
+  ChangeReader(const string & fileName, const ChangePos & from,
+               Status & status);
+  ~ChangeReader();
+
+  // return the next entry; rec points to its record until the next
+  // call
+  const Status next(ChangeEntry & entry, Record & rec);
+
+  // position after the last entry returned, to resume from later
+  const ChangePos getPos() const { return pos; }
+
+private:
+  string	heapName;	// heap file whose log is read
+  int		fd;
+  ChangePos	pos;
+  vector<char>	buf;		// entries read from the log
+  unsigned	bufStart;	// next unreturned byte of buf
+  long long	bufOffset;	// log offset of buf[bufStart]
+
+  const bool fill(const unsigned need);
+};
+
+#endif
@@ -6,6 +6,8 @@
 #include <iostream>
 #include <math.h>
 #include <stdio.h>
+#include <limits.h>
+#include <sys/uio.h>
 #include "page.h"
 #include "db.h"
 #include "buf.h"
@@ -13,6 +15,9 @@
 
 #define DBP(p)      (*(DBPage*)&p)
 
+int File::tempMemPages = 0;
+int File::tempMemLimit = 4096;
+
 // openfile hash table implementation
 OpenFileHashTbl::OpenFileHashTbl()
 {
@@ -131,11 +136,31 @@ File::File(const string & fname)
   fileName = fname;
   openCnt = 0;
   unixFile = -1;
+  temp = false;
+  space = NULL;
 }
 
 // Deallocate a file object
 File::~File()
 {
+  if (temp)
+    {
+      // a temporary file goes away with its object: release its
+      // memory and its scratch file, if it was spilled
+      if (openCnt > 0 && bufMgr)
+        bufMgr->flushFile(this);
+      for (unsigned i = 0; i < memPages.size(); i++)
+        if (memPages[i] != NULL)
+          {
+            delete memPages[i];
+            tempMemPages--;
+          }
+      memPages.clear();
+      if (unixFile >= 0)
+        ::close(unixFile);
+      return;
+    }
+
   if (openCnt == 0)
     return;
 
@@ -179,11 +204,33 @@ Status const File::create(const string & fileName)
   return OK;
 }
 
+// Create a temporary file object. Its DB header page is kept in
+// memory like the rest of its pages.
+
+File* File::createTemp(const string & fileName)
+{
+  File* file = new File(fileName);
+  file->temp = true;
+
+  Page header;
+  memset(&header, 0, sizeof header);
+  DBP(header).nextFree = -1;
+  DBP(header).firstPage = -1;
+  DBP(header).numPages = 1;
+  if (file->intwrite(0, &header) != OK)
+    {
+      delete file;
+      return NULL;
+    }
+  return file;
+}
+
 const Status File::destroy(const string & fileName)
 {
   if (remove(fileName.c_str()) < 0)
   {
-    cout << "db.destroy. unlink returned error" << "\n";
+    LOGINFO("db.destroy. unlink of " << fileName << " returned error: "
+            << strerror(errno));
     return UNIXERR;
   }
 
@@ -193,8 +240,30 @@ const Status File::destroy(const string & fileName)
 const Status File::open()
 {
   // Open file -- it will be closed in closeFile().
+  // Temporary files have no unix file to open.
 
-  if (openCnt == 0)
+  if (openCnt == 0 && space)
+    {
+      // relation in a tablespace: the tablespace is already open, so
+      // all that is needed is the extent table from the DB header page
+      int hdrPage;
+      Status status;
+      Page header;
+
+      if ((status = space->lookupRel(relName, hdrPage)) != OK)
+	return status;
+      if ((status = space->readPhys(hdrPage, &header)) != OK)
+	return status;
+      TSRelHeader* relHdr = (TSRelHeader*) &header;
+      // room for all extents up front: readPages may map pages on
+      // another thread while the file grows
+      extents.reserve(TSMAXEXTENTS);
+      extents.assign(relHdr->extent, relHdr->extent + relHdr->numExtents);
+
+      space->numRelsOpen++;
+      openCnt = 1;
+    }
+  else if (openCnt == 0 && !temp)
     {
       if ((unixFile = ::open(fileName.c_str(), O_RDWR)) < 0)
 	return UNIXERR;
@@ -223,6 +292,18 @@ const Status File::close()
     if (bufMgr)
       bufMgr->flushFile(this);
 
+    // a temporary file keeps its pages (and scratch file) until
+    // it is destroyed
+    if (temp)
+      return OK;
+
+    // the tablespace file stays open for the other relations
+    if (space)
+      {
+	space->numRelsOpen--;
+	return OK;
+      }
+
     if (::close(unixFile) < 0)
       return UNIXERR;
   }
@@ -277,8 +358,8 @@ Status File::allocatePage(int& pageNo)
   if ((status = intwrite(0, &header)) != OK)
     return status;
   
-#ifdef DEBUGFREE
-  listFree();
+#if LOGLEVEL >= LLTRACE
+  if (logLevel >= LLTRACE) listFree();
 #endif
 
   return OK;
@@ -322,8 +403,8 @@ const Status File::disposePage(const int pageNo)
   if ((status = intwrite(0, &header)) != OK)
     return status;
 
-#ifdef DEBUGFREE
-  listFree();
+#if LOGLEVEL >= LLTRACE
+  if (logLevel >= LLTRACE) listFree();
 #endif
 
   return OK;
@@ -335,18 +416,34 @@ const Status File::disposePage(const int pageNo)
 
 const Status File::intread(int pageNo, Page* pagePtr) const
 {
-  if (lseek(unixFile, pageNo * sizeof(Page), SEEK_SET) == -1)
-    return UNIXERR;
+  if (temp && unixFile < 0)
+    {
+      // temporary file still held in memory
+      if (pageNo >= (int) memPages.size() || memPages[pageNo] == NULL)
+        return BADPAGENO;
+      memcpy(pagePtr, memPages[pageNo], sizeof(Page));
+      return OK;
+    }
+
+  if (space)
+    {
+      int physPageNo = physPage(pageNo);
+      if (physPageNo < 0)
+	return BADPAGENO;
+      return space->readPhys(physPageNo, pagePtr);
+    }
 
-  int nbytes = read(unixFile, (char*)pagePtr, sizeof(Page));
+  int nbytes = pread(unixFile, (char*)pagePtr, sizeof(Page),
+		     (off_t) pageNo * sizeof(Page));
 
-#ifdef DEBUGIO
-  cerr << "%%  File " << (int)this << ": read bytes ";
-  cerr << pageNo * sizeof(Page) << ":+" << nbytes << endl;
-  cerr << "%%  ";
-  for(int i = 0; i < 10; i++)
-    cerr << *((int*)pagePtr + i) << " ";
-  cerr << endl;
+#if LOGLEVEL >= LLTRACE
+  if (logLevel >= LLTRACE) {
+    LogLine line(LLTRACE);
+    line << "%%  File " << (void*)this << ": read bytes "
+         << pageNo * sizeof(Page) << ":+" << nbytes << "\n%%  ";
+    for(int i = 0; i < 10; i++)
+      line << *((int*)pagePtr + i) << " ";
+  }
 #endif
 
   if (nbytes != sizeof(Page))
@@ -361,18 +458,60 @@ const Status File::intread(int pageNo, Page* pagePtr) const
 
 const Status File::intwrite(const int pageNo, const Page* pagePtr)
 {
-  if (lseek(unixFile, pageNo * sizeof(Page), SEEK_SET) == -1)
-    return UNIXERR;
+  if (temp && unixFile < 0)
+    {
+      // temporary file still held in memory: writes to new pages
+      // spill the file to disk once the memory limit is reached
+      if (pageNo >= (int) memPages.size())
+        memPages.resize(pageNo + 1, NULL);
+      if (memPages[pageNo] == NULL)
+        {
+          if (tempMemPages >= tempMemLimit)
+            {
+              Status status = spill();
+              if (status != OK)
+                return status;
+              return intwrite(pageNo, pagePtr);
+            }
+          memPages[pageNo] = new Page;
+          tempMemPages++;
+        }
+      memcpy(memPages[pageNo], pagePtr, sizeof(Page));
+      return OK;
+    }
 
-  int nbytes = write(unixFile, (char*)pagePtr, sizeof(Page));
+  if (space)
+    {
+      Status status;
+      if (physPage(pageNo) < 0 && (status = extendTo(pageNo)) != OK)
+	return status;
+      if (pageNo != 0)
+	return space->writePhys(physPage(pageNo), pagePtr);
+
+      // the extent table on the DB header page is owned by this
+      // object, so it is refreshed on every write of that page
+      Page header;
+      memcpy(&header, pagePtr, sizeof(Page));
+      TSRelHeader* relHdr = (TSRelHeader*) &header;
+      relHdr->numExtents = extents.size();
+      for (unsigned k = 0; k < extents.size(); k++)
+	relHdr->extent[k] = extents[k];
+      return space->writePhys(physPage(0), &header);
+    }
 
-#ifdef DEBUGIO
-  cerr << "%%  File " << (int)this << ": wrote bytes ";
-  cerr << pageNo * sizeof(Page) << ":+" << nbytes << endl;
-  cerr << "%%  ";
-  for(int i = 0; i < 10; i++)
-    cerr << *((int*)pagePtr + i) << " ";
-  cerr << endl;
+  // pwrite leaves the file offset alone, so the buffer manager can
+  // read and write pages of a file from several threads
+  int nbytes = pwrite(unixFile, (char*)pagePtr, sizeof(Page),
+		      (off_t) pageNo * sizeof(Page));
+
+#if LOGLEVEL >= LLTRACE
+  if (logLevel >= LLTRACE) {
+    LogLine line(LLTRACE);
+    line << "%%  File " << (void*)this << ": wrote bytes "
+         << pageNo * sizeof(Page) << ":+" << nbytes << "\n%%  ";
+    for(int i = 0; i < 10; i++)
+      line << *((int*)pagePtr + i) << " ";
+  }
 #endif
 
   if (nbytes != sizeof(Page))
@@ -382,6 +521,42 @@ const Status File::intwrite(const int pageNo, const Page* pagePtr)
 }
 
 
+// Move the pages of a temporary file from memory to a scratch file.
+// The scratch file is unlinked right away so that it disappears
+// with the process, whatever happens.
+
+const Status File::spill()
+{
+  const char* dir = getenv("TMPDIR");
+  string path = string(dir ? dir : "/tmp") + "/minirel.XXXXXX";
+  vector<char> name(path.begin(), path.end());
+  name.push_back('\0');
+
+  int fd = mkstemp(&name[0]);
+  if (fd < 0)
+    return UNIXERR;
+  unlink(&name[0]);
+
+  vector<Page*> pages;
+  pages.swap(memPages);
+  unixFile = fd;
+
+  Status status = OK;
+  for (unsigned i = 0; i < pages.size(); i++)
+    if (pages[i] != NULL)
+      {
+        if (status == OK)
+          status = intwrite(i, pages[i]);
+        delete pages[i];
+        tempMemPages--;
+      }
+
+  LOGTRACE("%%  File " << fileName << ": spilled " << pages.size() << " pages");
+
+  return status;
+}
+
+
 // Read a page from file, check parameters for validity.
 
 const Status File::readPage(const int pageNo, Page* pagePtr) const
@@ -395,6 +570,51 @@ const Status File::readPage(const int pageNo, Page* pagePtr) const
 }
 
 
+// Read pages pageNo .. pageNo+n-1 into the pages given by the caller.
+// The file offset is not used, so several threads may read at once
+// while the owner of the file keeps using it. Consecutive pages of a
+// unix file are read with one system call.
+
+const Status File::readPages(const int pageNo, const int n, Page* pages[]) const
+{
+  if (pageNo < 1 || n < 1)
+    return BADPAGENO;
+  if (temp)
+    return BADFILE;
+
+  if (space)
+    {
+      Status status;
+      for (int i = 0; i < n; i++)
+	{
+	  int physPageNo = physPage(pageNo + i);
+	  if (physPageNo < 0)
+	    return BADPAGENO;
+	  if ((status = space->readPhys(physPageNo, pages[i])) != OK)
+	    return status;
+	}
+      return OK;
+    }
+
+  struct iovec iov[IOV_MAX];
+  for (int done = 0; done < n; )
+    {
+      int cnt = n - done < IOV_MAX ? n - done : IOV_MAX;
+      for (int i = 0; i < cnt; i++)
+	{
+	  iov[i].iov_base = pages[done + i];
+	  iov[i].iov_len = sizeof(Page);
+	}
+      off_t offset = (off_t) (pageNo + done) * sizeof(Page);
+      if (preadv(unixFile, iov, cnt, offset) != (ssize_t) (cnt * sizeof(Page)))
+	return UNIXERR;
+      done += cnt;
+    }
+
+  return OK;
+}
+
+
 // Write a page to file, check parameters for validity.
 
 const Status File::writePage(const int pageNo, const Page *pagePtr)
@@ -425,24 +645,24 @@ const Status File::getFirstPage(int& pageNo) const
 }
 
 
-#ifdef DEBUGFREE
+#if LOGLEVEL >= LLTRACE
 
-// Print out the page numbers on the free list. For debugging only.
+// Log the page numbers on the free list. For debugging only.
 
 void File::listFree()
 {
-  cerr << "%%  File " << (int)this << " free pages:";
+  LogLine line(LLTRACE);
+  line << "%%  File " << (void*)this << " free pages:";
   int pageNo = 0;
   for(int i = 0; i < 10; i++) {
     Page page;
     if (intread(pageNo, &page) != OK)
       break;
     pageNo = DBP(page).nextFree;
-    cerr << " " << pageNo;
+    line << " " << pageNo;
     if (pageNo == -1)
       break;
   }
-  cerr << endl;
 }
 #endif
 
@@ -455,8 +675,8 @@ DB::DB()
   // Check that DB header page data fits on a regular data page.
 
   if (sizeof(DBPage) >= sizeof(Page)) {
-    cerr << "sizeof(DBPage) cannot exceed sizeof(Page): "
-         << sizeof(DBPage) << " " << sizeof(Page) << endl;
+    LOGERROR("sizeof(DBPage) cannot exceed sizeof(Page): "
+             << sizeof(DBPage) << " " << sizeof(Page));
     exit(1);
   }
 }
@@ -466,6 +686,9 @@ DB::DB()
 
 DB::~DB()
 {
+  for (unsigned i = 0; i < spaces.size(); i++)
+    delete spaces[i];
+
   // this could leave some open files open.
   // need to fix this by iterating through the hash table deleting each open file
 }
@@ -483,11 +706,112 @@ const Status DB::createFile(const string &fileName)
   // First check if the file has already been opened
   if (openFiles.find(fileName, file) == OK) return FILEEXISTS;
 
+  Tablespace* space;
+  string relName;
+  Status status = getTablespace(fileName, space, relName);
+  if (status != OK) return status;
+  if (space) return space->createRel(relName);
+
   // Do the actual work
   return File::create(fileName);
 }
 
 
+// Create a temporary database file. It is entered in the open files
+// table right away and stays there, closed or not, until it is
+// destroyed.
+
+const Status DB::createTempFile(const string &fileName)
+{
+  File* file;
+  if (fileName.empty())
+    return BADFILE;
+
+  if (openFiles.find(fileName, file) == OK)
+    return file->temp ? TMP_RES_EXISTS : FILEEXISTS;
+
+  if ((file = File::createTemp(fileName)) == NULL)
+    return INSUFMEM;
+
+  Status status = openFiles.insert(fileName, file);
+  if (status != OK)
+    delete file;
+  return status;
+}
+
+
+// Create a tablespace file.
+
+const Status DB::createTablespace(const string &spaceName)
+{
+  if (spaceName.empty() || spaceName.find(':') != string::npos)
+    return BADFILE;
+  return Tablespace::create(spaceName);
+}
+
+
+// Destroy a tablespace and all relations in it. None of them may be
+// open.
+
+const Status DB::destroyTablespace(const string &spaceName)
+{
+  for (unsigned i = 0; i < spaces.size(); i++)
+    if (spaces[i]->spaceName == spaceName)
+      {
+	if (spaces[i]->numRelsOpen > 0)
+	  return FILEOPEN;
+	delete spaces[i];
+	spaces.erase(spaces.begin() + i);
+	break;
+      }
+  return File::destroy(spaceName);
+}
+
+
+// Split a file name of the form "space:rel" and return the tablespace,
+// opening it if this is its first use. Other names get a NULL space.
+
+const Status DB::getTablespace(const string &fileName, Tablespace*& space,
+			       string &relName)
+{
+  space = NULL;
+  string::size_type colon = fileName.find(':');
+  if (colon == string::npos)
+    return OK;
+
+  string spaceName = fileName.substr(0, colon);
+  relName = fileName.substr(colon + 1);
+  if (spaceName.empty() || relName.empty())
+    return BADFILE;
+
+  for (unsigned i = 0; i < spaces.size(); i++)
+    if (spaces[i]->spaceName == spaceName)
+      {
+	space = spaces[i];
+	return OK;
+      }
+
+  Tablespace* newSpace = new Tablespace(spaceName);
+  Status status = newSpace->open();
+  if (status != OK)
+    {
+      delete newSpace;
+      return status;
+    }
+  spaces.push_back(newSpace);
+  space = newSpace;
+  return OK;
+}
+
+
+// Set the number of pages temporary files may keep in memory.
+
+void DB::setTempMemLimit(const int pages)
+{
+  File::tempMemLimit = pages;
+}
+
+
 // Delete a database file.
 
 const Status DB::destroyFile(const string & fileName) 
@@ -497,7 +821,20 @@ const Status DB::destroyFile(const string & fileName)
   if (fileName.empty()) return BADFILE;
 
   // Make sure file is not open currently.
-  if (openFiles.find(fileName, file) == OK) return FILEOPEN;
+  if (openFiles.find(fileName, file) == OK)
+  {
+      // temporary files stay in the table until they are destroyed
+      if (!file->temp || file->openCnt > 0) return FILEOPEN;
+      openFiles.erase(fileName);
+      delete file;
+      return OK;
+  }
+
+  Tablespace* space;
+  string relName;
+  Status status = getTablespace(fileName, space, relName);
+  if (status != OK) return status;
+  if (space) return space->destroyRel(relName);
   
   // Do the actual work
   return File::destroy(fileName);
@@ -527,7 +864,14 @@ const Status DB::openFile(const string & fileName, File*& filePtr)
   {
       // file is not already open
       // Otherwise create a new file object and open it
+      Tablespace* space;
+      string relName;
+      if ((status = getTablespace(fileName, space, relName)) != OK)
+	return status;
+
       filePtr = new File(fileName);
+      filePtr->space = space;
+      filePtr->relName = relName;
       status = filePtr->open();
 
       if (status != OK)
@@ -557,7 +901,7 @@ const Status DB::closeFile(File* file)
   // If there are no remaining references to the file, then we should delete
   // the file object and remove it from the openFilesMap
 
-  if (file->openCnt == 0)
+  if (file->openCnt == 0 && !file->temp)
     {
       if (openFiles.erase(file->fileName) != OK) return BADFILEPTR;
       delete file;
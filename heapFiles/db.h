@@ -3,22 +3,21 @@
 
 #include <sys/types.h>
 #include <functional>
+#include <vector>
+#include <map>
 #include "error.h"
 #include <string.h>
 using namespace std;
 
-// define if debug output wanted
-
-//#define DEBUGIO
-//#define DEBUGFREE
-
 // forward class definition for db
 class DB;
+class Tablespace;
 
 // class definition for open files
 class File {
   friend class DB;
   friend class OpenFileHashTbl;
+  friend class Tablespace;
 
  public:
 
@@ -29,6 +28,13 @@ class File {
   const Status writePage(const int pageNo,
 		   const Page* pagePtr);      // write page to file
   const Status getFirstPage(int& pageNo) const;     // returns pageNo of first page
+  const Status readPages(const int pageNo, const int n,
+		  Page* pages[]) const;       // read consecutive pages,
+                                              // thread safe
+
+  // pages of a temporary file held in memory can't be read while
+  // the file is written
+  const bool isTemp() const { return temp; }
 
   bool operator == (const File & other) const
     {
@@ -42,6 +48,7 @@ class File {
 
   static const Status create(const string &fileName);
   static const Status destroy(const string &fileName);
+  static File* createTemp(const string &fileName); // new in-memory file
 
   const Status open();
   const Status close();
@@ -51,13 +58,92 @@ class File {
   const Status intwrite(const int pageNo,
 		  const Page* pagePtr);       // internal file write
 
-#ifdef DEBUGFREE
-  void listFree();                      // list free pages
+  const Status spill();                 // move temp file pages to disk
+
+  // physical page of a page of a tablespace relation, -1 if the
+  // page lies beyond the extents allocated so far
+  const int physPage(const int pageNo) const;
+  // allocate extents until page pageNo is mapped
+  const Status extendTo(const int pageNo);
+
+#if LOGLEVEL >= LLTRACE
+  void listFree();                      // log free pages
 #endif
 
   string fileName;                    // The name of the file
   int openCnt;                        // # times file has been opened
   int unixFile;                       // unix file stream for file
+
+  // Temporary files live in memory (memPages) until the pages held by
+  // all temporary files exceed tempMemLimit; the file that grows past
+  // the limit is then spilled to an unlinked scratch file (unixFile).
+  bool temp;                          // true for a temporary file
+  vector<Page*> memPages;             // in-memory pages of a temp file
+  static int tempMemPages;            // pages held by all temp files
+  static int tempMemLimit;            // spill threshold in pages
+
+  // A file named "space:rel" is relation rel of tablespace space. It
+  // has no unix file of its own; its pages are mapped onto extents
+  // of the tablespace file.
+  Tablespace* space;                  // tablespace, NULL if none
+  string relName;                     // name within the tablespace
+  vector<int> extents;                // first physical page of each extent
+};
+
+
+// A tablespace keeps many relations in one unix file. Physical page 0
+// holds the tablespace header; a chain of directory pages maps
+// relation names to the physical page of their DB header page.
+// Relations grow by extents of TSEXTENTBASE << k pages, k = 0, 1, ...,
+// whose locations are kept on the relation's DB header page behind
+// the DBPage fields. Extents of destroyed relations go back onto
+// per-size free lists.
+
+const int TSMAXEXTENTS = 24;          // max extents per relation
+const int TSEXTENTBASE = 8;           // pages in first extent
+const int TSNAMESIZE = 56;            // max length of a relation name
+
+class Tablespace {
+  friend class DB;
+  friend class File;
+
+ public:
+  static const Status create(const string & spaceName);
+
+ private:
+  Tablespace(const string & spaceName);
+  ~Tablespace();
+
+  const Status open();
+  const Status close();
+
+  const Status createRel(const string & relName);
+  const Status destroyRel(const string & relName);
+  const Status lookupRel(const string & relName, int& hdrPage) const;
+
+  const Status allocExtent(const int sizeClass, int& firstPage);
+  const Status freeExtent(const int sizeClass, const int firstPage);
+
+  const Status readPhys(const int pageNo, Page* pagePtr) const;
+  const Status writePhys(const int pageNo, const Page* pagePtr);
+  const Status writeHeader();
+
+  const Status addDirEntry(const string & relName, const int hdrPage);
+
+  struct DirLoc {
+    int hdrPage;                      // physical page of DB header page
+    int dirPage;                      // directory page holding entry
+    int dirSlot;                      // index of entry on that page
+  };
+
+  string spaceName;
+  int unixFile;
+  int numPages;                       // physical pages in use
+  int firstDirPage;                   // first directory page
+  int freeList[TSMAXEXTENTS];         // free extents of each size
+  map<string, DirLoc> dir;            // in-memory copy of directory
+  vector<pair<int, int> > freeSlots;  // unused (dirPage, dirSlot) entries
+  int numRelsOpen;                    // relation files now open
 };
 
 class BufMgr;
@@ -109,8 +195,28 @@ class DB {
   const Status openFile(const string & fileName, File* & file);  // open a file
   const Status closeFile(File* file);         // close a file
 
+  // create a temporary file that is kept in memory and never appears
+  // in the file system; it lives until destroyFile() is called
+  const Status createTempFile(const string & fileName);
+
+  // limit on pages held in memory by temporary files before they
+  // start spilling to scratch files
+  void setTempMemLimit(const int pages);
+
+  // Files named "space:rel" are created inside tablespace space,
+  // which must have been created first. Tablespaces are opened on
+  // first use and stay open until destroyed or the DB goes away.
+  const Status createTablespace(const string & spaceName);
+  const Status destroyTablespace(const string & spaceName);
+
  private:
   OpenFileHashTbl   openFiles;    // list of open files
+  vector<Tablespace*> spaces;     // open tablespaces
+
+  // splits "space:rel" and returns the (opened) tablespace; space is
+  // NULL for ordinary file names
+  const Status getTablespace(const string & fileName,
+                             Tablespace*& space, string& relName);
 };
 
 
@@ -122,4 +228,12 @@ typedef struct {
   int numPages;                         // total # of pages in file
 } DBPage;
 
+// structure of DB (header) page of a relation in a tablespace
+
+typedef struct {
+  DBPage db;                            // the usual DB header fields
+  int numExtents;                       // extents allocated
+  int extent[TSMAXEXTENTS];             // first physical page of extents
+} TSRelHeader;
+
 #endif
@@ -2,6 +2,8 @@
 #ifndef ERROR_H
 #define ERROR_H
 
+#include "log.h"
+
 // error/status codes defined here
 
 // add error codes under appropriate heading
@@ -49,9 +51,11 @@ enum Status {
 
 // Utility errors
 
+       BADIMPORTREC, BADREQUEST,
+
 // Query errors
 
-       ATTRTYPEMISMATCH, TMP_RES_EXISTS,
+       ATTRTYPEMISMATCH, TMP_RES_EXISTS, VALOVERFLOW,
 
 // do not touch filler -- add codes before it
 
@@ -68,8 +72,8 @@ class Error {
 
 
 #define ASSERT(c)  { if (!(c)) { \
-		       cerr << "At line " << __LINE__ << ":" << endl << "  "; \
-                       cerr << "This condition should hold: " #c << endl; \
+		       LOGERROR("At line " << __LINE__ << ":\n  " \
+				<< "This condition should hold: " #c); \
                        exit(1); \
 		     } \
                    }
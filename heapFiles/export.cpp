@@ -0,0 +1,522 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "export.h"
+#include "error.h"
+
+// columnar export implementation
+
+// ----------------------------------------------------------------------
+// flatbuffer encoding of the Arrow metadata
+// ----------------------------------------------------------------------
+
+// Arrow metadata constants (Schema.fbs, Message.fbs)
+const short ARROWV5 = 4;		// MetadataVersion.V5
+const unsigned char MSGSCHEMA = 1;	// MessageHeader.Schema
+const unsigned char MSGBATCH = 3;	// MessageHeader.RecordBatch
+const unsigned char TYPEINT = 2;	// Type.Int
+const unsigned char TYPEFLOAT = 3;	// Type.FloatingPoint
+const unsigned char TYPEUTF8 = 5;	// Type.Utf8
+const short SINGLEPREC = 1;		// Precision.SINGLE
+
+// A minimal flatbuffer builder.  Like the reference implementation it
+// fills its buffer back to front, so an object is built after the
+// objects it refers to, and identifies objects by their distance from
+// the end of the buffer.  Only one table may be under construction at
+// a time.
+
+class FbBuilder
+{
+public:
+  FbBuilder() : buf(512), head(512), minAlign(1), tableStart(0) {}
+
+  int size() const { return buf.size() - head; }
+  const char* data() const { return buf.data() + head; }
+
+  template<class T> void put(const T v)
+  {
+    align(sizeof(T), 0);
+    memcpy(space(sizeof(T)), &v, sizeof(T));
+  }
+
+  // store a reference to the object at off
+  void putOffset(const int off)
+  {
+    align(4, 0);
+    put<unsigned>(size() + 4 - off);
+  }
+
+  const int string(const char* s)
+  {
+    int len = strlen(s);
+    align(4, len + 1);
+    *space(1) = '\0';
+    memcpy(space(len), s, len);
+    put<unsigned>(len);
+    return size();
+  }
+
+  // push the n elements of a vector in reverse order between these
+  void startVector(const int n, const int elemSize, const int elemAlign)
+  {
+    align(4, n * elemSize);
+    align(elemAlign, n * elemSize);
+  }
+  const int endVector(const int n)
+  {
+    put<unsigned>(n);
+    return size();
+  }
+
+  void startTable()
+  {
+    fields.clear();
+    tableStart = size();
+  }
+  template<class T> void add(const int id, const T v)
+  {
+    put<T>(v);
+    fields.push_back(make_pair(id, size()));
+  }
+  void addOffset(const int id, const int off)
+  {
+    putOffset(off);
+    fields.push_back(make_pair(id, size()));
+  }
+  const int endTable()
+  {
+    put<int>(0);			// offset to vtable, set below
+    int table = size();
+    int numFields = 0;
+    unsigned i;
+
+    for (i = 0; i < fields.size(); i++)
+      if (fields[i].first >= numFields) numFields = fields[i].first + 1;
+    vector<short> vtable(numFields, 0);
+    for (i = 0; i < fields.size(); i++)
+      vtable[fields[i].first] = table - fields[i].second;
+    for (int f = numFields - 1; f >= 0; f--)
+      put<short>(vtable[f]);
+    put<short>(table - tableStart);
+    put<short>(4 + 2 * numFields);
+
+    int vt = size() - table;
+    memcpy(&buf[buf.size() - table], &vt, sizeof vt);
+    return table;
+  }
+
+  void finish(const int root)
+  {
+    align(minAlign > 8 ? minAlign : 8, 4);
+    putOffset(root);
+  }
+
+private:
+  vector<char>	buf;
+  int		head;		// buffer is used from head to the end
+  int		minAlign;	// largest alignment needed so far
+  int		tableStart;
+  vector<pair<int, int> > fields;	// table fields, by id and position
+
+  char* space(const int n)
+  {
+    while (head < n)
+      {
+	int used = size();
+	vector<char> bigger(buf.size() * 2);
+	memcpy(bigger.data() + bigger.size() - used, buf.data() + head, used);
+	buf.swap(bigger);
+	head = buf.size() - used;
+      }
+    head -= n;
+    return buf.data() + head;
+  }
+
+  // pad so that the buffer is aligned to n after extra more bytes
+  void align(const int n, const int extra)
+  {
+    if (n > minAlign) minAlign = n;
+    int pad = (n - (size() + extra) % n) % n;
+    memset(space(pad), 0, pad);
+  }
+};
+
+// finish a Message with the given header and encapsulate it as the
+// IPC format requires: continuation marker, metadata length, metadata
+// padded to 8 bytes
+static void finishMessage(FbBuilder & fb, const unsigned char type,
+                          const int header, const long long bodyLength,
+                          vector<char> & out)
+{
+  fb.startTable();
+  fb.add<long long>(3, bodyLength);
+  fb.addOffset(2, header);
+  fb.add<short>(0, ARROWV5);
+  fb.add<unsigned char>(1, type);
+  fb.finish(fb.endTable());
+
+  int metaLen = (fb.size() + 7) & ~7;
+  int prefix[2] = { -1, metaLen };
+  out.resize(sizeof prefix + metaLen + bodyLength);
+  memcpy(out.data(), prefix, sizeof prefix);
+  memcpy(out.data() + sizeof prefix, fb.data(), fb.size());
+  memset(out.data() + sizeof prefix + fb.size(), 0, metaLen - fb.size());
+}
+
+static void schemaMessage(const vector<AttrDesc> & attrs, vector<char> & out)
+{
+  FbBuilder fb;
+  vector<int> fieldOffs;
+  unsigned i;
+
+  for (i = 0; i < attrs.size(); i++)
+    {
+      const AttrDesc & a = attrs[i];
+      int name = fb.string(a.attrName);
+      unsigned char typeType;
+
+      fb.startTable();
+      if (a.attrType == INTEGER)
+	{
+	  fb.add<int>(0, 32);		// bitWidth
+	  fb.add<char>(1, 1);		// is_signed
+	  typeType = TYPEINT;
+	}
+      else if (a.attrType == FLOAT)
+	{
+	  fb.add<short>(0, SINGLEPREC);
+	  typeType = TYPEFLOAT;
+	}
+      else
+	typeType = TYPEUTF8;
+      int type = fb.endTable();
+
+      fb.startVector(0, 4, 4);
+      int children = fb.endVector(0);
+
+      fb.startTable();
+      fb.addOffset(0, name);
+      fb.addOffset(3, type);
+      fb.addOffset(5, children);
+      fb.add<char>(1, 0);		// nullable
+      fb.add<unsigned char>(2, typeType);
+      fieldOffs.push_back(fb.endTable());
+    }
+
+  fb.startVector(fieldOffs.size(), 4, 4);
+  for (i = fieldOffs.size(); i > 0; i--)
+    fb.putOffset(fieldOffs[i-1]);
+  int fields = fb.endVector(fieldOffs.size());
+
+  fb.startTable();
+  fb.addOffset(1, fields);
+  fb.add<short>(0, 0);			// little endian
+  finishMessage(fb, MSGSCHEMA, fb.endTable(), 0, out);
+}
+
+
+// ----------------------------------------------------------------------
+// record batches
+// ----------------------------------------------------------------------
+
+// a heap file opened for export; hands its pages to the converters
+class ExportFile : public HeapFile
+{
+public:
+  ExportFile(const string & name, Status & status) : HeapFile(name, status) {}
+
+  File* file() const { return filePtr; }
+};
+
+// add a buffer of the body to the batch metadata, padded to 8 bytes
+static void addBuffer(vector<long long> & buffers, long long & bodyLen,
+                      const long long len)
+{
+  buffers.push_back(bodyLen);
+  buffers.push_back(len);
+  bodyLen += (len + 7) & ~7;
+}
+
+// convert the records on data pages pageNos[first..last) into one
+// encapsulated record batch message
+static const Status convertBatch(File* file, const vector<int> & pageNos,
+                                 const int first, const int last,
+                                 const vector<AttrDesc> & attrs,
+                                 vector<char> & out, int & recCnt)
+{
+  Status status;
+  vector<vector<char> > values(attrs.size());
+  vector<vector<int> > offsets(attrs.size());
+  unsigned i;
+  int n = 0;
+
+  for (i = 0; i < attrs.size(); i++)
+    if (attrs[i].attrType == STRING) offsets[i].push_back(0);
+
+  for (int p = first; p < last; p++)
+    {
+      Page* page;
+      RID rid, nextRid;
+      Record rec;
+
+      if ((status = bufMgr->readPage(file, pageNos[p], page)) != OK)
+	return status;
+      status = page->firstRecord(rid);
+      while (status == OK)
+	{
+	  page->getRecord(rid, rec);
+	  for (i = 0; i < attrs.size(); i++)
+	    {
+	      const char* f = (const char*) rec.data + attrs[i].attrOffset;
+	      if (attrs[i].attrType == STRING)
+		{
+		  int len = strnlen(f, attrs[i].attrLen);
+		  values[i].insert(values[i].end(), f, f + len);
+		  offsets[i].push_back(values[i].size());
+		}
+	      else
+		values[i].insert(values[i].end(), f, f + attrs[i].attrLen);
+	    }
+	  n++;
+	  status = page->nextRecord(rid, nextRid);
+	  rid = nextRid;
+	}
+      if ((status = bufMgr->unPinPage(file, pageNos[p], false)) != OK)
+	return status;
+    }
+
+  // body: validity bitmap (empty, no nulls), then the offsets of a
+  // utf8 column, then its values
+  vector<long long> buffers;
+  long long bodyLen = 0;
+  for (i = 0; i < attrs.size(); i++)
+    {
+      addBuffer(buffers, bodyLen, 0);
+      if (attrs[i].attrType == STRING)
+	addBuffer(buffers, bodyLen, offsets[i].size() * sizeof(int));
+      addBuffer(buffers, bodyLen, values[i].size());
+    }
+
+  FbBuilder fb;
+  fb.startVector(attrs.size(), 16, 8);
+  for (i = attrs.size(); i > 0; i--)
+    {
+      fb.put<long long>(0);		// null_count
+      fb.put<long long>(n);		// length
+    }
+  int nodes = fb.endVector(attrs.size());
+
+  int numBuffers = buffers.size() / 2;
+  fb.startVector(numBuffers, 16, 8);
+  for (int b = numBuffers - 1; b >= 0; b--)
+    {
+      fb.put<long long>(buffers[2*b+1]);	// length
+      fb.put<long long>(buffers[2*b]);	// offset
+    }
+  int bufs = fb.endVector(numBuffers);
+
+  fb.startTable();
+  fb.add<long long>(0, n);
+  fb.addOffset(1, nodes);
+  fb.addOffset(2, bufs);
+  finishMessage(fb, MSGBATCH, fb.endTable(), bodyLen, out);
+
+  char* body = out.data() + out.size() - bodyLen;
+  int b = 0;
+  memset(body, 0, bodyLen);
+  for (i = 0; i < attrs.size(); i++)
+    {
+      b++;				// validity bitmap
+      if (attrs[i].attrType == STRING)
+	{
+	  memcpy(body + buffers[2*b], &offsets[i][0], buffers[2*b+1]);
+	  b++;
+	}
+      if (!values[i].empty())
+	memcpy(body + buffers[2*b], &values[i][0], buffers[2*b+1]);
+      b++;
+    }
+
+  recCnt = n;
+  return OK;
+}
+
+
+// ----------------------------------------------------------------------
+// export driver
+// ----------------------------------------------------------------------
+
+// batches handed from the converting threads to the writer
+struct ExportState
+{
+  mutex			mtx;
+  condition_variable	cond;
+  int			next;		// next batch to convert
+  int			written;	// batches written
+  bool			failed;
+  Status		status;
+  vector<vector<char> >	batches;
+  vector<char>		ready;
+  vector<int>		recCnts;
+};
+
+static void converter(ExportState* st, File* file,
+                      const vector<int> & pageNos,
+                      const vector<AttrDesc> & attrs)
+{
+  int numBatches = st->batches.size();
+  unique_lock<mutex> lk(st->mtx);
+
+  while (true)
+    {
+      st->cond.wait(lk, [st, numBatches]() {
+	  return st->failed || st->next >= numBatches ||
+	         st->next < st->written + EXPORTWINDOW; });
+      if (st->failed || st->next >= numBatches) return;
+      int b = st->next++;
+      lk.unlock();
+
+      vector<char> out;
+      int recCnt = 0;
+      int last = (b + 1) * EXPORTBATCHPAGES;
+      if (last > (int) pageNos.size()) last = pageNos.size();
+      Status status = convertBatch(file, pageNos, b * EXPORTBATCHPAGES,
+                                   last, attrs, out, recCnt);
+
+      lk.lock();
+      if (status != OK)
+	{
+	  st->failed = true;
+	  st->status = status;
+	}
+      else
+	{
+	  st->batches[b].swap(out);
+	  st->recCnts[b] = recCnt;
+	  st->ready[b] = 1;
+	}
+      st->cond.notify_all();
+    }
+}
+
+static const bool writeAll(const int fd, const char* p, size_t n)
+{
+  while (n > 0)
+    {
+      ssize_t written = ::write(fd, p, n);
+      if (written < 0)
+	{
+	  if (errno == EINTR) continue;
+	  return false;
+	}
+      p += written;
+      n -= written;
+    }
+  return true;
+}
+
+static const Status exportTo(const string & relName, const int fd,
+                             const int threads, int & recCnt, size_t & size)
+{
+  Status status;
+  vector<AttrDesc> attrs;
+  vector<int> pageNos;
+  vector<char> out;
+  int i;
+
+  recCnt = 0;
+  size = 0;
+  if (relCat == NULL) return BADCATPARM;
+  if ((status = relCat->getRelAttrs(relName, attrs)) != OK) return status;
+
+  ExportFile hf(relName, status);
+  if (status != OK) return status;
+  if ((status = hf.getPageNos(pageNos)) != OK) return status;
+
+  schemaMessage(attrs, out);
+  if (!writeAll(fd, out.data(), out.size())) return UNIXERR;
+  size += out.size();
+
+  ExportState st;
+  int numBatches = (pageNos.size() + EXPORTBATCHPAGES - 1) / EXPORTBATCHPAGES;
+  st.next = st.written = 0;
+  st.failed = false;
+  st.status = OK;
+  st.batches.resize(numBatches);
+  st.ready.resize(numBatches, 0);
+  st.recCnts.resize(numBatches, 0);
+
+  vector<thread> converters;
+  for (i = 0; i < (threads < 1 ? 1 : threads); i++)
+    converters.push_back(thread(converter, &st, hf.file(),
+                                cref(pageNos), cref(attrs)));
+
+  // write the batches in page order as they are finished
+  for (int b = 0; b < numBatches; b++)
+    {
+      unique_lock<mutex> lk(st.mtx);
+      st.cond.wait(lk, [&st, b]() { return st.failed || st.ready[b]; });
+      if (st.failed) break;
+      out.swap(st.batches[b]);
+      lk.unlock();
+
+      bool ok = writeAll(fd, out.data(), out.size());
+      size += out.size();
+      vector<char>().swap(out);
+
+      lk.lock();
+      if (!ok)
+	{
+	  st.failed = true;
+	  st.status = UNIXERR;
+	}
+      recCnt += st.recCnts[b];
+      st.written++;
+      st.cond.notify_all();
+      if (!ok) break;
+    }
+
+  for (i = 0; i < (int) converters.size(); i++)
+    converters[i].join();
+  if (st.failed) return st.status;
+
+  int eos[2] = { -1, 0 };
+  if (!writeAll(fd, (const char*) eos, sizeof eos)) return UNIXERR;
+  size += sizeof eos;
+  return OK;
+}
+
+
+const Status exportRel(const string & relName,
+                       const string & fileName,
+                       const int threads,
+                       int & recCnt)
+{
+  size_t size;
+  int fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) return UNIXERR;
+
+  Status status = exportTo(relName, fd, threads, recCnt, size);
+  if (::close(fd) < 0 && status == OK) status = UNIXERR;
+  return status;
+}
+
+const Status exportRelShm(const string & relName,
+                          const string & shmName,
+                          const int threads,
+                          size_t & size)
+{
+  int recCnt;
+  int fd = shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) return UNIXERR;
+
+  Status status = exportTo(relName, fd, threads, recCnt, size);
+  ::close(fd);
+  return status;
+}
@@ -0,0 +1,41 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include "catalog.h"
+
+// Columnar export.
+//
+// A catalog relation is written in the Arrow IPC streaming format: a
+// schema message followed by one record batch per EXPORTBATCHPAGES
+// data pages, each encapsulated as Arrow requires (continuation
+// marker, metadata length, flatbuffer metadata, 8 byte aligned body)
+// and an end of stream marker.  INTEGER attributes become int32
+// columns, FLOAT attributes float32 columns and STRING attributes utf8
+// columns holding the characters before the first NUL.  No column has
+// nulls.
+//
+// Batches are converted by several threads, each taking the next page
+// range in turn, and written in page order with one write per batch.
+// The stream can go to a file or to a POSIX shared memory object,
+// which a consumer on the same machine maps to use the columns in
+// place.
+
+const int EXPORTBATCHPAGES = 256;	// data pages per record batch
+const int EXPORTWINDOW = 8;		// batches converted ahead of the writer
+
+// write relation relName to file fileName using the given number of
+// threads.  recCnt is set to the number of records written
+const Status exportRel(const string & relName,
+                       const string & fileName,
+                       const int threads,
+                       int & recCnt);
+
+// same, but into shared memory object shmName (as for shm_open).  size
+// is set to the length of the stream.  the object is left for the
+// consumer to remove with shm_unlink
+const Status exportRelShm(const string & relName,
+                          const string & shmName,
+                          const int threads,
+                          size_t & size);
+
+#endif
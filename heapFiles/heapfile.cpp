@@ -1,8 +1,43 @@
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "heapfile.h"
+#include "catalog.h"
+#include "changes.h"
+#include "aggview.h"
+#include "scancache.h"
 #include "error.h"
 
+// Latches of the header pages, one per open File object.  The heap
+// files open on a file share its header page, and update its counts
+// and page chain fields under the latch.  Latches are never freed: a
+// heap file may hold one for as long as it is open.
+
+static mutex latchesMutex;		// guards hdrLatches
+static map<File*, mutex*> hdrLatches;
+
+static mutex* headerLatch(File* file)
+{
+    lock_guard<mutex> lk(latchesMutex);
+    mutex*& latch = hdrLatches[file];
+    if (latch == NULL) latch = new mutex;
+    return latch;
+}
+
 // routine to create a heapfile
 const Status createHeapFile(const string fileName)
+{
+    return createHeapFile(fileName, 0);
+}
+
+// allocate and initialize the header page and first data page of
+// a newly created (empty) file, then close it
+
+static const Status initHeapFile(const string & fileName, const int pageFlags)
 {
     File* 		file;
     Status 		status;
@@ -11,33 +46,82 @@ const Status createHeapFile(const string fileName)
     int			newPageNo;
     Page*		newPage;
 
+    status = db.openFile(fileName, file);
+    if (status != OK) return status;
+
+    // allocate and initialize the header page
+    status = bufMgr->allocPage(file, hdrPageNo, newPage);
+    if (status != OK) return status;
+    hdrPage = (FileHdrPage*) newPage;
+    memset(hdrPage, 0, sizeof(FileHdrPage));
+    strncpy(hdrPage->fileName, fileName.c_str(), MAXNAMESIZE - 1);
+    hdrPage->pageFlags = pageFlags;
+
+    // allocate and initialize the first data page
+    status = bufMgr->allocPage(file, newPageNo, newPage);
+    if (status != OK) return status;
+    newPage->init(newPageNo, pageFlags);
+
+    hdrPage->firstPage = newPageNo;
+    hdrPage->lastPage  = newPageNo;
+    hdrPage->pageCnt   = 1;
+    hdrPage->recCnt    = 0;
+
+    // unpin both pages, marking them dirty, and close the file
+    status = bufMgr->unPinPage(file, hdrPageNo, true);
+    if (status != OK) return status;
+    status = bufMgr->unPinPage(file, newPageNo, true);
+    if (status != OK) return status;
+
+    return db.closeFile(file);
+}
+
+// routine to create a heapfile whose data pages use the given layout
+// flags (e.g. PAGE_ALIGNED)
+const Status createHeapFile(const string fileName, const int pageFlags)
+{
+    File* 		file;
+    Status 		status;
+
     // try to open the file. This should return an error
     status = db.openFile(fileName, file);
     if (status != OK)
     {
 		// file doesn't exist. First create it and allocate
 		// an empty header page and data page.
-		
-		
-		
-		
-		
-		
-		
-		
-		
-		
-		
-		
-		
+		status = db.createFile(fileName);
+		if (status != OK) return status;
+
+		return initHeapFile(fileName, pageFlags);
     }
+    db.closeFile(file);
     return (FILEEXISTS);
 }
 
+// routine to create a temporary heapfile. It is kept in memory (see
+// DB::createTempFile) and is used through the same scan classes as
+// any other heapfile until destroyHeapFile is called.
+const Status createTempHeapFile(const string fileName)
+{
+    Status 		status;
+
+    status = db.createTempFile(fileName);
+    if (status != OK) return status;
+
+    return initHeapFile(fileName, 0);
+}
+
 // routine to destroy a heapfile
 const Status destroyHeapFile(const string fileName)
 {
-	return (db.destroyFile (fileName));
+	Status status;
+
+	// the catalog may be holding the file open
+	if (relCat != NULL) relCat->release(fileName);
+	dropCachedScans(fileName);
+	if ((status = db.destroyFile (fileName)) != OK) return status;
+	destroyChangeLog(fileName);
+	return OK;
 }
 
 // constructor opens the underlying file
@@ -46,14 +130,26 @@ HeapFile::HeapFile(const string & fileName, Status& returnStatus)
     Status 	status;
     Page*	pagePtr;
 
-    cout << "opening file " << fileName << endl;
+    curPage = NULL;
+    headerPage = NULL;
+    hdrLatch = NULL;
+    changes = NULL;
+    views = NULL;
+    stamps = NULL;
+
+    LOGDEBUG("opening file " << fileName);
 
     // open the file and read in the header page and the first data page
     if ((status = db.openFile(fileName, filePtr)) == OK)
     {
-	// Gets page number of header page
-	returnStatus = filePtr->getFirstPage(headerPageNo);
-	if (returnStatus != OK) return;
+	// Gets page number of header page. The catalog remembers it for
+	// the relations it knows, so no read of the DB header is needed
+	if (relCat == NULL ||
+	    relCat->getHeaderPage(fileName, headerPageNo) != OK)
+	{
+	    returnStatus = filePtr->getFirstPage(headerPageNo);
+	    if (returnStatus != OK) return;
+	}
 
 	// Reads header page
 	returnStatus = bufMgr->readPage(filePtr, headerPageNo, pagePtr);
@@ -61,6 +157,7 @@ HeapFile::HeapFile(const string & fileName, Status& returnStatus)
 
 	// Initialize protected data members
 	headerPage   = (FileHdrPage*) pagePtr;
+	hdrLatch     = headerLatch(filePtr);
 	hdrDirtyFlag = false;
 
 	// Read first data page
@@ -71,10 +168,14 @@ HeapFile::HeapFile(const string & fileName, Status& returnStatus)
 	// Finish Initializing protected data members
 	curDirtyFlag = false;
 	curRec       = NULLRID;
+	changes      = ChangeLog::open(fileName);
+	views        = AggViews::of(fileName);
+	stamps       = PageStamps::of(fileName);
     }
     else
     {
-    	cerr << "open of heap file failed\n";
+	LOGERROR("open of heap file " << fileName << " failed");
+		filePtr = NULL;
 		returnStatus = status;
 		return;
     }
@@ -84,7 +185,8 @@ HeapFile::HeapFile(const string & fileName, Status& returnStatus)
 HeapFile::~HeapFile()
 {
     Status status;
-    cout << "invoking heapfile destructor on file " << headerPage->fileName << endl;
+    if (headerPage != NULL)
+	LOGDEBUG("invoking heapfile destructor on file " << headerPage->fileName);
 
     // see if there is a pinned data page. If so, unpin it 
     if (curPage != NULL)
@@ -93,20 +195,25 @@ HeapFile::~HeapFile()
 		curPage = NULL;
 		curPageNo = 0;
 		curDirtyFlag = false;
-		if (status != OK) cerr << "error in unpin of date page\n";
+		if (status != OK) LOGERROR("error in unpin of data page");
     }
 	
 	 // unpin the header page
-    status = bufMgr->unPinPage(filePtr, headerPageNo, hdrDirtyFlag);
-    if (status != OK) cerr << "error in unpin of header page\n";
+    if (headerPage != NULL)
+    {
+	status = bufMgr->unPinPage(filePtr, headerPageNo, hdrDirtyFlag);
+	if (status != OK) LOGERROR("error in unpin of header page");
+    }
 	
 	// status = bufMgr->flushFile(filePtr);  // make sure all pages of the file are flushed to disk
 	// if (status != OK) cerr << "error in flushFile call\n";
-	// before close the file
+	// before close the file; there is none if the open failed
+	if (filePtr == NULL) return;
+	if (changes != NULL) changes->release();
 	status = db.closeFile(filePtr);
     if (status != OK)
     {
-		cerr << "error in closefile call\n";
+		LOGERROR("error in closefile call");
 		Error e;
 		e.print (status);
     }
@@ -116,9 +223,18 @@ HeapFile::~HeapFile()
 
 const int HeapFile::getRecCnt() const
 {
+  lock_guard<mutex> lk(*hdrLatch);
   return headerPage->recCnt;
 }
 
+// Return modification count of heap file
+
+const int HeapFile::getModCnt() const
+{
+  lock_guard<mutex> lk(*hdrLatch);
+  return headerPage->modCnt;
+}
+
 // retrieve an arbitrary record from a file.
 // if record is not on the currently pinned page, the current page
 // is unpinned and the required page is read into the buffer pool
@@ -129,17 +245,21 @@ const Status HeapFile::getRecord(const RID &  rid, Record & rec)
 	Status status;
 
 	// If record is not on the currently pinned page
-	if (rid.pageNo != curPageNo) {
+	if (curPage == NULL || rid.pageNo != curPageNo) {
 		// Unpin current page
-		status = unPinPage(filePtr, curPageNo, curDirtyFlag);
-		if (status != OK) return status;
+		if (curPage != NULL)
+		{
+			status = bufMgr->unPinPage(filePtr, curPageNo, curDirtyFlag);
+			curPage = NULL;
+			if (status != OK) return status;
+		}
 		
 		// Cleanup curPage vars
 		curDirtyFlag = false;
 
 		// Read the required page
 		status = bufMgr->readPage(filePtr, rid.pageNo, curPage);
-		if (status != OK) returns status;
+		if (status != OK) { curPage = NULL; return status; }
 
 		// Pin the reqired page
 		curPageNo = rid.pageNo;
@@ -155,10 +275,43 @@ const Status HeapFile::getRecord(const RID &  rid, Record & rec)
 	return status;
 }
 
+// follow the page chain from the first data page to the last
+const Status HeapFile::getPageNos(vector<int> & pageNos)
+{
+    Status status;
+    Page* page;
+    int pageNo = headerPage->firstPage;
+
+    while (pageNo != -1)
+    {
+        pageNos.push_back(pageNo);
+        if ((status = bufMgr->readPage(filePtr, pageNo, page)) != OK)
+            return status;
+        page->getNextPage(pageNo);
+        if ((status = bufMgr->unPinPage(filePtr, pageNos.back(), false)) != OK)
+            return status;
+    }
+    return OK;
+}
+
+// Where the synchronized scans of a file are.  A scan records each
+// page it moves to; a new scan starts on the last page recorded.
+struct ScanSync
+{
+    int		pageNo;		// page a scan last moved to
+    int		scans;		// synchronized scans running
+};
+
+static mutex syncMutex;			// guards syncs
+static map<File*, ScanSync> syncs;
+
 HeapFileScan::HeapFileScan(const string & name,
 			   Status & status) : HeapFile(name, status)
 {
     filter = NULL;
+    sync = syncing = wrapped = false;
+    syncStart = -1;
+    limit = returned = 0;
 }
 
 const Status HeapFileScan::startScan(const int offset_,
@@ -167,16 +320,19 @@ const Status HeapFileScan::startScan(const int offset_,
 				     const char* filter_,
 				     const Operator op_)
 {
+    returned = 0;
     if (!filter_) {                        // no filtering requested
         filter = NULL;
-        return OK;
+        return sync ? syncBegin() : OK;
     }
     
     if ((offset_ < 0 || length_ < 1) ||
         (type_ != STRING && type_ != INTEGER && type_ != FLOAT) ||
         ((type_ == INTEGER && length_ != sizeof(int))
          || (type_ == FLOAT && length_ != sizeof(float))) ||
-        (op_ != LT && op_ != LTE && op_ != EQ && op_ != GTE && op_ != GT && op_ != NE))
+        (op_ != LT && op_ != LTE && op_ != EQ && op_ != GTE && op_ != GT && op_ != NE &&
+         op_ != PREFIX && op_ != SUFFIX && op_ != SUBSTR && op_ != LIKE) ||
+        (op_ >= PREFIX && type_ != STRING))
     {
         return BADSCANPARM;
     }
@@ -187,13 +343,95 @@ const Status HeapFileScan::startScan(const int offset_,
     filter = filter_;
     op = op_;
 
+    // convert numeric filters once rather than on every record
+    if (type == INTEGER) memcpy(&ifilter, filter, sizeof(int));
+    else if (type == FLOAT) memcpy(&ffilter, filter, sizeof(float));
+
+    // split a LIKE pattern at its %s once
+    if (op >= PREFIX) pattern.assign(filter, strnlen(filter, length));
+    if (op == LIKE)
+    {
+        segments.clear();
+        size_t start = 0, pct;
+        while ((pct = pattern.find('%', start)) != string::npos)
+        {
+            segments.push_back(pattern.substr(start, pct - start));
+            start = pct + 1;
+        }
+        segments.push_back(pattern.substr(start));
+    }
+
+    return sync ? syncBegin() : OK;
+}
+
+// an IN scan is an EQ scan whose filter values are looked up in a set
+const Status HeapFileScan::startScan(const int offset_,
+				     const int length_,
+				     const Datatype type_,
+				     const char* values_,
+				     const int valueCnt_)
+{
+    Status status;
+
+    if (values_ == NULL || valueCnt_ < 1) return BADSCANPARM;
+    if ((status = HeapFileScan::startScan(offset_, length_, type_,
+                                          values_, EQ)) != OK)
+        return status;
+    inSet.build(type, length, values_, valueCnt_);
+    op = IN;
     return OK;
 }
 
+// join the synchronized scans of the file: move to the page they are
+// on, or to the first page if there are none
+
+const Status HeapFileScan::syncBegin()
+{
+    Status	status;
+    int		startPageNo;
+
+    syncEnd();
+    {
+        lock_guard<mutex> lk(syncMutex);
+        ScanSync & s = syncs[filePtr];
+        if (s.scans == 0) s.pageNo = headerPage->firstPage;
+        startPageNo = s.pageNo;
+        s.scans++;
+    }
+    syncing = true;
+    syncStart = startPageNo;
+    wrapped = startPageNo == headerPage->firstPage;   // nothing to wrap to
+    curRec = NULLRID;
+
+    if (curPage != NULL && curPageNo == startPageNo) return OK;
+    if (curPage != NULL)
+    {
+        status = bufMgr->unPinPage(filePtr, curPageNo, curDirtyFlag);
+        curPage = NULL;
+        if (status != OK) return status;
+    }
+    curPageNo = startPageNo;
+    curDirtyFlag = false;
+    status = bufMgr->readPage(filePtr, curPageNo, curPage);
+    if (status != OK) curPage = NULL;
+    return status;
+}
+
+void HeapFileScan::syncEnd()
+{
+    if (!syncing) return;
+    syncing = false;
+
+    lock_guard<mutex> lk(syncMutex);
+    map<File*, ScanSync>::iterator it = syncs.find(filePtr);
+    if (it != syncs.end() && --it->second.scans == 0) syncs.erase(it);
+}
+
 
 const Status HeapFileScan::endScan()
 {
     Status status;
+    syncEnd();
     // generally must unpin last page of the scan
     if (curPage != NULL)
     {
@@ -242,24 +480,95 @@ const Status HeapFileScan::resetScan()
 }
 
 
+const Status HeapFileScan::pastLimit()
+{
+    Status status;
+
+    // enough records: give up the page rather than read on
+    if (limit <= 0 || returned < limit) return OK;
+    status = endScan();
+    return status != OK ? status : FILEEOF;
+}
+
+const Status HeapFileScan::nextScanPage()
+{
+    Status	status;
+    int		nextPageNo;
+
+    if (curPage == NULL)
+        nextPageNo = headerPage->firstPage;
+    else
+    {
+        curPage->getNextPage(nextPageNo);
+        if (nextPageNo == -1)
+        {
+            // a synchronized scan goes on from the first page up
+            // to the page it began on
+            if (!syncing || wrapped) return FILEEOF;
+            nextPageNo = headerPage->firstPage;
+            wrapped = true;
+        }
+        if (syncing && wrapped && nextPageNo == syncStart) return FILEEOF;
+
+        status = bufMgr->unPinPage(filePtr, curPageNo, curDirtyFlag);
+        curPage = NULL;
+        if (status != OK) return status;
+    }
+
+    curPageNo = nextPageNo;
+    curDirtyFlag = false;
+    curRec = NULLRID;
+    status = bufMgr->readPage(filePtr, curPageNo, curPage);
+    if (status != OK) { curPage = NULL; return status; }
+    if (syncing)
+    {
+        lock_guard<mutex> lk(syncMutex);
+        syncs[filePtr].pageNo = curPageNo;
+    }
+    return OK;
+}
+
 const Status HeapFileScan::scanNext(RID& outRid)
 {
     Status 	status = OK;
     RID		nextRid;
     RID		tmpRid;
-    int 	nextPageNo;
     Record      rec;
 
-    
-	
-	
-	
-	
-	
-	
-	
-	
-	
+    if ((status = pastLimit()) != OK) return status;
+
+    // a scan that was ended restarts from the first data page
+    if (curPage == NULL && (status = nextScanPage()) != OK) return status;
+
+    // find the candidate following the last record returned
+    if (curRec.pageNo == NULLRID.pageNo && curRec.slotNo == NULLRID.slotNo)
+        status = curPage->firstRecord(tmpRid);
+    else
+        status = curPage->nextRecord(curRec, tmpRid);
+
+    while (true)
+    {
+        // move on to the next page when this one is exhausted
+        while (status != OK)
+        {
+            if ((status = nextScanPage()) != OK) return status;
+            status = curPage->firstRecord(tmpRid);
+        }
+
+        // check the candidate against the filter
+        status = curPage->getRecord(tmpRid, rec);
+        if (status != OK) return status;
+        if (matchRec(rec))
+        {
+            curRec = tmpRid;
+            outRid = tmpRid;
+            counted();
+            return OK;
+        }
+
+        nextRid = tmpRid;
+        status = curPage->nextRecord(nextRid, tmpRid);
+    }
 }
 
 
@@ -275,25 +584,172 @@ const Status HeapFileScan::getRecord(Record & rec)
 const Status HeapFileScan::deleteRecord()
 {
     Status status;
+    Record rec;
+    vector<char> copy;
+
+    // keep the record for the log and the views; they hear of the
+    // delete only once it is done
+    bool keep = (changes != NULL && changes->logging()) ||
+                (views != NULL && views->any());
+    if (keep)
+    {
+        if ((status = curPage->getRecord(curRec, rec)) != OK) return status;
+        copy.assign((char*) rec.data, (char*) rec.data + rec.length);
+        rec.data = copy.empty() ? NULL : &copy[0];
+    }
 
     // delete the "current" record from the page
-    status = curPage->deleteRecord(curRec);
+    if ((status = curPage->deleteRecord(curRec)) != OK) return status;
     curDirtyFlag = true;
 
     // reduce count of number of records in the file
-    headerPage->recCnt--;
-    hdrDirtyFlag = true; 
-    return status;
+    {
+        lock_guard<mutex> lk(*hdrLatch);
+        headerPage->recCnt--;
+        headerPage->modCnt++;
+        hdrDirtyFlag = true;
+    }
+    if (stamps != NULL) stamps->changed(curPageNo, 1);
+
+    if (!keep) return OK;
+    if (views != NULL) views->deleted(rec);
+    if (changes != NULL) return changes->append(CHGDELETE, curRec, rec);
+    return OK;
 }
 
 
 // mark current page of scan dirty
 const Status HeapFileScan::markDirty()
 {
+    // the caller updated the current record in place
     curDirtyFlag = true;
+    {
+        lock_guard<mutex> lk(*hdrLatch);
+        headerPage->modCnt++;
+        hdrDirtyFlag = true;
+    }
+    if (stamps != NULL) stamps->changed(curPageNo, 1);
     return OK;
 }
 
+// The page numbers are collected first; the threads then take pages
+// in turn through a shared index, as the tasks of topK do, and read
+// them at the same time.  Of each page a thread collects the records
+// to delete, with copies of them when there is a log or a view, and
+// deletes them all with Page::deleteRecords.  Only once that is done
+// are the copies taken out of the views and logged; a record that
+// cannot be logged stops the deletion of the pages not yet taken.
+
+const Status HeapFileScan::deleteWhere(int & deleted,
+                                       const int threads,
+                                       const function<bool(const Record &)> & pred)
+{
+    Status status;
+    vector<int> pageNos;
+
+    deleted = 0;
+    if ((status = endScan()) != OK) return status;
+    if ((status = getPageNos(pageNos)) != OK) return status;
+
+    atomic<int> next(0);		// index of next page to take
+    mutex errMutex;			// guards firstError
+    Status firstError = OK;
+    atomic<int> total(0);
+    auto deleter = [&]() {
+        RID rids[PAGESIZE / sizeof(slot_t)];	// more than a page can hold
+        vector<char> copies;			// the records, one after another
+        vector<int> ends;			// end of each in copies
+        bool keep = (changes != NULL && changes->logging()) ||
+                    (views != NULL && views->any());
+        Status status = OK;
+        int p;
+
+        while (status == OK && (p = next++) < (int) pageNos.size())
+        {
+            Page* page;
+            int pageNo = pageNos[p];
+            RID rid, prevRid;
+            Record rec;
+            Status recStatus;
+
+            if ((status = bufMgr->readPage(filePtr, pageNo, page)) != OK) break;
+
+            int n = 0;
+            copies.clear();
+            ends.clear();
+            recStatus = page->firstRecord(rid);
+            while (recStatus == OK)
+            {
+                page->getRecord(rid, rec);
+                if (matchRec(rec) && (!pred || pred(rec)))
+                {
+                    if (keep)
+                    {
+                        copies.insert(copies.end(), (char*) rec.data,
+                                      (char*) rec.data + rec.length);
+                        ends.push_back(copies.size());
+                    }
+                    rids[n++] = rid;
+                }
+                prevRid = rid;
+                recStatus = page->nextRecord(prevRid, rid);
+            }
+
+            Status delStatus = OK;
+            if (n > 0)
+            {
+                delStatus = page->deleteRecords(rids, n);
+                if (delStatus == OK)
+                {
+                    total += n;
+                    if (stamps != NULL) stamps->changed(pageNo, n);
+                }
+            }
+            Status unpinStatus = bufMgr->unPinPage(filePtr, pageNo, n > 0);
+            status = delStatus;
+            if (status == OK) status = unpinStatus;
+
+            // the deletes are done; tell the views and the log
+            for (int i = 0; delStatus == OK && keep && i < n; i++)
+            {
+                int start = i == 0 ? 0 : ends[i - 1];
+                rec.data = ends[i] == start ? NULL : &copies[start];
+                rec.length = ends[i] - start;
+                if (views != NULL) views->deleted(rec);
+                if (changes != NULL && status == OK)
+                    status = changes->append(CHGDELETE, rids[i], rec);
+            }
+        }
+        if (status != OK)
+        {
+            lock_guard<mutex> lk(errMutex);
+            if (firstError == OK) firstError = status;
+            next = pageNos.size();	// stop the others
+        }
+    };
+
+    if (threads <= 1) deleter();
+    else
+    {
+        vector<thread> deleters;
+        for (int i = 0; i < threads; i++)
+            deleters.push_back(thread(deleter));
+        for (int i = 0; i < threads; i++)
+            deleters[i].join();
+    }
+
+    // one update of the counts for all pages
+    deleted = total;
+    if (deleted > 0)
+    {
+        lock_guard<mutex> lk(*hdrLatch);
+        headerPage->recCnt -= deleted;
+        headerPage->modCnt += deleted;
+        hdrDirtyFlag = true;
+    }
+    return firstError;
+}
+
 const bool HeapFileScan::matchRec(const Record & rec) const
 {
     // no filtering requested
@@ -305,32 +761,34 @@ const bool HeapFileScan::matchRec(const Record & rec) const
 	return false;
 
     float diff = 0;                       // < 0 if attr < fltr
+    const char* attr = (char *)rec.data + offset;
+    if (op == IN) return inSet.contains(attr);
+    if (op >= PREFIX) return matchPattern(attr);
+
     switch(type) {
 
     case INTEGER:
-        int iattr, ifltr;                 // word-alignment problem possible
-        memcpy(&iattr,
-               (char *)rec.data + offset,
-               length);
-        memcpy(&ifltr,
-               filter,
-               length);
-        diff = iattr - ifltr;
+        int iattr;
+        // records on aligned pages can be loaded directly, otherwise
+        // the attribute may straddle a word boundary
+        if (((long) attr & (sizeof(int) - 1)) == 0)
+            iattr = *(const int*) attr;
+        else
+            memcpy(&iattr, attr, sizeof(int));
+        diff = iattr - ifilter;
         break;
 
     case FLOAT:
-        float fattr, ffltr;               // word-alignment problem possible
-        memcpy(&fattr,
-               (char *)rec.data + offset,
-               length);
-        memcpy(&ffltr,
-               filter,
-               length);
-        diff = fattr - ffltr;
+        float fattr;
+        if (((long) attr & (sizeof(float) - 1)) == 0)
+            fattr = *(const float*) attr;
+        else
+            memcpy(&fattr, attr, sizeof(float));
+        diff = fattr - ffilter;
         break;
 
     case STRING:
-        diff = strncmp((char *)rec.data + offset,
+        diff = strncmp(attr,
                        filter,
                        length);
         break;
@@ -343,58 +801,402 @@ const bool HeapFileScan::matchRec(const Record & rec) const
     case GTE: if (diff >= 0.0) return true; break;
     case GT:  if (diff > 0.0) return true; break;
     case NE:  if (diff != 0.0) return true; break;
+    default:  break;
     }
 
     return false;
 }
 
+// true if the m bytes at a equal pat; with like set, _ in pat equals
+// any byte
+static inline bool sameBytes(const char* a, const char* pat, const int m,
+                             const bool like)
+{
+    for (int k = 0; k < m; k++)
+        if (a[k] != pat[k] && !(like && pat[k] == '_')) return false;
+    return true;
+}
+
+// position of the first occurrence of pat (m bytes) in the n bytes at
+// hay, or -1.  Candidates are found 16 positions at a time by comparing
+// the first and last bytes of pat; only they are compared in full
+static int findBytes(const char* hay, const int n, const char* pat,
+                     const int m, const bool like)
+{
+    int i = 0;
+
+    if (m == 0) return 0;
+#ifdef __SSE2__
+    if (!like || (pat[0] != '_' && pat[m-1] != '_'))
+    {
+        const __m128i first = _mm_set1_epi8(pat[0]);
+        const __m128i last = _mm_set1_epi8(pat[m-1]);
+        for (; i + m - 1 + 16 <= n; i += 16)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i*) (hay + i));
+            __m128i b = _mm_loadu_si128((const __m128i*) (hay + i + m - 1));
+            unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first),
+                                                            _mm_cmpeq_epi8(b, last)));
+            while (mask != 0)
+            {
+                int at = i + __builtin_ctz(mask);
+                if (sameBytes(hay + at, pat, m, like)) return at;
+                mask &= mask - 1;
+            }
+        }
+    }
+#endif
+    for (; i + m <= n; i++)
+        if (sameBytes(hay + i, pat, m, like)) return i;
+    return -1;
+}
+
+// match the value of a STRING attribute against the pattern of a
+// PREFIX, SUFFIX, SUBSTR or LIKE scan.  A LIKE pattern is matched
+// piece by piece: the first piece at the start, the last at the end and
+// each one between at its first occurrence after the one before, which
+// is right because % matches any sequence
+const bool HeapFileScan::matchPattern(const char* attr) const
+{
+    int n = strnlen(attr, length);
+    int m = pattern.size();
+
+    switch (op) {
+    case PREFIX: return n >= m && memcmp(attr, pattern.data(), m) == 0;
+    case SUFFIX: return n >= m && memcmp(attr + n - m, pattern.data(), m) == 0;
+    case SUBSTR: return findBytes(attr, n, pattern.data(), m, false) >= 0;
+    default:     break;
+    }
+
+    const string & head = segments.front();
+    if (n < (int) head.size() || !sameBytes(attr, head.data(), head.size(), true))
+        return false;
+    if (segments.size() == 1) return n == (int) head.size();
+
+    const string & tail = segments.back();
+    int pos = head.size();
+    int end = n - tail.size();
+    if (end < pos || !sameBytes(attr + end, tail.data(), tail.size(), true))
+        return false;
+    for (unsigned i = 1; i + 1 < segments.size(); i++)
+    {
+        const string & seg = segments[i];
+        int at = findBytes(attr + pos, end - pos, seg.data(), seg.size(), true);
+        if (at < 0) return false;
+        pos += at + seg.size();
+    }
+    return true;
+}
+
+
+// InSet
+
+void InSet::build(const Datatype type_, const int length_,
+                  const char* values, const int valueCnt)
+{
+    type = type_;
+    length = length_;
+
+    unsigned size = 8;
+    while (size < 2 * (unsigned) valueCnt) size *= 2;
+    mask = size - 1;
+    slots.assign(size * length, 0);
+    used.assign(size, 0);
+
+    for (int i = 0; i < valueCnt; i++)
+    {
+        const char* v = values + i * length;
+        float f;
+        if (type == FLOAT)
+        {
+            memcpy(&f, v, sizeof f);
+            if (f != f) continue;           // NaN equals nothing
+        }
+        unsigned h = hash(v) & mask;
+        while (used[h] && !same(&slots[h * length], v))
+            h = (h + 1) & mask;
+        if (used[h]) continue;              // a duplicate
+        used[h] = 1;
+        if (type == STRING)
+            strncpy(&slots[h * length], v, length);
+        else if (type == FLOAT && f == 0)
+            memset(&slots[h * length], 0, sizeof f);	// -0 is 0
+        else
+            memcpy(&slots[h * length], v, length);
+    }
+}
+
+const unsigned InSet::hash(const char* v) const
+{
+    unsigned h;
+    if (type == STRING)
+    {
+        // FNV-1a over the bytes before the first NUL
+        h = 2166136261u;
+        for (int i = 0; i < length && v[i] != '\0'; i++)
+            h = (h ^ (unsigned char) v[i]) * 16777619u;
+        return h;
+    }
+    if (type == FLOAT)
+    {
+        float f;
+        memcpy(&f, v, sizeof f);
+        if (f == 0) return 0;               // so that -0 finds 0
+    }
+    memcpy(&h, v, sizeof h);
+    h *= 2654435761u;
+    return h ^ (h >> 16);
+}
+
+const bool InSet::same(const char* slot, const char* v) const
+{
+    if (type == STRING) return strncmp(slot, v, length) == 0;
+    if (type == FLOAT)
+    {
+        float a, b;
+        memcpy(&a, slot, sizeof a);
+        memcpy(&b, v, sizeof b);
+        return a == b;
+    }
+    return memcmp(slot, v, sizeof(int)) == 0;
+}
+
+const bool InSet::contains(const char* attr) const
+{
+    for (unsigned h = hash(attr) & mask; used[h]; h = (h + 1) & mask)
+        if (same(&slots[h * length], attr)) return true;
+    return false;
+}
+
+// State shared by the insert scans open on one file, guarded by the
+// latch of the header page.
+struct InsertTail
+{
+    atomic<int>	scans;		// insert scans open on the file
+    bool	lastFree;	// no scan is filling the last page
+    vector<int>	spare;		// linked pages returned unused by scans
+};
+
+static mutex tailsMutex;		// guards tails
+static map<File*, InsertTail*> tails;
+
 InsertFileScan::InsertFileScan(const string & name,
                                Status & status) : HeapFile(name, status)
 {
-  //Do nothing. Heapfile constructor will read the header page and the first
-  // data page of the file into the buffer pool
+    tail = NULL;
+    recDelta = modDelta = 0;
+    if (status != OK) return;
+
+    // the page to insert into is chosen by the first insert
+    if (curPage != NULL)
+    {
+        status = bufMgr->unPinPage(filePtr, curPageNo, false);
+        curPage = NULL;
+        if (status != OK) return;
+    }
+
+    lock_guard<mutex> lk(tailsMutex);
+    map<File*, InsertTail*>::iterator it = tails.find(filePtr);
+    if (it == tails.end())
+    {
+        tail = new InsertTail;
+        tail->scans = 0;
+        tail->lastFree = true;
+        tails[filePtr] = tail;
+    }
+    else
+        tail = it->second;
+    tail->scans++;
 }
 
 InsertFileScan::~InsertFileScan()
 {
     Status status;
+
+    if (tail == NULL) return;
+    foldCounts();
+
+    lock_guard<mutex> tlk(tailsMutex);
+    {
+        lock_guard<mutex> lk(*hdrLatch);
+        // hand unused pages to the other scans; if this scan was
+        // filling the last page and it has room left, the next one
+        // may continue it
+        if (chunk.empty() && curPage != NULL &&
+            curPageNo == headerPage->lastPage &&
+            curPage->getFreeSpace() > (int) sizeof(slot_t))
+            tail->lastFree = true;
+        tail->spare.insert(tail->spare.end(), chunk.begin(), chunk.end());
+        chunk.clear();
+    }
+    if (--tail->scans == 0)
+    {
+        tails.erase(filePtr);
+        delete tail;
+    }
+    tail = NULL;
+
     // unpin last page of the scan
     if (curPage != NULL)
     {
         status = bufMgr->unPinPage(filePtr, curPageNo, true);
         curPage = NULL;
         curPageNo = 0;
-        if (status != OK) cerr << "error in unpin of data page\n";
+        if (status != OK) LOGERROR("error in unpin of data page");
+    }
+}
+
+void InsertFileScan::foldCounts()
+{
+    if (tail == NULL || (recDelta == 0 && modDelta == 0)) return;
+
+    lock_guard<mutex> lk(*hdrLatch);
+    headerPage->recCnt += recDelta;
+    headerPage->modCnt += modDelta;
+    hdrDirtyFlag = true;
+    if (stamps != NULL) stamps->changed(-1, modDelta);
+    recDelta = modDelta = 0;
+}
+
+const int InsertFileScan::getRecCnt() const
+{
+    return HeapFile::getRecCnt() + recDelta;
+}
+
+// Move the scan to the next page it may insert into: the next page of
+// its chunk, a page another scan left unused, the last page of the
+// file if nobody is filling it, or else a newly allocated chunk.
+
+const Status InsertFileScan::nextInsertPage()
+{
+    Status	status;
+    int		pageNo;
+
+    if (curPage != NULL)
+    {
+        status = bufMgr->unPinPage(filePtr, curPageNo, curDirtyFlag);
+        curPage = NULL;
+        if (status != OK) return status;
     }
+    foldCounts();
+
+    if (!chunk.empty())
+    {
+        pageNo = chunk.front();
+        chunk.erase(chunk.begin());
+    }
+    else
+    {
+        lock_guard<mutex> lk(*hdrLatch);
+
+        if (!tail->spare.empty())
+        {
+            pageNo = tail->spare.back();
+            tail->spare.pop_back();
+        }
+        else if (tail->lastFree)
+        {
+            pageNo = headerPage->lastPage;
+            tail->lastFree = false;
+        }
+        else
+        {
+            // allocate a chunk, a page at a time when this scan is
+            // alone, and link it behind the last page of the file
+            int		n = tail->scans > 1 ? INSERTCHUNK : 1;
+            int		pageNos[INSERTCHUNK];
+            Page*	pages[INSERTCHUNK];
+            Page*	lastPage;
+            int		i, cnt = 0;
+
+            status = OK;
+            for (i = 0; i < n; i++)
+            {
+                status = bufMgr->allocPage(filePtr, pageNos[i], pages[i]);
+                if (status != OK) break;
+                pages[i]->init(pageNos[i], headerPage->pageFlags);
+                if (i > 0) pages[i-1]->setNextPage(pageNos[i]);
+                cnt++;
+            }
+            if (cnt > 0)
+            {
+                Status linkStatus = bufMgr->readPage(filePtr,
+                                                     headerPage->lastPage,
+                                                     lastPage);
+                if (linkStatus == OK)
+                {
+                    // the page may be filled by another scan meanwhile;
+                    // that never touches its next page link
+                    lastPage->setNextPage(pageNos[0]);
+                    linkStatus = bufMgr->unPinPage(filePtr,
+                                                   headerPage->lastPage, true);
+                    headerPage->lastPage = pageNos[cnt-1];
+                    headerPage->pageCnt += cnt;
+                    hdrDirtyFlag = true;
+                }
+                for (i = 0; i < cnt; i++)
+                    bufMgr->unPinPage(filePtr, pageNos[i], true);
+                if (linkStatus != OK) return linkStatus;
+            }
+            if (cnt == 0) return status;
+
+            pageNo = pageNos[0];
+            chunk.assign(pageNos + 1, pageNos + cnt);
+        }
+    }
+
+    curPageNo = pageNo;
+    curDirtyFlag = false;
+    status = bufMgr->readPage(filePtr, curPageNo, curPage);
+    if (status != OK) curPage = NULL;
+    return status;
 }
 
 // Insert a record into the file
 const Status InsertFileScan::insertRecord(const Record & rec, RID& outRid)
 {
-    Page*	newPage;
-    int		newPageNo;
-    Status	status, unpinstatus;
+    Status	status;
     RID		rid;
 
-    // check for very large records
-    if ((unsigned int) rec.length > PAGESIZE-DPFIXED)
+    if (tail == NULL) return BADFILE;
+
+    // check for very large records.  the record needs a slot as well,
+    // and on aligned pages the padding up to RECALIGN bytes
+    int recSpace = headerPage->pageFlags & PAGE_ALIGNED ?
+        alignedLength(rec.length) : rec.length;
+    if (rec.length < 0 || recSpace + sizeof(slot_t) > PAGESIZE-DPFIXED)
     {
         // will never fit on a page, so don't even bother looking
         return INVALIDRECLEN;
     }
 
-  
-  
-  
-  
-  
-  
-  
-  
-  
-  
-  
-  
-}
+    if (curPage == NULL)
+    {
+        status = nextInsertPage();
+        if (status != OK) return status;
+    }
 
+    // go on with the next page while the record does not fit.  a page
+    // left by another scan may be nearly full, but a newly allocated
+    // one takes any record that passed the check above
+    status = curPage->insertRecord(rec, rid);
+    while (status == NOSPACE)
+    {
+        status = nextInsertPage();
+        if (status != OK) return status;
+        status = curPage->insertRecord(rec, rid);
+    }
+    if (status != OK) return status;
 
+    // stamp the page before the header counts the insert
+    if (stamps != NULL) stamps->changed(curPageNo, 0);
+    recDelta++;
+    modDelta++;
+    if (tail->scans == 1 || modDelta >= INSERTFOLD) foldCounts();
+    curDirtyFlag = true;
+    curRec = rid;
+    outRid = rid;
+    if (views != NULL) views->inserted(rec);
+    if (changes != NULL) return changes->append(CHGINSERT, rid, rec);
+    return OK;
+}
@@ -4,6 +4,7 @@
 #include <sys/types.h>
 #include <functional>
 #include <iostream>
+#include <mutex>
 #include <vector>
 #include <string.h>
 using namespace std;
@@ -13,14 +14,16 @@ using namespace std;
 
 extern DB db;
 
-// define if debug output wanted
-//#define DEBUGREL
-
 // Some constant definitions
 const unsigned MAXNAMESIZE = 50;
 
 enum Datatype { STRING, INTEGER, FLOAT };    // attribute data types
-enum Operator { LT, LTE, EQ, GTE, GT, NE };  // scan operators
+// scan operators.  the filter of PREFIX, SUFFIX, SUBSTR and LIKE is a
+// pattern, ended by a NUL or the attribute length, that STRING values
+// are matched against; in a LIKE pattern % stands for any sequence of
+// characters and _ for any one character
+enum Operator { LT, LTE, EQ, GTE, GT, NE, IN,
+                PREFIX, SUFFIX, SUBSTR, LIKE };
 
 struct FileHdrPage
 {
@@ -29,14 +32,30 @@ struct FileHdrPage
   int		lastPage;	// pageNo of last data page in file
   int		pageCnt;	// number of pages
   int		recCnt;		// record count
+  int		pageFlags;	// layout flags of data pages (PAGE_ALIGNED)
+  int		modCnt;		// bumped on every insert, delete and update
 };
 
+// create a heap file whose data pages are initialized with pageFlags
+const Status createHeapFile(const string fileName, const int pageFlags);
+
+// create a temporary, memory resident heap file
+const Status createTempHeapFile(const string fileName);
+
+
+class ChangeLog;
+class AggViews;
+class PageStamps;
 
 // class definition of heapFile
 class HeapFile {
 protected:
    File* 	filePtr;        // underlying DB File object
+   ChangeLog*	changes;	// change log of file, NULL if none
+   AggViews*	views;		// aggregate views over file, NULL if none
+   PageStamps*	stamps;		// page stamps of scan cache, NULL if none
    FileHdrPage*  headerPage;	// pinned file header page in buffer pool
+   mutex*	hdrLatch;	// guards the counts and page chain of headerPage
    int		headerPageNo;	// page number of header page
    bool		hdrDirtyFlag;   // true if header page has been updated
 
@@ -56,11 +75,50 @@ public:
   // return number of records in file
   const int getRecCnt() const;
 
+  // return modification count of file (changes whenever a record does)
+  const int getModCnt() const;
+
   // given a RID, read record from file, returning pointer and length
   const Status getRecord(const RID &rid, Record & rec);
+
+  // page numbers of all data pages, in file order
+  const Status getPageNos(vector<int> & pageNos);
 };
 
 
+// The values of an IN predicate, kept in an open addressing hash table
+// at most half full, so that a probe costs one hash and usually one
+// compare however many values there are.  Values are compared as the
+// single value filters of a scan compare them: INTEGER and FLOAT as
+// numbers, STRING up to the first NUL within the length.
+
+class InSet
+{
+public:
+    void build(const Datatype type, const int length,
+               const char* values, const int valueCnt);
+
+    const bool contains(const char* attr) const;
+
+private:
+    Datatype		type;
+    int			length;
+    unsigned		mask;		// slots - 1
+    vector<char>	slots;		// length bytes each
+    vector<char>	used;		// slot holds a value
+
+    const unsigned hash(const char* v) const;
+    const bool same(const char* slot, const char* v) const;
+};
+
+
+// A synchronized scan (see syncScan) that starts while other
+// synchronized scans of the same file are running begins at the page
+// one of them last moved to, follows the chain to its end and then
+// wraps around to the first page, stopping where it began.  Scans
+// that run together thus read each page once between them instead of
+// once each.  Records are returned in a rotated order.
+
 class HeapFileScan : public HeapFile
 {
 public:
@@ -68,20 +126,31 @@ public:
     HeapFileScan(const string & name, Status & status);
 
     // end filtered scan
-    ~HeapFileScan();
-
-    const Status startScan(const int offset, 
-                           const int length,  
-                           const Datatype type, 
-                           const char* filter, 
-                           const Operator op);
-
-    const Status endScan(); // terminate the scan
+    virtual ~HeapFileScan();
+
+    // the scans below are virtual, so that a scan that answers them
+    // differently (PackedIntScan, JitScan) does so also when it is
+    // used through a HeapFileScan*
+    virtual const Status startScan(const int offset, 
+                                   const int length,  
+                                   const Datatype type, 
+                                   const char* filter, 
+                                   const Operator op);
+
+    // select the records whose attribute equals one of the valueCnt
+    // values of length bytes each at values (an IN predicate)
+    virtual const Status startScan(const int offset,
+                                   const int length,
+                                   const Datatype type,
+                                   const char* values,
+                                   const int valueCnt);
+
+    virtual const Status endScan(); // terminate the scan
     const Status markScan(); // save current position of scan
     const Status resetScan(); // reset scan to last marked location
 
     // return RID of next record that satisfies the scan 
-    const Status scanNext(RID& outRid);
+    virtual const Status scanNext(RID& outRid);
 
     // read current record, returning pointer and length
     const Status getRecord(Record & rec);
@@ -89,15 +158,39 @@ public:
     // delete current record 
     const Status deleteRecord();
 
+    // delete all records the scan selects that also satisfy pred, if
+    // one is given.  the records of a page are deleted together, with
+    // one compaction, and the header is updated once.  with threads > 1
+    // the pages are shared out among that many threads, which call
+    // pred at the same time.  ends the scan and ignores its limit;
+    // deleted gets the number of records deleted
+    const Status deleteWhere(int & deleted,
+                             const int threads = 1,
+                             const function<bool(const Record &)> & pred = nullptr);
+
     // marks current page of scan dirty
     const Status markDirty();
 
+    // make the following scans of this object synchronized scans;
+    // takes effect with the next startScan
+    void syncScan(const bool on) { sync = on; }
+
+    // return at most n records from each following scan, 0 for all.
+    // the scan stops and unpins its page on the call after the n-th
+    // record, without reading further pages
+    void setLimit(const int n) { limit = n; }
+
 private:
     int   offset;            // byte offset of filter attribute
     int   length;            // length of filter attribute
     Datatype type;           // datatype of filter attribute
     const char* filter;      // comparison value of filter
     Operator op;             // comparison operator of filter
+    int   ifilter;           // filter value when type is INTEGER
+    float ffilter;           // filter value when type is FLOAT
+    InSet inSet;             // filter values when op is IN
+    string pattern;          // filter of a pattern operator
+    vector<string> segments; // pieces of a LIKE pattern between %s
 
      // The following variables are used to preserve the state
     // of the scan when the method markScan() is invoked.
@@ -106,10 +199,59 @@ private:
     int   markedPageNo;	// page number of pinned page
     RID   markedRec;         // rid of last record returned
 
-    const bool matchRec(const Record & rec) const;
+    bool  sync;              // scans are synchronized scans
+    bool  syncing;           // current scan is a synchronized scan
+    int   syncStart;         // page the synchronized scan began on
+    bool  wrapped;           // it has passed the end of the chain
+    int   limit;             // records to return, 0 for all
+    int   returned;          // records returned since startScan
+
+    const Status syncBegin();
+    void syncEnd();
+
+    const bool matchPattern(const char* attr) const;
+
+protected:
+    // true if rec is selected by the scan; virtual for the scans of a
+    // subclass that keeps its own predicates, so that deleteWhere and
+    // the other users of the filter select what scanNext returns
+    virtual const bool matchRec(const Record & rec) const;
+
+    // for the scanNext of a subclass: pastLimit ends the scan and
+    // returns FILEEOF (or the error of ending it) once the scan has
+    // returned its limit of records, OK before; counted counts a
+    // record returned
+    const Status pastLimit();
+    void counted() { returned++; }
+
+    // true if the following scans are to be synchronized scans
+    const bool syncOn() const { return sync; }
+
+    // move the scan to the page after the current one, or to the first
+    // page when none is pinned.  a synchronized scan wraps around to
+    // the page it began on.  FILEEOF after the last page
+    const Status nextScanPage();
 };
 
 
+const int INSERTCHUNK = 8;	// pages handed to an insert scan at a time
+const int INSERTFOLD = 64;	// inserts between updates of the header
+
+struct InsertTail;
+
+// An insert scan fills pages of its own, so several insert scans of
+// one file (e.g. one per loader thread) never write the same data
+// page.  The first scan continues the last page of the file; the
+// others are handed INSERTCHUNK new pages at a time, linked at the end
+// of the file in one step.  Record and modification counts are kept
+// in the scan and added to the header page every INSERTFOLD inserts,
+// when the scan moves to another page and when it is destroyed.  A
+// scan that is the only one open on its file updates the header on
+// every insert and allocates one page at a time, like a plain append.
+//
+// Insert scans must be constructed and destroyed by one thread at a
+// time; once open, each may be used by a different thread.
+
 class InsertFileScan : public HeapFile
 {
 public:
@@ -121,6 +263,21 @@ public:
 
     // insert record into file, returning its RID
     const Status insertRecord(const Record & rec, RID& outRid); 
+
+    // add the counts of this scan to the header page now
+    void foldCounts();
+
+    // number of records in the file, including those inserted by this
+    // scan but not yet added to the header
+    const int getRecCnt() const;
+
+private:
+    InsertTail*	tail;		// shared by the insert scans of the file
+    vector<int>	chunk;		// pages handed to this scan, not yet used
+    int		recDelta;	// inserts not yet added to the header
+    int		modDelta;	// modifications not yet added to the header
+
+    const Status nextInsertPage();
 };
 
 #endif
@@ -0,0 +1,296 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include "import.h"
+#include "error.h"
+
+// bulk import implementation
+
+// the part of the data file loaded by one thread
+struct ImportPiece
+{
+    const char*		start;
+    const char*		end;
+    InsertFileScan*	scan;
+    int			recCnt;		// records loaded
+    Status		status;
+    long		errOffset;	// offset of bad record in data file
+};
+
+// convert an INTEGER field
+static const bool parseInt(const char* p, const char* end, int & value)
+{
+    bool neg = false;
+    long long v = 0;
+
+    if (p < end && (*p == '-' || *p == '+')) neg = *p++ == '-';
+    if (p == end) return false;
+    for ( ; p < end; p++)
+    {
+        if (*p < '0' || *p > '9') return false;
+        v = v * 10 + (*p - '0');
+        if (v > 2147483648LL) return false;
+    }
+    if (neg) v = -v;
+    if (v > 2147483647LL) return false;
+    value = (int) v;
+    return true;
+}
+
+// convert a FLOAT field
+static const bool parseFloat(const char* p, const char* end, float & value)
+{
+    char buf[IMPORTMAXFIELD + 1];
+    char* stop;
+    int n = end - p;
+
+    if (n == 0 || n > IMPORTMAXFIELD) return false;
+    memcpy(buf, p, n);
+    buf[n] = '\0';
+    value = strtof(buf, &stop);
+    return stop == buf + n;
+}
+
+// convert the CSV line [p, eol) into record rec
+static const bool parseLine(const char* p, const char* eol,
+                            const vector<AttrDesc> & attrs, char* rec)
+{
+    for (unsigned i = 0; i < attrs.size(); i++)
+    {
+        const AttrDesc & a = attrs[i];
+        char* field = rec + a.attrOffset;
+        const char* fend;
+
+        if (p < eol && *p == '"')
+        {
+            // quoted string; "" stands for a quote
+            int n = 0;
+            if (a.attrType != STRING) return false;
+            memset(field, 0, a.attrLen);
+            for (p++; ; p++)
+            {
+                if (p == eol) return false;
+                if (*p == '"')
+                {
+                    if (p + 1 < eol && p[1] == '"') p++;
+                    else break;
+                }
+                if (n < a.attrLen) field[n++] = *p;
+            }
+            fend = p + 1;
+            if (fend != eol && *fend != ',') return false;
+        }
+        else
+        {
+            fend = (const char*) memchr(p, ',', eol - p);
+            if (fend == NULL) fend = eol;
+
+            switch (a.attrType)
+            {
+            case INTEGER:
+            {
+                int v;
+                if (!parseInt(p, fend, v)) return false;
+                memcpy(field, &v, sizeof v);
+                break;
+            }
+            case FLOAT:
+            {
+                float v;
+                if (!parseFloat(p, fend, v)) return false;
+                memcpy(field, &v, sizeof v);
+                break;
+            }
+            default:
+            {
+                int n = fend - p < a.attrLen ? fend - p : a.attrLen;
+                memcpy(field, p, n);
+                memset(field + n, 0, a.attrLen - n);
+            }
+            }
+        }
+
+        // the last attribute must end the line, the others may not
+        if ((i + 1 == attrs.size()) != (fend == eol)) return false;
+        p = fend + 1;
+    }
+    return true;
+}
+
+static void loadCSV(ImportPiece* piece, const vector<AttrDesc> & attrs,
+                    const int recLen, const char* base, atomic<bool>* stop)
+{
+    vector<char> buf(recLen, 0);
+    Record rec;
+    RID rid;
+    const char* p = piece->start;
+
+    rec.data = &buf[0];
+    rec.length = recLen;
+
+    while (p < piece->end && !*stop)
+    {
+        const char* eol = (const char*) memchr(p, '\n', piece->end - p);
+        const char* next;
+        if (eol == NULL) eol = piece->end;
+        next = eol + 1;
+        if (eol > p && eol[-1] == '\r') eol--;
+
+        if (eol > p)
+        {
+            if (!parseLine(p, eol, attrs, &buf[0]))
+                piece->status = BADIMPORTREC;
+            else
+                piece->status = piece->scan->insertRecord(rec, rid);
+            if (piece->status != OK)
+            {
+                piece->errOffset = p - base;
+                *stop = true;
+                return;
+            }
+            piece->recCnt++;
+        }
+        p = next;
+    }
+}
+
+static void loadBinary(ImportPiece* piece, const int recLen,
+                       const char* base, atomic<bool>* stop)
+{
+    Record rec;
+    RID rid;
+
+    rec.length = recLen;
+    for (const char* p = piece->start; p < piece->end && !*stop; p += recLen)
+    {
+        rec.data = (void*) p;
+        piece->status = piece->scan->insertRecord(rec, rid);
+        if (piece->status != OK)
+        {
+            piece->errOffset = p - base;
+            *stop = true;
+            return;
+        }
+        piece->recCnt++;
+    }
+}
+
+
+const Status importRel(const string & relName,
+                       const string & fileName,
+                       const ImportFormat format,
+                       const int threads,
+                       int & recCnt)
+{
+    Status		status;
+    RelDesc		desc;
+    vector<AttrDesc>	attrs;
+    struct stat		st;
+    int			fd;
+    int			n = threads < 1 ? 1 : threads;
+    int			i;
+
+    recCnt = 0;
+    if (relCat == NULL) return BADCATPARM;
+    if ((status = relCat->getRelInfo(relName, desc)) != OK) return status;
+    if ((status = relCat->getRelAttrs(relName, attrs)) != OK) return status;
+
+    if ((fd = ::open(fileName.c_str(), O_RDONLY)) < 0) return UNIXERR;
+    if (fstat(fd, &st) < 0)
+    {
+        ::close(fd);
+        return UNIXERR;
+    }
+    size_t size = st.st_size;
+    if (size == 0)
+    {
+        ::close(fd);
+        return OK;
+    }
+    if (format == BINARYFORMAT && size % desc.recLen != 0)
+    {
+        ::close(fd);
+        return BADIMPORTREC;
+    }
+
+    const char* base = (const char*) mmap(NULL, size, PROT_READ,
+                                          MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) return UNIXERR;
+    madvise((void*) base, size, MADV_SEQUENTIAL);
+    madvise((void*) base, size, MADV_WILLNEED);
+
+    // cut the file into pieces at record boundaries
+    vector<ImportPiece> pieces(n);
+    const char* end = base + size;
+    for (i = 0; i < n; i++)
+    {
+        const char* p;
+        if (format == BINARYFORMAT)
+            p = base + (size / desc.recLen * i / n) * desc.recLen;
+        else if (i == 0)
+            p = base;
+        else
+        {
+            p = base + size * i / n;
+            if (p < pieces[i-1].start) p = pieces[i-1].start;
+            p = (const char*) memchr(p, '\n', end - p);
+            p = p == NULL ? end : p + 1;
+        }
+        pieces[i].start = p;
+        if (i > 0) pieces[i-1].end = p;
+        pieces[i].scan = NULL;
+        pieces[i].recCnt = 0;
+        pieces[i].status = OK;
+        pieces[i].errOffset = -1;
+    }
+    pieces[n-1].end = end;
+
+    // insert scans are opened and closed here, one thread at a time
+    for (i = 0; i < n && status == OK; i++)
+    {
+        pieces[i].scan = new InsertFileScan(relName, status);
+        if (status != OK)
+        {
+            delete pieces[i].scan;
+            pieces[i].scan = NULL;
+        }
+    }
+
+    if (status == OK)
+    {
+        atomic<bool> stop(false);
+        vector<thread> loaders;
+        for (i = 0; i < n; i++)
+        {
+            if (format == BINARYFORMAT)
+                loaders.push_back(thread(loadBinary, &pieces[i],
+                                         (int) desc.recLen, base, &stop));
+            else
+                loaders.push_back(thread(loadCSV, &pieces[i], cref(attrs),
+                                         (int) desc.recLen, base, &stop));
+        }
+        for (i = 0; i < n; i++)
+            loaders[i].join();
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        delete pieces[i].scan;
+        recCnt += pieces[i].recCnt;
+        if (status == OK && pieces[i].status != OK)
+        {
+            status = pieces[i].status;
+            LOGWARN("import of " << fileName << " into " << relName
+                    << " stopped at byte " << pieces[i].errOffset);
+        }
+    }
+
+    munmap((void*) base, size);
+    return status;
+}
@@ -0,0 +1,39 @@
+#ifndef IMPORT_H
+#define IMPORT_H
+
+#include "catalog.h"
+
+// Bulk import.
+//
+// A data file is mapped into memory and cut into one piece per loader
+// thread, each piece ending at a record boundary.  Every thread
+// converts the records of its piece to the layout of the relation, as
+// described by the catalog, and inserts them through an insert scan of
+// its own, so the loaders fill separate pages (see InsertFileScan).
+//
+// A CSV file holds one record per line with the attributes in the
+// order they were declared, separated by commas.  INTEGER and FLOAT
+// fields are decimal numbers; STRING fields are cut or zero padded to
+// the attribute length and may be enclosed in double quotes, with ""
+// standing for a quote.  Lines may end in \r\n; empty lines are
+// skipped.  A quoted field may not span lines.
+//
+// A binary file is a sequence of records in the layout of the relation.
+//
+// Records loaded before an error is found stay in the relation.
+
+enum ImportFormat { CSVFORMAT, BINARYFORMAT };
+
+const int IMPORTTHREADS = 4;		// default number of loader threads
+const int IMPORTMAXFIELD = 64;		// longest numeric CSV field
+
+// load data file fileName into relation relName using the given
+// number of loader threads.  recCnt is set to the number of records
+// loaded
+const Status importRel(const string & relName,
+                       const string & fileName,
+                       const ImportFormat format,
+                       const int threads,
+                       int & recCnt);
+
+#endif
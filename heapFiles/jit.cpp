@@ -0,0 +1,306 @@
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include "jit.h"
+#include "error.h"
+
+// compiled scan implementation
+
+// kernels by predicate shape; NULL for a shape that failed to compile
+static mutex kernelsMutex;
+static map<string, ScanKernel> kernels;
+
+static const char* opText[] = { "<", "<=", "==", ">=", ">", "!=" };
+
+// the part of a predicate a kernel is specialized for
+static const string shapeOf(const vector<ScanPred> & preds)
+{
+    ostringstream shape;
+    for (unsigned i = 0; i < preds.size(); i++)
+        shape << preds[i].offset << ':' << preds[i].length << ':'
+              << preds[i].type << ':' << preds[i].op << ';';
+    return shape.str();
+}
+
+// the source of the kernel for a predicate shape
+static const string kernelSource(const vector<ScanPred> & preds, const int minLen)
+{
+    ostringstream src;
+    unsigned i;
+
+    src << "#include <string.h>\n"
+        << "extern \"C\" int scanKernel(const char* const* recs, const int* lens,\n"
+        << "                            const int n, const char* const* f, int* hits)\n"
+        << "{\n";
+    for (i = 0; i < preds.size(); i++)
+        if (preds[i].type == INTEGER)
+            src << "  int c" << i << "; memcpy(&c" << i << ", f[" << i << "], 4);\n";
+        else if (preds[i].type == FLOAT)
+            src << "  float c" << i << "; memcpy(&c" << i << ", f[" << i << "], 4);\n";
+    src << "  int m = 0;\n"
+        << "  for (int k = 0; k < n; k++)\n"
+        << "  {\n"
+        << "    const char* r = recs[k];\n"
+        << "    if (lens[k] < " << minLen << ") continue;\n";
+    for (i = 0; i < preds.size(); i++)
+    {
+        const ScanPred & p = preds[i];
+        if (p.type == INTEGER)
+            src << "    { int v; memcpy(&v, r + " << p.offset << ", 4); if (!(v "
+                << opText[p.op] << " c" << i << ")) continue; }\n";
+        else if (p.type == FLOAT)
+            src << "    { float v; memcpy(&v, r + " << p.offset << ", 4); if (!(v "
+                << opText[p.op] << " c" << i << ")) continue; }\n";
+        else
+            src << "    if (!(strncmp(r + " << p.offset << ", f[" << i << "], "
+                << p.length << ") " << opText[p.op] << " 0)) continue;\n";
+    }
+    src << "    hits[m++] = k;\n"
+        << "  }\n"
+        << "  return m;\n"
+        << "}\n";
+    return src.str();
+}
+
+// write, compile and load the kernel for a predicate; NULL on failure
+static ScanKernel compileKernel(const vector<ScanPred> & preds, const int minLen)
+{
+    char dir[] = "/tmp/jitXXXXXX";
+    if (mkdtemp(dir) == NULL) return NULL;
+    string srcName = string(dir) + "/kernel.cpp";
+    string libName = string(dir) + "/kernel.so";
+
+    ScanKernel kernel = NULL;
+    FILE* f = fopen(srcName.c_str(), "w");
+    if (f != NULL)
+    {
+        string src = kernelSource(preds, minLen);
+        bool written = fwrite(src.data(), 1, src.size(), f) == src.size();
+        if (fclose(f) == 0 && written)
+        {
+            string cmd = string(JITCOMPILER " " JITFLAGS " -o ") + libName + " " +
+                         srcName + " > /dev/null 2>&1";
+            void* lib;
+            if (system(cmd.c_str()) == 0 &&
+                (lib = dlopen(libName.c_str(), RTLD_NOW | RTLD_LOCAL)) != NULL)
+                kernel = (ScanKernel) dlsym(lib, "scanKernel");
+        }
+    }
+    // the loaded object stays mapped once its file is gone
+    unlink(libName.c_str());
+    unlink(srcName.c_str());
+    rmdir(dir);
+    if (kernel == NULL) LOGWARN("could not compile scan kernel, interpreting");
+    return kernel;
+}
+
+static ScanKernel findKernel(const vector<ScanPred> & preds, const int minLen)
+{
+    lock_guard<mutex> lk(kernelsMutex);
+    string shape = shapeOf(preds);
+    map<string, ScanKernel>::iterator it = kernels.find(shape);
+    if (it != kernels.end()) return it->second;
+    return kernels[shape] = compileKernel(preds, minLen);
+}
+
+// what a kernel does, by interpretation
+static int interpret(const vector<ScanPred> & preds, const int minLen,
+                     const char* const* recs, const int* lens, const int n,
+                     const char* const* filters, int* hits)
+{
+    int m = 0;
+    for (int k = 0; k < n; k++)
+    {
+        if (lens[k] < minLen) continue;
+        unsigned i;
+        for (i = 0; i < preds.size(); i++)
+        {
+            const ScanPred & p = preds[i];
+            const char* attr = recs[k] + p.offset;
+            int c;
+            if (p.type == INTEGER)
+            {
+                int v, f;
+                memcpy(&v, attr, sizeof v);
+                memcpy(&f, filters[i], sizeof f);
+                c = v < f ? -1 : v > f ? 1 : 0;
+            }
+            else if (p.type == FLOAT)
+            {
+                float v, f;
+                memcpy(&v, attr, sizeof v);
+                memcpy(&f, filters[i], sizeof f);
+                if (v != v || f != f)
+                {
+                    // NaN satisfies only NE
+                    if (p.op == NE) continue;
+                    break;
+                }
+                c = v < f ? -1 : v > f ? 1 : 0;
+            }
+            else
+                c = strncmp(attr, filters[i], p.length);
+
+            bool ok = false;
+            switch (p.op) {
+            case LT:  ok = c < 0; break;
+            case LTE: ok = c <= 0; break;
+            case EQ:  ok = c == 0; break;
+            case GTE: ok = c >= 0; break;
+            case GT:  ok = c > 0; break;
+            case NE:  ok = c != 0; break;
+            default:  break;
+            }
+            if (!ok) break;
+        }
+        if (i == preds.size()) hits[m++] = k;
+    }
+    return m;
+}
+
+
+JitScan::JitScan(const string & name, Status & status)
+    : HeapFileScan(name, status)
+{
+    jit = true;
+    own = false;
+    evaluated = false;
+    kernel = NULL;
+    minLen = 0;
+    hitCnt = 0;
+    nextHit = 0;
+}
+
+const Status JitScan::startScan(const int offset,
+                                const int length,
+                                const Datatype type,
+                                const char* filter,
+                                const Operator op)
+{
+    own = false;
+    kernel = NULL;
+    return HeapFileScan::startScan(offset, length, type, filter, op);
+}
+
+const Status JitScan::startScan(const int offset,
+                                const int length,
+                                const Datatype type,
+                                const char* values,
+                                const int valueCnt)
+{
+    own = false;
+    kernel = NULL;
+    return HeapFileScan::startScan(offset, length, type, values, valueCnt);
+}
+
+const Status JitScan::startScan(const vector<ScanPred> & preds_)
+{
+    Status status;
+
+    if (preds_.size() > (unsigned) MAXJITPREDS) return BADSCANPARM;
+    for (unsigned i = 0; i < preds_.size(); i++)
+    {
+        const ScanPred & p = preds_[i];
+        if (p.offset < 0 || p.length < 1 || p.filter == NULL ||
+            (p.type != STRING && p.type != INTEGER && p.type != FLOAT) ||
+            (p.type != STRING && p.length != sizeof(int)) ||
+            p.op < LT || p.op > NE)
+            return BADSCANPARM;
+    }
+
+    // start over at the first page, or where the synchronized scans
+    // of the file are
+    if ((status = endScan()) != OK) return status;
+    if ((status = HeapFileScan::startScan(0, 0, STRING, NULL, EQ)) != OK)
+        return status;
+    preds = preds_;
+    values.clear();
+    filters.clear();
+    minLen = 0;
+    for (unsigned i = 0; i < preds.size(); i++)
+    {
+        const ScanPred & p = preds[i];
+        if (p.type == STRING)
+            values.push_back(string(p.filter, strnlen(p.filter, p.length)));
+        else
+            values.push_back(string(p.filter, p.length));
+        if (p.offset + p.length > minLen) minLen = p.offset + p.length;
+    }
+    for (unsigned i = 0; i < values.size(); i++)
+        filters.push_back(values[i].c_str());
+    kernel = jit ? findKernel(preds, minLen) : NULL;
+    own = true;
+    evaluated = false;
+    hitCnt = 0;
+    nextHit = 0;
+    return OK;
+}
+
+// find the records of the current page that satisfy the predicate
+const Status JitScan::evalPage()
+{
+    Status status;
+    RID rid, prevRid;
+    Record rec;
+    int n = 0;
+
+    status = curPage->firstRecord(rid);
+    while (status == OK)
+    {
+        curPage->getRecord(rid, rec);
+        recs[n] = (const char*) rec.data;
+        lens[n] = rec.length;
+        rids[n++] = rid;
+        prevRid = rid;
+        status = curPage->nextRecord(prevRid, rid);
+    }
+
+    hitCnt = 0;
+    if (n > 0)
+        hitCnt = kernel != NULL ?
+            kernel(recs, lens, n, filters.data(), hits) :
+            interpret(preds, minLen, recs, lens, n, filters.data(), hits);
+    nextHit = 0;
+    return OK;
+}
+
+const bool JitScan::matchRec(const Record & rec) const
+{
+    if (!own) return HeapFileScan::matchRec(rec);
+
+    const char* r = (const char*) rec.data;
+    int len = rec.length;
+    int hit;
+    return interpret(preds, minLen, &r, &len, 1, filters.data(), &hit) == 1;
+}
+
+const Status JitScan::scanNext(RID & outRid)
+{
+    Status status;
+
+    if (!own) return HeapFileScan::scanNext(outRid);
+    if ((status = pastLimit()) != OK) return status;
+
+    // evaluate the pinned page, then move on while its hits are used up
+    while (curPage == NULL || !evaluated || nextHit >= hitCnt)
+    {
+        if (curPage != NULL && !evaluated)
+        {
+            if ((status = evalPage()) != OK) return status;
+            evaluated = true;
+            continue;
+        }
+        if ((status = nextScanPage()) != OK) return status;
+        evaluated = false;
+    }
+
+    curRec = rids[hits[nextHit++]];
+    outRid = curRec;
+    counted();
+    return OK;
+}
@@ -0,0 +1,99 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "heapfile.h"
+
+// Compiled scans.
+//
+// A JitScan selects the records that satisfy a conjunction of
+// comparisons (LT, LTE, EQ, GTE, GT, NE on INTEGER, FLOAT or STRING
+// attributes).  For each shape of predicate -- the offsets, lengths,
+// types and operators, but not the values compared with -- it writes a
+// C++ function that evaluates exactly those comparisons on all records
+// of a page, compiles it with JITCOMPILER into a shared object and
+// loads it with dlopen.  Kernels are kept for the life of the process,
+// so later scans of the same shape, with any values, reuse them.
+//
+// When no kernel can be had (no compiler, or jit turned off) the same
+// page at a time loop evaluates the predicates by interpretation.
+
+#define JITCOMPILER	"g++"
+#define JITFLAGS	"-O2 -shared -fPIC"
+
+const int MAXJITPREDS = 16;	// comparisons in one predicate
+
+// one comparison: attribute op value; filter points to the value
+struct ScanPred
+{
+    int		offset;
+    int		length;
+    Datatype	type;
+    Operator	op;
+    const char*	filter;
+};
+
+// evaluate a predicate on the n records at recs (lengths in lens),
+// putting the indexes of those that satisfy it in hits.  returns the
+// number of hits
+typedef int (*ScanKernel)(const char* const* recs, const int* lens,
+                          const int n, const char* const* filters,
+                          int* hits);
+
+class JitScan : public HeapFileScan
+{
+public:
+    JitScan(const string & name, Status & status);
+
+    // scan for the records that satisfy all of preds.  the values are
+    // copied
+    const Status startScan(const vector<ScanPred> & preds);
+
+    // the scans of a HeapFileScan, which the kernels do not run
+    const Status startScan(const int offset,
+                           const int length,
+                           const Datatype type,
+                           const char* filter,
+                           const Operator op);
+    const Status startScan(const int offset,
+                           const int length,
+                           const Datatype type,
+                           const char* values,
+                           const int valueCnt);
+
+    // return RID of next record that satisfies the scan
+    const Status scanNext(RID & outRid);
+
+    // use compiled kernels (the default) or interpret; takes effect
+    // with the next startScan
+    void useJit(const bool on) { jit = on; }
+
+    // true if the current scan runs a compiled kernel
+    const bool compiled() const { return kernel != NULL; }
+
+private:
+    bool		jit;
+    bool		own;		// current scan was started with preds
+    ScanKernel		kernel;		// NULL when interpreting
+    vector<ScanPred>	preds;
+    vector<string>	values;		// copies of the filter values
+    vector<const char*>	filters;	// pointers into values
+    int			minLen;		// shortest record that can match
+
+    // the current page, evaluated.  arrays rather than vectors, so
+    // that collecting a page costs no more than a plain scan of it
+    const char*		recs[PAGESIZE / sizeof(slot_t)];
+    int			lens[PAGESIZE / sizeof(slot_t)];
+    RID			rids[PAGESIZE / sizeof(slot_t)];
+    int			hits[PAGESIZE / sizeof(slot_t)];
+    int			hitCnt;
+    int			nextHit;
+    bool		evaluated;	// hits are those of the pinned page
+
+    const Status evalPage();
+
+protected:
+    // the predicates of a scan started with preds, on one record
+    const bool matchRec(const Record & rec) const;
+};
+
+#endif
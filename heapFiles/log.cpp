@@ -0,0 +1,353 @@
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "log.h"
+
+// logging implementation
+
+int logLevel = LLWARN;
+
+// ring buffer of one thread.  head and tail count bytes written and
+// consumed; LOGBUFSIZE is a power of two so they may wrap around
+struct LogRing
+{
+  char			data[LOGBUFSIZE];
+  atomic<unsigned>	head;		// advanced by the owning thread only
+  atomic<unsigned>	tail;		// advanced by the flusher only
+  atomic<bool>		dead;		// owning thread has exited
+};
+
+struct LogState
+{
+  mutex			mtx;		// rings, fd and the flush handshake
+  condition_variable	wake;		// wakes the flusher
+  condition_variable	done;		// signals a completed flush
+  vector<LogRing*>	rings;
+  thread		flusher;
+  atomic<bool>		running;	// flusher is up
+  bool			stopping;
+  long			flushReq;	// flush requests made
+  long			flushDone;	// flush requests completed
+  int			fd;		// log output
+  atomic<long>		dropped;
+};
+
+static void logShutdown();
+static void flusherMain(LogState* s);
+
+// the logger state is created on first use and never destroyed, so
+// that objects with static storage may log from their constructors
+// and destructors
+static LogState* logState()
+{
+  static LogState* s = NULL;
+  static once_flag once;
+
+  call_once(once, []() {
+    s = new LogState;
+    s->running = false;
+    s->stopping = false;
+    s->flushReq = s->flushDone = 0;
+    s->fd = 2;
+    s->dropped = 0;
+    s->flusher = thread(flusherMain, s);
+    s->running = true;
+    atexit(logShutdown);
+  });
+  return s;
+}
+
+// the ring of the calling thread; ringGone is set when the thread's
+// ring has been handed back during thread exit
+static thread_local LogRing* myRing = NULL;
+static thread_local bool ringGone = false;
+
+struct LogRingOwner
+{
+  ~LogRingOwner()
+  {
+    if (myRing != NULL) myRing->dead.store(true, memory_order_release);
+    myRing = NULL;
+    ringGone = true;
+  }
+};
+static thread_local LogRingOwner ringOwner;
+
+
+static void writeAll(const int fd, const char* p, int n)
+{
+  while (n > 0)
+    {
+      int written = ::write(fd, p, n);
+      if (written < 0)
+	{
+	  if (errno == EINTR) continue;
+	  return;
+	}
+      p += written;
+      n -= written;
+    }
+}
+
+// write out everything in the rings and release the rings of exited
+// threads.  called with s->mtx held
+static void drainAll(LogState* s)
+{
+  unsigned i = 0;
+  while (i < s->rings.size())
+    {
+      LogRing* r = s->rings[i];
+      bool dead = r->dead.load(memory_order_acquire);
+      unsigned tail = r->tail.load(memory_order_relaxed);
+      unsigned head = r->head.load(memory_order_acquire);
+      if (head != tail)
+	{
+	  unsigned start = tail % LOGBUFSIZE;
+	  unsigned n = head - tail;
+	  if (start + n > (unsigned) LOGBUFSIZE)
+	    {
+	      writeAll(s->fd, r->data + start, LOGBUFSIZE - start);
+	      writeAll(s->fd, r->data, n - (LOGBUFSIZE - start));
+	    }
+	  else
+	    writeAll(s->fd, r->data + start, n);
+	  r->tail.store(head, memory_order_release);
+	}
+      if (dead)
+	{
+	  delete r;
+	  s->rings[i] = s->rings.back();
+	  s->rings.pop_back();
+	}
+      else
+	i++;
+    }
+}
+
+static void flusherMain(LogState* s)
+{
+  unique_lock<mutex> lk(s->mtx);
+  while (true)
+    {
+      long req = s->flushReq;
+      bool stop = s->stopping;
+      drainAll(s);
+      s->flushDone = req;
+      s->done.notify_all();
+      if (stop) break;
+      s->wake.wait_for(lk, chrono::milliseconds(LOGFLUSHMS),
+		       [s]() { return s->flushReq != s->flushDone || s->stopping; });
+    }
+}
+
+// stop the flusher at exit; later messages are written directly
+static void logShutdown()
+{
+  LogState* s = logState();
+  {
+    lock_guard<mutex> lk(s->mtx);
+    s->stopping = true;
+  }
+  s->wake.notify_one();
+  s->flusher.join();
+  {
+    lock_guard<mutex> lk(s->mtx);
+    s->running = false;
+  }
+  s->done.notify_all();
+}
+
+
+// Hand a formatted message to the logger.
+
+static void logPut(const int level, const char* text, const int len)
+{
+  LogState* s = logState();
+
+  if (!s->running || ringGone)
+    {
+      // no flusher (any more) or no ring: write in order with the rest
+      lock_guard<mutex> lk(s->mtx);
+      drainAll(s);
+      writeAll(s->fd, text, len);
+      return;
+    }
+
+  LogRing* r = myRing;
+  if (r == NULL)
+    {
+      r = new LogRing;
+      r->head = r->tail = 0;
+      r->dead = false;
+      {
+	lock_guard<mutex> lk(s->mtx);
+	s->rings.push_back(r);
+      }
+      myRing = r;
+      (void) &ringOwner;		// make sure the owner is constructed
+    }
+
+  unsigned head = r->head.load(memory_order_relaxed);
+  while (LOGBUFSIZE - (head - r->tail.load(memory_order_acquire)) < (unsigned) len)
+    {
+      // ring is full: warnings and errors wait for the flusher, the
+      // rest is dropped rather than slowing down the caller
+      if (level > LLWARN)
+	{
+	  s->dropped++;
+	  return;
+	}
+      logFlush();
+    }
+
+  unsigned start = head % LOGBUFSIZE;
+  if (start + len > (unsigned) LOGBUFSIZE)
+    {
+      memcpy(r->data + start, text, LOGBUFSIZE - start);
+      memcpy(r->data, text + (LOGBUFSIZE - start), len - (LOGBUFSIZE - start));
+    }
+  else
+    memcpy(r->data + start, text, len);
+  r->head.store(head + len, memory_order_release);
+
+  if (level == LLERROR)
+    logFlush();
+}
+
+
+void logSetLevel(const int level)
+{
+  logLevel = level;
+}
+
+const bool logOpen(const string & fileName)
+{
+  LogState* s = logState();
+  int fd = 2;
+
+  if (!fileName.empty() &&
+      (fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0666)) < 0)
+    return false;
+
+  lock_guard<mutex> lk(s->mtx);
+  drainAll(s);
+  if (s->fd != 2) ::close(s->fd);
+  s->fd = fd;
+  return true;
+}
+
+void logFlush()
+{
+  LogState* s = logState();
+  unique_lock<mutex> lk(s->mtx);
+
+  if (!s->running)
+    {
+      drainAll(s);
+      return;
+    }
+
+  long target = ++s->flushReq;
+  s->wake.notify_one();
+  s->done.wait(lk, [s, target]() { return s->flushDone >= target || !s->running; });
+}
+
+const long logDropped()
+{
+  return logState()->dropped;
+}
+
+
+// LogLine
+
+LogLine::LogLine(const int lvl)
+{
+  level = lvl;
+  len = 0;
+}
+
+// terminate the line and pass it on
+LogLine::~LogLine()
+{
+  if (len == LOGLINESIZE) len--;
+  text[len++] = '\n';
+  logPut(level, text, len);
+}
+
+void LogLine::append(const char* s, const int n)
+{
+  int room = LOGLINESIZE - 1 - len;	// keep room for the newline
+  int k = n < room ? n : room;
+  memcpy(text + len, s, k);
+  len += k;
+}
+
+LogLine & LogLine::operator<<(const char* s)
+{
+  if (s == NULL) s = "(null)";
+  append(s, strlen(s));
+  return *this;
+}
+
+LogLine & LogLine::operator<<(const string & s)
+{
+  append(s.data(), s.length());
+  return *this;
+}
+
+LogLine & LogLine::operator<<(const char c)
+{
+  append(&c, 1);
+  return *this;
+}
+
+LogLine & LogLine::operator<<(const int i)
+{
+  char buf[16];
+  append(buf, snprintf(buf, sizeof buf, "%d", i));
+  return *this;
+}
+
+LogLine & LogLine::operator<<(const unsigned u)
+{
+  char buf[16];
+  append(buf, snprintf(buf, sizeof buf, "%u", u));
+  return *this;
+}
+
+LogLine & LogLine::operator<<(const long l)
+{
+  char buf[24];
+  append(buf, snprintf(buf, sizeof buf, "%ld", l));
+  return *this;
+}
+
+LogLine & LogLine::operator<<(const unsigned long u)
+{
+  char buf[24];
+  append(buf, snprintf(buf, sizeof buf, "%lu", u));
+  return *this;
+}
+
+LogLine & LogLine::operator<<(const double d)
+{
+  char buf[32];
+  append(buf, snprintf(buf, sizeof buf, "%g", d));
+  return *this;
+}
+
+LogLine & LogLine::operator<<(const void* p)
+{
+  char buf[24];
+  append(buf, snprintf(buf, sizeof buf, "%p", p));
+  return *this;
+}
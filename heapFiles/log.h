@@ -0,0 +1,107 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <string>
+using namespace std;
+
+// Leveled logging.
+//
+// A message is formatted into a LogLine on the caller's stack and
+// copied into a ring buffer owned by the calling thread.  Only that
+// thread writes its ring and only the flusher thread reads it, so
+// logging takes no lock and makes no system call.  The flusher drains
+// all rings every LOGFLUSHMS milliseconds with one write per ring.
+// Errors are flushed before the call returns.
+//
+// Levels above LOGLEVEL are compiled out: their arguments are not even
+// evaluated.  Levels above the runtime level logLevel are skipped with
+// a single compare.
+
+// log levels
+#define LLERROR		0
+#define LLWARN		1
+#define LLINFO		2
+#define LLDEBUG		3
+#define LLTRACE		4
+
+// highest level compiled in; build with -DLOGLEVEL=LLTRACE to get
+// the buffer manager and I/O traces
+#ifndef LOGLEVEL
+#define LOGLEVEL	LLINFO
+#endif
+
+const int LOGLINESIZE = 256;		// longest message, longer ones are cut
+const int LOGBUFSIZE = 64 * 1024;	// size of the ring of each thread
+const int LOGFLUSHMS = 20;		// flusher period
+
+// highest level logged at runtime, LLWARN unless changed
+extern int logLevel;
+
+// change the runtime level
+void logSetLevel(const int level);
+
+// send log output to file fileName, or to stderr if fileName is empty
+const bool logOpen(const string & fileName);
+
+// wait until everything logged so far has been written
+void logFlush();
+
+// number of messages dropped because a ring was full
+const long logDropped();
+
+
+// one message, formatted without iostreams
+class LogLine
+{
+public:
+  LogLine(const int level);
+  ~LogLine();				// hands the message to the logger
+
+  LogLine & operator<<(const char* s);
+  LogLine & operator<<(const string & s);
+  LogLine & operator<<(const char c);
+  LogLine & operator<<(const int i);
+  LogLine & operator<<(const unsigned u);
+  LogLine & operator<<(const long l);
+  LogLine & operator<<(const unsigned long u);
+  LogLine & operator<<(const double d);
+  LogLine & operator<<(const void* p);
+
+private:
+  int	level;
+  int	len;
+  char	text[LOGLINESIZE];
+
+  void append(const char* s, const int n);
+};
+
+#define LOGAT(level, msg) \
+  do { if ((level) <= logLevel) { LogLine logLine_(level); logLine_ << msg; } } while (0)
+
+#define LOGERROR(msg)	LOGAT(LLERROR, msg)
+
+#if LOGLEVEL >= LLWARN
+#define LOGWARN(msg)	LOGAT(LLWARN, msg)
+#else
+#define LOGWARN(msg)	do {} while (0)
+#endif
+
+#if LOGLEVEL >= LLINFO
+#define LOGINFO(msg)	LOGAT(LLINFO, msg)
+#else
+#define LOGINFO(msg)	do {} while (0)
+#endif
+
+#if LOGLEVEL >= LLDEBUG
+#define LOGDEBUG(msg)	LOGAT(LLDEBUG, msg)
+#else
+#define LOGDEBUG(msg)	do {} while (0)
+#endif
+
+#if LOGLEVEL >= LLTRACE
+#define LOGTRACE(msg)	LOGAT(LLTRACE, msg)
+#else
+#define LOGTRACE(msg)	do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,146 @@
+#include <set>
+#include "memgov.h"
+#include "error.h"
+
+// memory governor implementation
+
+extern BufMgr* bufMgr;
+
+static mutex govMutex;			// guards all of the below
+static set<MemGrant*> grants;
+static size_t budget = MEMBUDGET;
+static size_t reservedBytes;
+static size_t peakBytes;
+static int denials;
+static int spillRequests;
+static int framesLent;
+
+static const size_t poolBytes()
+{
+  return bufMgr == NULL ? 0 : (size_t) bufMgr->getNumBufs() * PAGESIZE;
+}
+
+// what the grants together may reserve
+static const size_t operatorLimit()
+{
+  size_t pool = poolBytes();
+  return budget > pool ? budget - pool : 0;
+}
+
+static const size_t fairShare()
+{
+  return grants.empty() ? operatorLimit() : operatorLimit() / grants.size();
+}
+
+
+void setMemoryBudget(const size_t bytes)
+{
+  lock_guard<mutex> lk(govMutex);
+  budget = bytes;
+  if (reservedBytes <= operatorLimit()) return;
+
+  size_t share = fairShare();
+  for (set<MemGrant*>::iterator it = grants.begin(); it != grants.end(); ++it)
+    if ((*it)->bytes > share && !(*it)->spill)
+      {
+	(*it)->spill = true;
+	spillRequests++;
+      }
+}
+
+const MemStats getMemoryStats()
+{
+  lock_guard<mutex> lk(govMutex);
+  MemStats stats;
+  stats.budget = budget;
+  stats.poolBytes = poolBytes();
+  stats.reserved = reservedBytes;
+  stats.peak = peakBytes;
+  stats.grants = grants.size();
+  stats.denials = denials;
+  stats.spillRequests = spillRequests;
+  stats.framesLent = framesLent;
+  return stats;
+}
+
+
+MemGrant::MemGrant()
+{
+  lock_guard<mutex> lk(govMutex);
+  bytes = 0;
+  spill = false;
+  grants.insert(this);
+}
+
+MemGrant::~MemGrant()
+{
+  returnFrames();
+  lock_guard<mutex> lk(govMutex);
+  reservedBytes -= bytes;
+  grants.erase(this);
+}
+
+const Status MemGrant::reserve(const size_t n)
+{
+  lock_guard<mutex> lk(govMutex);
+
+  if (reservedBytes + n > operatorLimit())
+    {
+      // ask the grants holding more than their share to shrink
+      denials++;
+      size_t share = fairShare();
+      for (set<MemGrant*>::iterator it = grants.begin(); it != grants.end(); ++it)
+	if ((*it)->bytes > share && !(*it)->spill)
+	  {
+	    (*it)->spill = true;
+	    spillRequests++;
+	  }
+      return INSUFMEM;
+    }
+
+  bytes += n;
+  reservedBytes += n;
+  if (reservedBytes > peakBytes) peakBytes = reservedBytes;
+  return OK;
+}
+
+void MemGrant::release(const size_t n)
+{
+  lock_guard<mutex> lk(govMutex);
+  size_t m = n < bytes ? n : bytes;
+
+  bytes -= m;
+  reservedBytes -= m;
+  if (spill && (bytes <= fairShare() || reservedBytes <= operatorLimit() / 2))
+    spill = false;
+}
+
+const Status MemGrant::resize(const size_t n)
+{
+  if (n > bytes) return reserve(n - bytes);
+  release(bytes - n);
+  return OK;
+}
+
+const Status MemGrant::borrowFrames(const int n)
+{
+  Status status;
+
+  if (bufMgr == NULL) return BUFFEREXCEEDED;
+  if ((status = bufMgr->borrowFrames(n, lent)) != OK) return status;
+  lock_guard<mutex> lk(govMutex);
+  framesLent += n;
+  return OK;
+}
+
+const Status MemGrant::returnFrames()
+{
+  Status status;
+
+  if (lent.empty()) return OK;
+  if ((status = bufMgr->returnFrames(lent)) != OK) return status;
+  lock_guard<mutex> lk(govMutex);
+  framesLent -= lent.size();
+  lent.clear();
+  return OK;
+}
@@ -0,0 +1,84 @@
+#ifndef MEMGOV_H
+#define MEMGOV_H
+
+#include <atomic>
+#include "page.h"
+#include "buf.h"
+
+// Memory governor.
+//
+// Operators that hold data in memory (hash tables, sort runs, caches)
+// account for it in a MemGrant.  All grants draw on one budget, which
+// also covers the buffer pool: what operators may reserve is the
+// budget less the size of the pool.
+//
+// When a reservation cannot be granted, reserve returns INSUFMEM and
+// the operator should spill (write out or drop what it holds) instead
+// of growing.  The refusal also asks the grants holding more than an
+// even share of the operator memory to shrink: their mustSpill turns
+// true until they have released enough.
+//
+// An operator may also borrow frames of the buffer pool as working
+// memory, one page each.  They are not counted in the budget, since
+// the pool is already.
+
+const size_t MEMBUDGET = 256 * 1024 * 1024;	// default budget, bytes
+
+struct MemStats
+{
+  size_t	budget;		// bytes, buffer pool included
+  size_t	poolBytes;	// of the buffer pool
+  size_t	reserved;	// by all grants
+  size_t	peak;		// most reserved at any time
+  int		grants;		// live grants
+  int		denials;	// reservations refused
+  int		spillRequests;	// grants asked to shrink
+  int		framesLent;	// buffer frames held by grants
+};
+
+// set the budget (bytes, buffer pool included).  grants over their
+// share of a smaller budget are asked to shrink
+void setMemoryBudget(const size_t bytes);
+
+const MemStats getMemoryStats();
+
+class MemGrant
+{
+public:
+  MemGrant();
+  ~MemGrant();			// gives back everything held
+
+  // grow the grant by bytes; INSUFMEM if the budget is exhausted
+  const Status reserve(const size_t bytes);
+
+  // shrink the grant by bytes (at most what it holds)
+  void release(const size_t bytes);
+
+  // make the grant hold bytes; INSUFMEM if it cannot grow that far
+  const Status resize(const size_t bytes);
+
+  const size_t reserved() const { return bytes; }
+
+  // true when the operator should spill and release memory
+  const bool mustSpill() const { return spill; }
+
+  // borrow n buffer frames; they are appended to frames()
+  const Status borrowFrames(const int n);
+
+  // give back all borrowed frames
+  const Status returnFrames();
+
+  const vector<Page*> & frames() const { return lent; }
+
+private:
+  friend void setMemoryBudget(const size_t bytes);
+
+  size_t	bytes;		// guarded by the governor's mutex
+  atomic<bool>	spill;
+  vector<Page*>	lent;
+
+  MemGrant(const MemGrant &);
+  MemGrant & operator=(const MemGrant &);
+};
+
+#endif
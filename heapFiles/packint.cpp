@@ -0,0 +1,533 @@
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "packint.h"
+#include "error.h"
+
+// ----------------------------------------------------------------------
+// code encoding helpers
+// ----------------------------------------------------------------------
+
+// number of bits needed to hold codes in [0, range]
+static int bitsFor(const unsigned int range)
+{
+    int bits = 0;
+    while (bits < 32 && (range >> bits) != 0) bits++;
+    return bits;
+}
+
+// number of codes that fit on a packed page at a given width
+static int codesFor(const int bits)
+{
+    if (bits == 0) return PACKMAXCODES;
+    int n = PACKWORDS * 64 / bits;
+    return n < PACKMAXCODES ? n : PACKMAXCODES;
+}
+
+// store code i of width bits; words must be zeroed beforehand
+static void putCode(unsigned long long* words, const int i,
+                    const int bits, const unsigned int code)
+{
+    if (bits == 0) return;
+    long bit = (long) i * bits;
+    int word = bit >> 6;
+    int shift = bit & 63;
+    words[word] |= (unsigned long long) code << shift;
+    if (shift + bits > 64)
+        words[word + 1] |= (unsigned long long) code >> (64 - shift);
+}
+
+// unpack n (<= 64) codes starting at code first into out
+static void unpackCodes(const unsigned long long* words, const int first,
+                        const int n, const int bits, unsigned int* out)
+{
+    if (bits == 0)
+    {
+        for (int i = 0; i < n; i++) out[i] = 0;
+        return;
+    }
+    const unsigned long long mask = (1ULL << bits) - 1;
+    for (int i = 0; i < n; i++)
+    {
+        long bit = (long) (first + i) * bits;
+        int word = bit >> 6;
+        int shift = bit & 63;
+        unsigned long long lo = words[word] >> shift;
+        // the high part is only needed when a code straddles two words
+        unsigned long long hi = (shift + bits > 64)
+            ? words[word + 1] << (64 - shift) : 0;
+        out[i] = (unsigned int) ((lo | hi) & mask);
+    }
+}
+
+
+// evaluate "value op filter" on every code of a packed page.  the
+// predicate is first turned into a range [clo, chi] of matching codes,
+// so each code costs one subtraction and one unsigned compare
+
+const int PackedIntPage::match(const Operator op, const int filter,
+                               unsigned char* hits) const
+{
+    long long maxCode = (bits == 0) ? 0 : ((1LL << bits) - 1);
+    long long v = (long long) filter - base;	// filter in the code domain
+    long long lo = 0, hi = maxCode;
+    bool negate = false;
+
+    switch (op) {
+    case LT:  hi = v - 1; break;
+    case LTE: hi = v; break;
+    case EQ:  lo = hi = v; break;
+    case GTE: lo = v; break;
+    case GT:  lo = v + 1; break;
+    case NE:  lo = hi = v; negate = true; break;
+    default:  break;		// the other operators don't use columns
+    }
+    if (lo < 0) lo = 0;
+    if (hi > maxCode) hi = maxCode;
+
+    if (lo > hi)
+    {
+        // no code is in range
+        memset(hits, negate ? 1 : 0, numCodes);
+        return negate ? numCodes : 0;
+    }
+
+    unsigned int clo = (unsigned int) lo;
+    unsigned int span = (unsigned int) (hi - lo);
+    unsigned int codes[64];
+    int count = 0;
+
+#ifdef __SSE2__
+    // SSE2 only compares signed integers; with both sides offset by
+    // 2^31 the signed compare gives the unsigned order
+    const __m128i bias = _mm_set1_epi32(0x80000000);
+    const __m128i vlo = _mm_set1_epi32(clo);
+    const __m128i vspan = _mm_xor_si128(_mm_set1_epi32(span), bias);
+#endif
+    for (int first = 0; first < numCodes; first += 64)
+    {
+        int n = numCodes - first < 64 ? numCodes - first : 64;
+        int i = 0;
+        unpackCodes(words, first, n, bits, codes);
+#ifdef __SSE2__
+        // four codes at a time
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128i c = _mm_loadu_si128((const __m128i*) &codes[i]);
+            __m128i out = _mm_cmpgt_epi32(_mm_xor_si128(_mm_sub_epi32(c, vlo), bias),
+                                          vspan);
+            int mask = _mm_movemask_ps(_mm_castsi128_ps(out)) ^ (negate ? 0 : 0xf);
+            for (int k = 0; k < 4; k++)
+                hits[first + i + k] = (mask >> k) & 1;
+            count += __builtin_popcount(mask);
+        }
+#endif
+        for (; i < n; i++)
+        {
+            unsigned char in = (codes[i] - clo) <= span;
+            hits[first + i] = in ^ negate;
+            count += in ^ negate;
+        }
+    }
+    return count;
+}
+
+
+// ----------------------------------------------------------------------
+// building a packed column
+// ----------------------------------------------------------------------
+
+// values of one data page, indexed by slot number
+struct PackGroup
+{
+    int pageNo;
+    vector<int> vals;
+};
+
+// write the groups accumulated so far onto a new packed page and link
+// it behind the page prevPageNo (the column header when -1)
+
+static const Status flushPackedPage(File* file, PackedColHdr* hdr,
+                                    int& prevPageNo,
+                                    vector<PackGroup>& groups,
+                                    const int minVal, const int maxVal)
+{
+    Status status;
+    Page* page;
+    int pageNo;
+
+    status = bufMgr->allocPage(file, pageNo, page);
+    if (status != OK) return status;
+
+    PackedIntPage* pp = (PackedIntPage*) page;
+    memset(pp, 0, sizeof(PackedIntPage));
+    pp->nextPage = -1;
+    pp->base = minVal;
+    pp->bits = bitsFor((unsigned int) ((long long) maxVal - minVal));
+    pp->numDir = groups.size();
+
+    int code = 0;
+    for (unsigned g = 0; g < groups.size(); g++)
+    {
+        pp->dir[g].pageNo = groups[g].pageNo;
+        pp->dir[g].firstCode = code;
+        pp->dir[g].numSlots = groups[g].vals.size();
+        for (unsigned i = 0; i < groups[g].vals.size(); i++, code++)
+            putCode(pp->words, code, pp->bits,
+                    (unsigned int) ((long long) groups[g].vals[i] - minVal));
+    }
+    pp->numCodes = code;
+
+    // link the new page in
+    if (prevPageNo == -1) hdr->firstPage = pageNo;
+    else
+    {
+        Page* prev;
+        status = bufMgr->readPage(file, prevPageNo, prev);
+        if (status != OK) return status;
+        ((PackedIntPage*) prev)->nextPage = pageNo;
+        status = bufMgr->unPinPage(file, prevPageNo, true);
+        if (status != OK) return status;
+    }
+    prevPageNo = pageNo;
+    hdr->pageCnt++;
+    hdr->valCnt += code;
+
+    LOGDEBUG("packed page " << pageNo << ": " << code << " codes of "
+             << pp->bits << " bits over " << pp->numDir << " data pages");
+
+    groups.clear();
+    return bufMgr->unPinPage(file, pageNo, true);
+}
+
+// add the values of one data page to the packed page being built,
+// flushing it first if the group would not fit
+
+static const Status addPackGroup(File* file, PackedColHdr* hdr,
+                                 int& prevPageNo, vector<PackGroup>& groups,
+                                 int& numCodes, int& minVal, int& maxVal,
+                                 PackGroup& group)
+{
+    Status status;
+    int gmin = group.vals[0], gmax = group.vals[0];
+    for (unsigned i = 1; i < group.vals.size(); i++)
+    {
+        if (group.vals[i] < gmin) gmin = group.vals[i];
+        if (group.vals[i] > gmax) gmax = group.vals[i];
+    }
+
+    if (!groups.empty())
+    {
+        int nmin = gmin < minVal ? gmin : minVal;
+        int nmax = gmax > maxVal ? gmax : maxVal;
+        int bits = bitsFor((unsigned int) ((long long) nmax - nmin));
+        if ((int) groups.size() == PACKDIRSIZE ||
+            numCodes + (int) group.vals.size() > codesFor(bits))
+        {
+            status = flushPackedPage(file, hdr, prevPageNo, groups,
+                                     minVal, maxVal);
+            if (status != OK) return status;
+        }
+    }
+
+    if (groups.empty())
+    {
+        numCodes = 0;
+        minVal = gmin;
+        maxVal = gmax;
+    }
+    else
+    {
+        if (gmin < minVal) minVal = gmin;
+        if (gmax > maxVal) maxVal = gmax;
+    }
+    numCodes += group.vals.size();
+    groups.push_back(group);
+    return OK;
+}
+
+// routine to create a packed column.  the relation is scanned in page
+// order; every data page becomes one directory entry.  slots that are
+// empty or hold records too short for the attribute get a filler code,
+// which is harmless since candidates are always rechecked on the record
+
+const Status createPackedColumn(const string & relName, const int offset,
+                                const string & colName)
+{
+    Status status, scanStatus;
+    File* file;
+    Page* page;
+    int hdrPageNo;
+
+    if (offset < 0) return BADSCANPARM;
+    if (sizeof(PackedIntPage) > sizeof(Page)) return BADPAGEPTR;
+
+    HeapFileScan scan(relName, scanStatus);
+    if (scanStatus != OK) return scanStatus;
+    scanStatus = scan.startScan(0, 0, STRING, NULL, EQ);
+    if (scanStatus != OK) return scanStatus;
+
+    status = db.createFile(colName);
+    if (status != OK) return status;
+    status = db.openFile(colName, file);
+    if (status != OK) return status;
+
+    status = bufMgr->allocPage(file, hdrPageNo, page);
+    if (status != OK) { db.closeFile(file); return status; }
+    PackedColHdr* hdr = (PackedColHdr*) page;
+    memset(hdr, 0, sizeof(PackedColHdr));
+    strncpy(hdr->relName, relName.c_str(), MAXNAMESIZE - 1);
+    hdr->offset = offset;
+    hdr->modCnt = scan.getModCnt();
+    hdr->firstPage = -1;
+
+    vector<PackGroup> groups;
+    PackGroup group;
+    int numCodes = 0, minVal = 0, maxVal = 0;
+    int prevPageNo = -1;
+    RID rid;
+    Record rec;
+
+    group.pageNo = -1;
+    while (status == OK && (scanStatus = scan.scanNext(rid)) == OK)
+    {
+        if (rid.pageNo != group.pageNo)
+        {
+            if (group.pageNo != -1)
+                status = addPackGroup(file, hdr, prevPageNo, groups,
+                                      numCodes, minVal, maxVal, group);
+            group.pageNo = rid.pageNo;
+            group.vals.clear();
+        }
+        if (status != OK) break;
+
+        scan.getRecord(rec);
+        int val;
+        if (offset + (int) sizeof(int) <= rec.length)
+            memcpy(&val, (char*) rec.data + offset, sizeof(int));
+        else
+            val = group.vals.empty() ? 0 : group.vals.back();
+
+        // pad skipped slots with the value itself as filler
+        while ((int) group.vals.size() < rid.slotNo)
+            group.vals.push_back(val);
+        group.vals.push_back(val);
+    }
+    if (status == OK && scanStatus != FILEEOF) status = scanStatus;
+
+    if (status == OK && group.pageNo != -1)
+        status = addPackGroup(file, hdr, prevPageNo, groups,
+                              numCodes, minVal, maxVal, group);
+    if (status == OK && !groups.empty())
+        status = flushPackedPage(file, hdr, prevPageNo, groups,
+                                 minVal, maxVal);
+
+    Status unpinStatus = bufMgr->unPinPage(file, hdrPageNo, true);
+    if (status == OK) status = unpinStatus;
+    db.closeFile(file);
+    return status;
+}
+
+// routine to destroy a packed column
+const Status destroyPackedColumn(const string & colName)
+{
+    return db.destroyFile(colName);
+}
+
+
+// ----------------------------------------------------------------------
+// scanning with a packed column
+// ----------------------------------------------------------------------
+
+PackedIntScan::PackedIntScan(const string & relName_,
+                             const string & colName_,
+                             Status & status) : HeapFileScan(relName_, status)
+{
+    relName = relName_;
+    colName = colName_;
+    colFile = NULL;
+    colHdr = NULL;
+    packed = false;
+    if (status != OK) return;
+    status = openColumn();
+}
+
+PackedIntScan::~PackedIntScan()
+{
+    endScan();
+    closeColumn();
+}
+
+// open the column and pin its header page
+const Status PackedIntScan::openColumn()
+{
+    Status status;
+    Page* page;
+
+    if ((status = db.openFile(colName, colFile)) != OK)
+    {
+        colFile = NULL;
+        return status;
+    }
+    if ((status = colFile->getFirstPage(colHdrPageNo)) != OK) return status;
+    if ((status = bufMgr->readPage(colFile, colHdrPageNo, page)) != OK) return status;
+    colHdr = (PackedColHdr*) page;
+
+    if (strncmp(colHdr->relName, relName.c_str(), MAXNAMESIZE) != 0)
+        return BADFILE;
+    return OK;
+}
+
+void PackedIntScan::closeColumn()
+{
+    Status status;
+
+    if (colHdr != NULL)
+    {
+        status = bufMgr->unPinPage(colFile, colHdrPageNo, false);
+        if (status != OK) LOGERROR("error in unpin of column header page");
+        colHdr = NULL;
+    }
+    if (colFile != NULL)
+    {
+        status = db.closeFile(colFile);
+        if (status != OK) LOGERROR("error in closefile call");
+        colFile = NULL;
+    }
+}
+
+// build the column again from the relation as it is now.  fails, and
+// leaves the old column, while another scan has it open
+const Status PackedIntScan::rebuildColumn()
+{
+    Status status, openStatus;
+    int offset = colHdr->offset;
+
+    closeColumn();
+    status = destroyPackedColumn(colName);
+    if (status == OK) status = createPackedColumn(relName, offset, colName);
+    openStatus = openColumn();
+    return status != OK ? status : openStatus;
+}
+
+const Status PackedIntScan::startScan(const int offset_,
+                                      const int length_,
+                                      const Datatype type_,
+                                      const char* filter_,
+                                      const Operator op_)
+{
+    Status status = HeapFileScan::startScan(offset_, length_, type_,
+                                            filter_, op_);
+    if (status != OK) return status;
+
+    // only a column over the filter attribute can be used.  a
+    // synchronized scan reads the pages of the relation with the
+    // other scans instead
+    packed = (filter_ != NULL && type_ == INTEGER && !syncOn() &&
+              colHdr != NULL && offset_ == colHdr->offset);
+    if (packed && colHdr->modCnt != getModCnt())
+    {
+        // the relation changed since the column was built
+        if (rebuildColumn() != OK)
+            LOGDEBUG("packed column " << colName << " is out of date");
+        packed = colHdr != NULL && colHdr->modCnt == getModCnt();
+    }
+    if (!packed) return OK;
+
+    packOp = op_;
+    memcpy(&packFilter, filter_, sizeof(int));
+    nextPackPage = colHdr->firstPage;
+    cands.clear();
+    nextCand = 0;
+    return OK;
+}
+
+const Status PackedIntScan::startScan(const int offset_,
+                                      const int length_,
+                                      const Datatype type_,
+                                      const char* values_,
+                                      const int valueCnt_)
+{
+    packed = false;
+    return HeapFileScan::startScan(offset_, length_, type_, values_, valueCnt_);
+}
+
+const Status PackedIntScan::endScan()
+{
+    packed = false;
+    cands.clear();
+    nextCand = 0;
+    return HeapFileScan::endScan();
+}
+
+// evaluate the predicate on the next packed page and collect the RIDs
+// of the matching codes.  returns FILEEOF after the last packed page
+
+const Status PackedIntScan::loadCandidates()
+{
+    Status status;
+    Page* page;
+    unsigned char hits[PACKMAXCODES];
+
+    cands.clear();
+    nextCand = 0;
+
+    while (cands.empty())
+    {
+        if (nextPackPage == -1) return FILEEOF;
+
+        int pageNo = nextPackPage;
+        status = bufMgr->readPage(colFile, pageNo, page);
+        if (status != OK) return status;
+        PackedIntPage* pp = (PackedIntPage*) page;
+
+        if (pp->match(packOp, packFilter, hits) > 0)
+        {
+            for (int d = 0; d < pp->numDir; d++)
+                for (int i = 0; i < pp->dir[d].numSlots; i++)
+                    if (hits[pp->dir[d].firstCode + i])
+                    {
+                        RID rid;
+                        rid.pageNo = pp->dir[d].pageNo;
+                        rid.slotNo = i;
+                        cands.push_back(rid);
+                    }
+        }
+        nextPackPage = pp->nextPage;
+
+        status = bufMgr->unPinPage(colFile, pageNo, false);
+        if (status != OK) return status;
+    }
+    return OK;
+}
+
+const Status PackedIntScan::scanNext(RID& outRid)
+{
+    Status status;
+    Record rec;
+
+    if (!packed) return HeapFileScan::scanNext(outRid);
+    if ((status = pastLimit()) != OK) return status;
+
+    while (true)
+    {
+        if (nextCand >= cands.size())
+        {
+            status = loadCandidates();
+            if (status != OK) return status;
+        }
+        RID rid = cands[nextCand++];
+
+        // fetch the candidate, pinning its data page, and recheck it:
+        // filler codes and deleted slots drop out here
+        status = HeapFile::getRecord(rid, rec);
+        if (status == INVALIDSLOTNO) continue;
+        if (status != OK) return status;
+        if (matchRec(rec))
+        {
+            outRid = rid;
+            counted();
+            return OK;
+        }
+    }
+}
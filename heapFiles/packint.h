@@ -0,0 +1,126 @@
+#ifndef PACKINT_H
+#define PACKINT_H
+
+#include "heapfile.h"
+
+// Packed INTEGER columns.
+//
+// A packed column is a read-optimized copy of one INTEGER attribute of
+// a heap file.  Its pages hold the attribute of many consecutive data
+// pages, stored with frame-of-reference encoding (every value is kept
+// as value - base) and bit-packing (every code uses only as many bits
+// as the largest code on the page needs).  Scan predicates are
+// translated into the code domain and evaluated directly on the
+// packed codes, so only data pages that hold a match are read.
+//
+// A column is a snapshot: it remembers the modification count of the
+// relation it was built from.  Once the relation has changed, the next
+// startScan of a PackedIntScan that could use the column rebuilds it,
+// with one scan of the relation; while that is not possible (another
+// scan has the column open) the column is not used.
+
+const int PACKDIRSIZE = 32;     // max data pages covered by a packed page
+const int PACKWORDS = (PAGESIZE - 4*sizeof(int) - PACKDIRSIZE*
+                       (sizeof(int) + 2*sizeof(short))) / sizeof(unsigned long long);
+const int PACKMAXCODES = 4096;  // max codes on a packed page
+
+// one covered data page: slot i of page pageNo is code firstCode+i
+struct PackedDirEntry
+{
+  int	pageNo;
+  short	firstCode;
+  short	numSlots;
+};
+
+// layout of a packed column page; occupies one Page in the buffer pool
+struct PackedIntPage
+{
+  int		nextPage;	// next packed page, -1 if last
+  int		base;		// frame of reference
+  short		bits;		// width of each code (0..32)
+  short		numCodes;	// number of codes on the page
+  short		numDir;		// number of data pages covered
+  short		dummy;		// for alignment purposes
+  PackedDirEntry dir[PACKDIRSIZE];
+  unsigned long long words[PACKWORDS];	// packed codes
+
+  // evaluate "value op filter" for every code on the page.  sets
+  // hits[i] to 1 for matching codes and returns the number of matches
+  const int match(const Operator op, const int filter,
+                  unsigned char* hits) const;
+};
+
+// header page of a packed column file
+struct PackedColHdr
+{
+  char	relName[MAXNAMESIZE];	// relation the column was built from
+  int	offset;			// byte offset of the attribute
+  int	modCnt;			// modification count of relation at build time
+  int	firstPage;		// first packed page, -1 if relation was empty
+  int	pageCnt;		// number of packed pages
+  int	valCnt;			// number of values packed
+};
+
+// build a packed column over the INTEGER at offset of relation relName
+const Status createPackedColumn(const string & relName,
+                                const int offset,
+                                const string & colName);
+
+// remove a packed column
+const Status destroyPackedColumn(const string & colName);
+
+
+// A heap file scan that evaluates INTEGER predicates on a packed
+// column when one that is up to date covers the filter attribute.
+// Any other scan falls back to the regular HeapFileScan behaviour.
+
+class PackedIntScan : public HeapFileScan
+{
+public:
+
+    PackedIntScan(const string & relName, const string & colName,
+                  Status & status);
+    ~PackedIntScan();
+
+    const Status startScan(const int offset,
+                           const int length,
+                           const Datatype type,
+                           const char* filter,
+                           const Operator op);
+
+    // an IN scan does not use the column
+    const Status startScan(const int offset,
+                           const int length,
+                           const Datatype type,
+                           const char* values,
+                           const int valueCnt);
+
+    const Status endScan();
+
+    // return RID of next record that satisfies the scan
+    const Status scanNext(RID& outRid);
+
+    // true if the current scan is being answered from the packed column
+    const bool usingColumn() const { return packed; }
+
+private:
+    string	relName;
+    string	colName;
+    File*	colFile;	// packed column file
+    PackedColHdr* colHdr;	// pinned header page of column
+    int		colHdrPageNo;	// page number of column header page
+
+    bool	packed;		// current scan uses the column
+    Operator	packOp;		// predicate evaluated on the column
+    int		packFilter;
+    int		nextPackPage;	// next packed page to evaluate
+    vector<RID>	cands;		// candidate RIDs from last packed page
+    unsigned	nextCand;	// next candidate to return
+
+    const Status openColumn();
+    void closeColumn();
+    const Status rebuildColumn();
+    const Status loadCandidates();
+};
+
+#endif
@@ -8,6 +8,13 @@ using namespace std;
 // page class constructor
 void Page::init(int pageNo)
 {
+    init(pageNo, 0);
+}
+
+// page class constructor with layout flags (e.g. PAGE_ALIGNED)
+void Page::init(int pageNo, short pageFlags)
+{
+    flags = pageFlags;
     nextPage = -1;
     slotCnt = 0; // no slots in use
     curPage = pageNo;
@@ -23,7 +30,7 @@ void Page::dumpPage() const
 
   cout << "curPage = " << curPage <<", nextPage = " << nextPage
        << "\nfreePtr = " << freePtr << ",  freeSpace = " << freeSpace 
-       << ", slotCnt = " << slotCnt << endl;
+       << ", slotCnt = " << slotCnt << ", flags = " << flags << endl;
     
     for (i=0;i>slotCnt;i--)
       cout << "slot[" << i << "].offset = " << slot[i].offset 
@@ -54,7 +61,10 @@ const short Page::getFreeSpace() const
 const Status Page::insertRecord(const Record & rec, RID& rid)
 {
     RID tmpRid;
-    int spaceNeeded = rec.length + sizeof(slot_t);
+    // aligned pages reserve whole RECALIGN units so the next record
+    // also starts on a boundary
+    int recSpace = isAligned() ? alignedLength(rec.length) : rec.length;
+    int spaceNeeded = recSpace + sizeof(slot_t);
 
     // Start by checking if sufficient space exists
     // This is an upper bound check. may not actually need a slot
@@ -83,7 +93,7 @@ const Status Page::insertRecord(const Record & rec, RID& rid)
 	else 
 	{
 	    // reusing an existing slot 
-	    freeSpace -= rec.length;
+	    freeSpace -= recSpace;
 	}
 
 	// use existing value of slotCnt as the index into slot array
@@ -93,7 +103,7 @@ const Status Page::insertRecord(const Record & rec, RID& rid)
 	slot[i].length = rec.length;
 
 	memcpy(&data[freePtr], rec.data, rec.length); // copy data on to the data page
-	freePtr += rec.length; // adjust freePtr 
+	freePtr += recSpace; // adjust freePtr 
 
 	tmpRid.pageNo = curPage;
 	tmpRid.slotNo = -i; // make a positive slot number
@@ -141,6 +151,9 @@ const Status Page::deleteRecord(const RID & rid)
 	    // case (ii) - compaction required
             int offset = slot[slotNo].offset; // offset of record being deleted
 	    int recLen = slot[slotNo].length; // length of record being deleted
+	    // on aligned pages the hole includes the padding, so shifting
+	    // by it keeps the remaining records on RECALIGN boundaries
+	    if (isAligned()) recLen = alignedLength(recLen);
             char* recPtr = &data[offset];  // get a pointer to the record
 
 	    // get handle on next record
@@ -187,6 +200,70 @@ const Status Page::deleteRecord(const RID & rid)
     else return INVALIDSLOTNO;
 }
 
+// delete several records from a page. The slots are freed first, then
+// the remaining records are moved down in offset order, each once, so
+// the page is compacted once however many records go. The result is
+// the page deleteRecord would leave behind deleting them one by one.
+
+const Status Page::deleteRecords(const RID* rids, const int n)
+{
+    bool gone[PAGESIZE / sizeof(slot_t)];
+    int i, k;
+
+    // check all of them before changing anything
+    memset(gone, 0, (1 - slotCnt) * sizeof(bool));
+    for (k = 0; k < n; k++)
+    {
+        int slotNo = -rids[k].slotNo;
+        if (!(slotNo > slotCnt && slotNo <= 0 && slot[slotNo].length > 0) ||
+            gone[-slotNo])
+            return INVALIDSLOTNO;
+        gone[-slotNo] = true;
+    }
+    if (n == 0) return OK;
+
+    // free the slots, and sort the slots of the remaining records by
+    // offset (they mostly are already)
+    short order[PAGESIZE / sizeof(slot_t)];
+    int left = 0;
+    for (i = 0; i > slotCnt; i--)
+        if (gone[-i])
+        {
+            slot[i].length = -1;
+            slot[i].offset = 0;
+        }
+        else if (slot[i].length >= 0)
+        {
+            int j = left++;
+            while (j > 0 && slot[order[j-1]].offset > slot[i].offset)
+            {
+                order[j] = order[j-1];
+                j--;
+            }
+            order[j] = i;
+        }
+
+    // move them down over the holes
+    int to = 0;
+    for (k = 0; k < left; k++)
+    {
+        slot_t & s = slot[order[k]];
+        if (s.offset != to) bcopy(&data[s.offset], &data[to], s.length);
+        s.offset = to;
+        to += isAligned() ? alignedLength(s.length) : s.length;
+    }
+    freeSpace += freePtr - to;
+    freePtr = to;
+
+    // give up the free slots at the end of the slot array
+    while (slotCnt < 0 && slot[slotCnt + 1].length == -1)
+    {
+        slotCnt++;
+        freeSpace += sizeof(slot_t);
+    }
+    return OK;
+}
+
 // returns RID of first record on page
 const Status Page::firstRecord(RID& firstRid) const
 {
@@ -28,12 +28,25 @@ const unsigned DPFIXED= sizeof(slot_t)+4*sizeof(short)+2*sizeof(int);
 const unsigned PAGEDATASIZE = PAGESIZE-DPFIXED+sizeof(slot_t);
 // size of the data area of a page
 
+// page layout flags
+const short PAGE_ALIGNED = 0x1;	// records start on RECALIGN byte boundaries
+const unsigned RECALIGN = 8;
+
+// amount of data area a record of length len occupies on an aligned page
+inline int alignedLength(const int len)
+{
+    return (len + RECALIGN - 1) & ~(RECALIGN - 1);
+}
+
 // Class definition for a minirel data page.   
 // The design assumes that records are kept compacted when
 // deletions are performed. Notice, however, that the slot
-// array cannot be compacted.  Notice, this class does not keep
-// the records align, relying instead on upper levels to take
-// care of non-aligned attributes
+// array cannot be compacted.  Notice, by default this class does not
+// keep the records align, relying instead on upper levels to take
+// care of non-aligned attributes.  A page initialized with
+// PAGE_ALIGNED pads every record to RECALIGN bytes, both on insertion
+// and during compaction, so that each record starts on a RECALIGN
+// byte boundary of the page.
 
 class Page {
 private:
@@ -42,17 +55,19 @@ private:
     short	slotCnt; // number of slots in use;
     short	freePtr; // offset of first free byte in data[]
     short	freeSpace; // number of bytes free in data[]
-    short	dummy;	// for alignment purposes
+    short	flags;	// page layout flags (PAGE_ALIGNED)
     int		nextPage; // forwards pointer
     int		curPage;  // page number of current pointer
 
 public:
     void init(const int pageNo); // initialize a new page
+    void init(const int pageNo, const short pageFlags); // ditto, with layout flags
     void dumpPage() const;       // dump contents of a page
 
     const Status getNextPage(int& pageNo) const; // returns value of nextPage
     const Status setNextPage(const int pageNo); // sets value of nextPage to pageNo
     const short getFreeSpace() const; // returns amount of free space
+    const bool isAligned() const { return (flags & PAGE_ALIGNED) != 0; }
 
     // inserts a new record (rec) into the page, returns RID of record 
     const Status insertRecord(const Record & rec, RID& rid);
@@ -60,6 +75,11 @@ public:
     // delete the record with the specified rid
     const Status deleteRecord(const RID & rid);
 
+    // delete the n records with the given rids, compacting the page
+    // once.  nothing is deleted if one of them is not a record of the
+    // page (INVALIDSLOTNO)
+    const Status deleteRecords(const RID* rids, const int n);
+
     // returns RID of first record on page
     // returns  NORECORDS if page contains no records.  Otherwise, returns OK
     const Status firstRecord(RID& firstRid) const;
@@ -0,0 +1,313 @@
+#include <string.h>
+#include <list>
+#include <map>
+#include "scancache.h"
+#include "memgov.h"
+#include "error.h"
+
+// scan result cache implementation
+
+// the part of a cached result that came from one data page
+struct CachedPage
+{
+    int			pageNo;
+    unsigned		stamp;		// of the page when it was scanned
+    vector<RID>		rids;
+    vector<int>		lengths;
+    vector<char>	data;
+};
+
+struct CachedScan
+{
+    string		relName;
+    string		key;
+    int			modCnt;		// of the header when last brought up to date
+    long long		mods;		// PageStamps::mods then
+    long long		bumps;		// PageStamps::bumps then
+    int			lastPage;
+    vector<CachedPage>	pages;		// every data page, in file order
+    long		size;		// bytes held
+    list<CachedScan*>::iterator	lruPos;
+};
+
+// page stamps by heap file name
+static mutex stampsMutex;
+static map<string, PageStamps*> stampsOf;
+
+static mutex cacheMutex;		// guards the cache and its statistics
+static map<string, CachedScan*> cache;	// by key
+static list<CachedScan*> lru;		// most recently used first
+static long cacheSize;
+static MemGrant* cacheGrant;		// cacheSize, as accounted to the governor
+static ScanCacheStats stats;
+
+
+PageStamps* PageStamps::of(const string & fileName)
+{
+    lock_guard<mutex> lk(stampsMutex);
+    map<string, PageStamps*>::iterator it = stampsOf.find(fileName);
+    return it == stampsOf.end() ? NULL : it->second;
+}
+
+void PageStamps::changed(const int pageNo, const int newMods)
+{
+    lock_guard<mutex> lk(mtx);
+    if (pageNo >= 0)
+    {
+        if ((unsigned) pageNo >= pages.size()) pages.resize(pageNo + 1, 0);
+        pages[pageNo]++;
+        bumps++;
+    }
+    mods += newMods;
+}
+
+
+// A heap file scan that reads one page at a time into the cache.
+
+class CacheScan : public HeapFileScan
+{
+public:
+    CacheScan(const string & name, Status & status) : HeapFileScan(name, status) {}
+
+    const FileHdrPage* header() const { return headerPage; }
+
+    // put the matching records of page pageNo into part and return the
+    // number of the page after it
+    const Status scanPage(const int pageNo, CachedPage & part, int & nextPageNo)
+    {
+        Status status;
+        Page* page;
+        RID rid, prevRid;
+        Record rec;
+
+        if ((status = bufMgr->readPage(filePtr, pageNo, page)) != OK) return status;
+        part.pageNo = pageNo;
+        part.rids.clear();
+        part.lengths.clear();
+        part.data.clear();
+        status = page->firstRecord(rid);
+        while (status == OK)
+        {
+            page->getRecord(rid, rec);
+            if (matchRec(rec))
+            {
+                part.rids.push_back(rid);
+                part.lengths.push_back(rec.length);
+                part.data.insert(part.data.end(), (char*) rec.data,
+                                 (char*) rec.data + rec.length);
+            }
+            prevRid = rid;
+            status = page->nextRecord(prevRid, rid);
+        }
+        page->getNextPage(nextPageNo);
+        return bufMgr->unPinPage(filePtr, pageNo, false);
+    }
+};
+
+// the cache key of a scan: relation, then the filter as startScan
+// would apply it
+static const string scanKey(const string & relName, const int offset,
+                            const int length, const Datatype type,
+                            const char* filter, const Operator op)
+{
+    string key = relName;
+    key.push_back('\0');
+    if (filter == NULL) return key;
+
+    int parms[4] = { offset, length, type, op };
+    key.append((const char*) parms, sizeof parms);
+    if (type == STRING)
+        key.append(filter, strnlen(filter, length));
+    else
+        key.append(filter, length);
+    return key;
+}
+
+static long sizeOf(const CachedPage & part)
+{
+    return sizeof part + part.data.size() + part.rids.size() * sizeof(RID) +
+           part.lengths.size() * sizeof(int);
+}
+
+static void drop(CachedScan* c)
+{
+    cache.erase(c->key);
+    lru.erase(c->lruPos);
+    cacheSize -= c->size;
+    delete c;
+}
+
+
+// Return the result of a scan, reusing and updating a cached result
+// where there is one.
+
+const Status cachedScan(const string & relName,
+                        const int offset,
+                        const int length,
+                        const Datatype type,
+                        const char* filter,
+                        const Operator op,
+                        ScanResult & result)
+{
+    Status status = OK;
+    PageStamps* stamps;
+    long long mods, bumps;
+    vector<unsigned> pageStamps;
+
+    // stamps first, so that every change made from now on is stamped
+    {
+        lock_guard<mutex> lk(stampsMutex);
+        PageStamps* & entry = stampsOf[relName];
+        if (entry == NULL)
+        {
+            entry = new PageStamps;
+            entry->mods = entry->bumps = 0;
+        }
+        stamps = entry;
+    }
+
+    CacheScan scan(relName, status);
+    if (status != OK) return status;
+    if ((status = scan.startScan(offset, length, type, filter, op)) != OK)
+        return status;
+
+    lock_guard<mutex> lk(cacheMutex);
+    const FileHdrPage* hdr = scan.header();
+    int modCnt = hdr->modCnt;
+    {
+        lock_guard<mutex> slk(stamps->mtx);
+        mods = stamps->mods;
+        bumps = stamps->bumps;
+        pageStamps = stamps->pages;
+    }
+
+    string key = scanKey(relName, offset, length, type, filter, op);
+    map<string, CachedScan*>::iterator it = cache.find(key);
+    CachedScan* c = it == cache.end() ? NULL : it->second;
+    int pageNo;
+
+    if (c != NULL && c->modCnt == modCnt && c->bumps == bumps)
+        stats.hits++;
+    else if (c != NULL && modCnt - c->modCnt == mods - c->mods)
+    {
+        // every change was stamped: scan the pages that changed
+        stats.updates++;
+        for (unsigned i = 0; i < c->pages.size() && status == OK; i++)
+        {
+            CachedPage & part = c->pages[i];
+            unsigned now = (unsigned) part.pageNo < pageStamps.size() ?
+                           pageStamps[part.pageNo] : 0;
+            if (part.stamp == now && !(part.pageNo == c->lastPage &&
+                                       hdr->lastPage != c->lastPage))
+                continue;
+            cacheSize -= sizeOf(part);
+            c->size -= sizeOf(part);
+            part.stamp = now;
+            status = scan.scanPage(part.pageNo, part, pageNo);
+            cacheSize += sizeOf(part);
+            c->size += sizeOf(part);
+            stats.pagesRead++;
+
+            // then the pages added after the old last page
+            if (part.pageNo == c->lastPage && hdr->lastPage != c->lastPage)
+                while (status == OK && pageNo != -1)
+                {
+                    CachedPage added;
+                    added.stamp = (unsigned) pageNo < pageStamps.size() ?
+                                  pageStamps[pageNo] : 0;
+                    status = scan.scanPage(pageNo, added, pageNo);
+                    cacheSize += sizeOf(added);
+                    c->size += sizeOf(added);
+                    stats.pagesRead++;
+                    c->pages.push_back(added);
+                }
+        }
+    }
+    else
+    {
+        // compute the result afresh
+        stats.misses++;
+        if (c == NULL)
+        {
+            c = new CachedScan;
+            c->relName = relName;
+            c->key = key;
+            c->size = 0;
+            lru.push_front(c);
+            c->lruPos = lru.begin();
+            cache[key] = c;
+        }
+        cacheSize -= c->size;
+        c->size = 0;
+        c->pages.clear();
+        pageNo = hdr->firstPage;
+        while (status == OK && pageNo != -1)
+        {
+            CachedPage part;
+            part.stamp = (unsigned) pageNo < pageStamps.size() ? pageStamps[pageNo] : 0;
+            status = scan.scanPage(pageNo, part, pageNo);
+            c->size += sizeOf(part);
+            stats.pagesRead++;
+            c->pages.push_back(part);
+        }
+        cacheSize += c->size;
+    }
+    if (status != OK)
+    {
+        drop(c);
+        return status;
+    }
+    c->modCnt = modCnt;
+    c->mods = mods;
+    c->bumps = bumps;
+    c->lastPage = hdr->lastPage;
+
+    // hand out a copy
+    result.rids.clear();
+    result.offsets.clear();
+    result.data.clear();
+    for (unsigned i = 0; i < c->pages.size(); i++)
+    {
+        const CachedPage & part = c->pages[i];
+        result.rids.insert(result.rids.end(), part.rids.begin(), part.rids.end());
+        int start = result.data.size();
+        for (unsigned j = 0; j < part.lengths.size(); j++)
+        {
+            result.offsets.push_back(start);
+            start += part.lengths[j];
+        }
+        result.data.insert(result.data.end(), part.data.begin(), part.data.end());
+    }
+    result.offsets.push_back(result.data.size());
+
+    // keep the most recently used results that fit, and that the
+    // memory governor lets the cache hold
+    lru.erase(c->lruPos);
+    lru.push_front(c);
+    c->lruPos = lru.begin();
+    if (cacheGrant == NULL) cacheGrant = new MemGrant;
+    while (!lru.empty() &&
+           (cacheSize > SCANCACHESIZE || cacheGrant->resize(cacheSize) != OK ||
+            cacheGrant->mustSpill()))
+        drop(lru.back());
+    cacheGrant->resize(cacheSize);
+    return OK;
+}
+
+void dropCachedScans(const string & relName)
+{
+    lock_guard<mutex> lk(cacheMutex);
+    list<CachedScan*>::iterator it = lru.begin();
+    while (it != lru.end())
+    {
+        CachedScan* c = *it++;
+        if (c->relName == relName) drop(c);
+    }
+    if (cacheGrant != NULL) cacheGrant->resize(cacheSize);
+}
+
+const ScanCacheStats getScanCacheStats()
+{
+    lock_guard<mutex> lk(cacheMutex);
+    return stats;
+}
@@ -0,0 +1,105 @@
+#ifndef SCANCACHE_H
+#define SCANCACHE_H
+
+#include <mutex>
+#include "heapfile.h"
+
+// Scan result cache.
+//
+// cachedScan returns the records a HeapFileScan with the same filter
+// would, in the same order, and keeps them for the next identical
+// request.  A cached result remembers the modification count of the
+// relation and a stamp of every page it read.  On reuse:
+//
+//  - an unchanged modification count means the result is still
+//    good, and it is returned with no page read but the header's;
+//  - when all changes since were made through heap files of this
+//    process, only the pages whose stamp moved, and pages added at the
+//    end, are scanned again and their part of the result replaced;
+//  - otherwise the result is computed afresh.
+//
+// Page stamps are kept in memory from the first cached scan of a
+// relation on.  Changes through heap files opened before that, or by
+// other processes, are noticed through the modification count and
+// cost a full scan.  Records inserted by an insert scan that has not
+// yet added its counts to the header (see InsertFileScan) may be
+// missed by a reused result.
+//
+// Results are kept up to SCANCACHESIZE bytes in all, and no more than
+// the memory governor grants the cache; the least recently used are
+// dropped first.
+
+const int SCANCACHESIZE = 4 * 1024 * 1024;
+
+// records returned by cachedScan, in scan order
+struct ScanResult
+{
+    vector<RID>		rids;
+    vector<int>		offsets;	// of each record in data, then the end
+    vector<char>	data;
+
+    int size() const { return rids.size(); }
+    const Record record(const int i)
+    {
+        Record rec;
+        rec.data = &data[offsets[i]];
+        rec.length = offsets[i + 1] - offsets[i];
+        return rec;
+    }
+};
+
+struct ScanCacheStats
+{
+    int		hits;		// results reused as they were
+    int		updates;	// results brought up to date page by page
+    int		misses;		// results computed by a full scan
+    int		pagesRead;	// pages scanned for updates and misses
+};
+
+// return the records of relation relName that match the filter, as
+// HeapFileScan::startScan would select them
+const Status cachedScan(const string & relName,
+                        const int offset,
+                        const int length,
+                        const Datatype type,
+                        const char* filter,
+                        const Operator op,
+                        ScanResult & result);
+
+// forget the cached results for relation relName.  called when its heap
+// file is destroyed
+void dropCachedScans(const string & relName);
+
+const ScanCacheStats getScanCacheStats();
+
+
+// Modification stamps of the pages of one heap file.  Used by HeapFile.
+
+class PageStamps
+{
+public:
+    // the stamps of heap file fileName, NULL if no cached scan has
+    // used it.  the object is never deleted
+    static PageStamps* of(const string & fileName);
+
+    // a record on page pageNo (if not -1) changed and mods were added
+    // to the modification count of the header
+    void changed(const int pageNo, const int mods);
+
+private:
+    mutex		mtx;
+    long long		mods;		// added to the header modification count
+    long long		bumps;		// stamps moved, in all
+    vector<unsigned>	pages;		// stamp of each page, by page number
+
+    const unsigned stamp(const int pageNo) const
+    {
+        return (unsigned) pageNo < pages.size() ? pages[pageNo] : 0;
+    }
+
+    friend const Status cachedScan(const string &, const int, const int,
+                                   const Datatype, const char*,
+                                   const Operator, ScanResult &);
+};
+
+#endif
@@ -0,0 +1,634 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include "server.h"
+#include "error.h"
+
+// query server implementation
+
+// write the buffers out completely
+static const bool sendAll(const int fd, struct iovec* iov, int cnt)
+{
+  while (cnt > 0)
+    {
+      struct msghdr msg;
+      memset(&msg, 0, sizeof msg);
+      msg.msg_iov = iov;
+      msg.msg_iovlen = cnt < MAXIOV ? cnt : MAXIOV;
+
+      ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+      if (n < 0)
+	{
+	  if (errno == EINTR) continue;
+	  return false;
+	}
+      while (cnt > 0 && (size_t) n >= iov->iov_len)
+	{
+	  n -= iov->iov_len;
+	  iov++;
+	  cnt--;
+	}
+      if (cnt > 0)
+	{
+	  iov->iov_base = (char*) iov->iov_base + n;
+	  iov->iov_len -= n;
+	}
+    }
+  return true;
+}
+
+static const bool sockAddr(const string & path, struct sockaddr_un & addr)
+{
+  memset(&addr, 0, sizeof addr);
+  addr.sun_family = AF_UNIX;
+  if (path.length() >= sizeof addr.sun_path) return false;
+  strcpy(addr.sun_path, path.c_str());
+  return true;
+}
+
+
+// ----------------------------------------------------------------------
+// one connection
+// ----------------------------------------------------------------------
+
+// Requests are taken from a read buffer; replies are collected in out
+// and written when no complete request is left in the buffer, so the
+// replies to a pipelined series of requests leave in one write.
+
+class Connection
+{
+public:
+  Connection(const int fd_, mutex & execMutex_)
+    : fd(fd_), execMutex(execMutex_), inStart(0), inEnd(0) {}
+  ~Connection();
+
+  void run();
+
+private:
+  int				fd;
+  mutex &			execMutex;
+  char				in[SERVERBUFSIZE];
+  int				inStart, inEnd;
+  vector<char>			out;
+  map<string, HeapFile*>	files;		// opened for lookups
+  map<string, InsertFileScan*>	inserters;
+
+  const bool nextRequest(RequestHdr & hdr, char* & payload);
+  const bool flushOut(const void* extra, const int extraLen);
+  void replyHdr(const int id, const Status status, const int recCnt,
+                const int more, const int len);
+  void reply(const int id, const Status status, const int recCnt,
+             const int more, const void* data, const int len);
+  void addRecord(vector<char> & buf, const RID & rid, const Record & rec);
+
+  void doLookup(const int id, const char* payload, const int len);
+  void doInsert(const int id, const char* payload, const int len);
+  const bool doScan(const int id, const char* payload, const int len);
+};
+
+Connection::~Connection()
+{
+  lock_guard<mutex> lk(execMutex);
+  for (map<string, HeapFile*>::iterator it = files.begin();
+       it != files.end(); ++it)
+    delete it->second;
+  for (map<string, InsertFileScan*>::iterator it = inserters.begin();
+       it != inserters.end(); ++it)
+    delete it->second;
+}
+
+// get the next request from the read buffer, reading more if needed.
+// false at end of input or on a malformed header
+const bool Connection::nextRequest(RequestHdr & hdr, char* & payload)
+{
+  while (true)
+    {
+      int avail = inEnd - inStart;
+      if (avail >= (int) sizeof hdr)
+	{
+	  memcpy(&hdr, in + inStart, sizeof hdr);
+	  if (hdr.length < 0 ||
+	      hdr.length > (hdr.type == REQSCAN ? MAXSCANREQUEST : MAXREQUEST))
+	    return false;
+	  if (avail >= (int) sizeof hdr + hdr.length)
+	    {
+	      payload = in + inStart + sizeof hdr;
+	      inStart += sizeof hdr + hdr.length;
+	      return true;
+	    }
+	}
+
+      // about to wait for the client: send what we have first
+      if (!flushOut(NULL, 0)) return false;
+      if (inStart > 0)
+	{
+	  memmove(in, in + inStart, avail);
+	  inStart = 0;
+	  inEnd = avail;
+	}
+      ssize_t n = ::read(fd, in + inEnd, SERVERBUFSIZE - inEnd);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return false;
+      inEnd += n;
+    }
+}
+
+// write out the collected replies followed by extra
+const bool Connection::flushOut(const void* extra, const int extraLen)
+{
+  struct iovec iov[2];
+  int cnt = 0;
+
+  if (!out.empty())
+    {
+      iov[cnt].iov_base = &out[0];
+      iov[cnt++].iov_len = out.size();
+    }
+  if (extraLen > 0)
+    {
+      iov[cnt].iov_base = (void*) extra;
+      iov[cnt++].iov_len = extraLen;
+    }
+  bool ok = sendAll(fd, iov, cnt);
+  out.clear();
+  return ok;
+}
+
+// add a reply header for a payload of len bytes to the collected replies
+void Connection::replyHdr(const int id, const Status status, const int recCnt,
+                          const int more, const int len)
+{
+  ReplyHdr hdr;
+  hdr.length = len;
+  hdr.id = id;
+  hdr.status = status;
+  hdr.recCnt = recCnt;
+  hdr.more = more;
+  out.insert(out.end(), (const char*) &hdr, (const char*) (&hdr + 1));
+}
+
+void Connection::reply(const int id, const Status status, const int recCnt,
+                       const int more, const void* data, const int len)
+{
+  replyHdr(id, status, recCnt, more, len);
+  if (len > 0)
+    out.insert(out.end(), (const char*) data, (const char*) data + len);
+}
+
+void Connection::addRecord(vector<char> & buf, const RID & rid,
+                           const Record & rec)
+{
+  ReplyRec rr;
+  rr.rid = rid;
+  rr.length = rec.length;
+  buf.insert(buf.end(), (const char*) &rr, (const char*) (&rr + 1));
+  buf.insert(buf.end(), (const char*) rec.data,
+             (const char*) rec.data + rec.length);
+  buf.resize((buf.size() + 3) & ~3);
+}
+
+void Connection::doLookup(const int id, const char* payload, const int len)
+{
+  LookupRequest req;
+  Status status;
+  Record rec;
+  vector<char> data;
+
+  if (len != (int) sizeof req)
+    {
+      reply(id, BADREQUEST, 0, 0, NULL, 0);
+      return;
+    }
+  memcpy(&req, payload, sizeof req);
+  req.relName[MAXNAMESIZE-1] = '\0';
+
+  {
+    lock_guard<mutex> lk(execMutex);
+    HeapFile* & file = files[req.relName];
+    if (file == NULL)
+      {
+	file = new HeapFile(req.relName, status);
+	if (status != OK)
+	  {
+	    delete file;
+	    files.erase(req.relName);
+	  }
+      }
+    else
+      status = OK;
+    if (status == OK && (status = file->getRecord(req.rid, rec)) == OK)
+      addRecord(data, req.rid, rec);
+  }
+  reply(id, status, status == OK ? 1 : 0, 0,
+        data.empty() ? NULL : &data[0], data.size());
+}
+
+void Connection::doInsert(const int id, const char* payload, const int len)
+{
+  InsertRequest req;
+  Status status;
+  Record rec;
+  RID rid;
+
+  if (len < (int) sizeof req)
+    {
+      reply(id, BADREQUEST, 0, 0, NULL, 0);
+      return;
+    }
+  memcpy(&req, payload, sizeof req);
+  req.relName[MAXNAMESIZE-1] = '\0';
+  rec.data = (void*) (payload + sizeof req);
+  rec.length = len - sizeof req;
+
+  {
+    lock_guard<mutex> lk(execMutex);
+    InsertFileScan* & scan = inserters[req.relName];
+    if (scan == NULL)
+      {
+	scan = new InsertFileScan(req.relName, status);
+	if (status != OK)
+	  {
+	    delete scan;
+	    inserters.erase(req.relName);
+	  }
+      }
+    else
+      status = OK;
+    if (status == OK) status = scan->insertRecord(rec, rid);
+  }
+  if (status == OK) reply(id, OK, 1, 0, &rid, sizeof rid);
+  else reply(id, status, 0, 0, NULL, 0);
+}
+
+// a scan is answered in batches; other requests may execute between
+// them.  false if the connection broke
+const bool Connection::doScan(const int id, const char* payload, const int len)
+{
+  ScanRequest req;
+  Status status;
+  HeapFileScan* scan;
+  vector<char> filter;
+  vector<char> batch;
+  RID rid;
+  Record rec;
+
+  if (len < (int) sizeof req)
+    {
+      reply(id, BADREQUEST, 0, 0, NULL, 0);
+      return true;
+    }
+  memcpy(&req, payload, sizeof req);
+  req.relName[MAXNAMESIZE-1] = '\0';
+  if (req.filterLen != len - (int) sizeof req ||
+      (req.filterLen > 0 && req.filterLen < req.length) ||
+      (req.op == IN && (req.length < 1 || req.filterLen % req.length != 0)))
+    {
+      reply(id, BADREQUEST, 0, 0, NULL, 0);
+      return true;
+    }
+  filter.assign(payload + sizeof req, payload + len);
+
+  {
+    lock_guard<mutex> lk(execMutex);
+    scan = new HeapFileScan(req.relName, status);
+    if (status == OK) scan->syncScan(true);
+    if (status == OK && req.op == IN)
+      status = scan->startScan(req.offset, req.length, (Datatype) req.type,
+                               req.filterLen > 0 ? &filter[0] : NULL,
+                               req.filterLen / req.length);
+    else if (status == OK)
+      status = scan->startScan(req.offset, req.length, (Datatype) req.type,
+                               req.filterLen > 0 ? &filter[0] : NULL,
+                               (Operator) req.op);
+    if (status != OK)
+      {
+	delete scan;
+	scan = NULL;
+      }
+  }
+  if (scan == NULL)
+    {
+      reply(id, status, 0, 0, NULL, 0);
+      return true;
+    }
+
+  bool ok = true;
+  while (ok)
+    {
+      int cnt = 0;
+      {
+	lock_guard<mutex> lk(execMutex);
+	while ((int) batch.size() < SERVERBATCH &&
+	       (status = scan->scanNext(rid)) == OK)
+	  {
+	    scan->getRecord(rec);
+	    addRecord(batch, rid, rec);
+	    cnt++;
+	  }
+      }
+      bool more = status == OK;
+      if (!more && status == FILEEOF) status = OK;
+
+      // the batch goes straight from its buffer, behind the header
+      replyHdr(id, status, cnt, more, batch.size());
+      ok = flushOut(batch.empty() ? NULL : &batch[0], batch.size());
+      batch.clear();
+      if (!more) break;
+    }
+
+  lock_guard<mutex> lk(execMutex);
+  delete scan;
+  return ok;
+}
+
+void Connection::run()
+{
+  RequestHdr hdr;
+  char* payload;
+
+  while (nextRequest(hdr, payload))
+    {
+      switch (hdr.type)
+	{
+	case REQLOOKUP:
+	  doLookup(hdr.id, payload, hdr.length);
+	  break;
+	case REQINSERT:
+	  doInsert(hdr.id, payload, hdr.length);
+	  break;
+	case REQSCAN:
+	  if (!doScan(hdr.id, payload, hdr.length)) return;
+	  break;
+	default:
+	  reply(hdr.id, BADREQUEST, 0, 0, NULL, 0);
+	}
+      if ((int) out.size() >= SERVERBATCH && !flushOut(NULL, 0)) return;
+    }
+}
+
+
+// ----------------------------------------------------------------------
+// QueryServer
+// ----------------------------------------------------------------------
+
+QueryServer::QueryServer(const string & sockPath, Status & status)
+{
+  struct sockaddr_un addr;
+
+  path = sockPath;
+  nextConn = 0;
+  stopping = false;
+  listenFd = -1;
+
+  if (!sockAddr(path, addr))
+    {
+      status = BADFILE;
+      return;
+    }
+  unlink(path.c_str());
+  if ((listenFd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+      bind(listenFd, (struct sockaddr*) &addr, sizeof addr) < 0 ||
+      listen(listenFd, SOMAXCONN) < 0)
+    {
+      LOGERROR("query server cannot listen on " << path << ": " << strerror(errno));
+      if (listenFd >= 0) ::close(listenFd);
+      listenFd = -1;
+      status = UNIXERR;
+      return;
+    }
+
+  acceptor = thread(&QueryServer::acceptLoop, this);
+  LOGINFO("query server listening on " << path);
+  status = OK;
+}
+
+QueryServer::~QueryServer()
+{
+  if (listenFd < 0) return;
+
+  {
+    lock_guard<mutex> lk(connMutex);
+    stopping = true;
+    for (map<int, int>::iterator it = connFds.begin(); it != connFds.end(); ++it)
+      shutdown(it->second, SHUT_RDWR);
+  }
+  shutdown(listenFd, SHUT_RDWR);
+  acceptor.join();
+  ::close(listenFd);
+  unlink(path.c_str());
+
+  for (map<int, thread>::iterator it = conns.begin(); it != conns.end(); ++it)
+    it->second.join();
+}
+
+void QueryServer::acceptLoop()
+{
+  while (true)
+    {
+      int fd = accept(listenFd, NULL, NULL);
+      if (fd < 0)
+	{
+	  if (errno == EINTR || errno == ECONNABORTED) continue;
+	  break;
+	}
+
+      lock_guard<mutex> lk(connMutex);
+      if (stopping)
+	{
+	  ::close(fd);
+	  break;
+	}
+      // join the threads of connections that have ended
+      for (unsigned i = 0; i < finished.size(); i++)
+	{
+	  conns[finished[i]].join();
+	  conns.erase(finished[i]);
+	}
+      finished.clear();
+
+      int connNo = nextConn++;
+      connFds[connNo] = fd;
+      conns[connNo] = thread(&QueryServer::serve, this, connNo, fd);
+    }
+}
+
+void QueryServer::serve(const int connNo, const int fd)
+{
+  {
+    Connection* conn = new Connection(fd, execMutex);
+    conn->run();
+    delete conn;
+  }
+
+  lock_guard<mutex> lk(connMutex);
+  connFds.erase(connNo);
+  finished.push_back(connNo);
+  ::close(fd);
+}
+
+
+// ----------------------------------------------------------------------
+// QueryClient
+// ----------------------------------------------------------------------
+
+QueryClient::QueryClient(const string & sockPath, Status & status)
+{
+  struct sockaddr_un addr;
+
+  inStart = 0;
+  if (!sockAddr(sockPath, addr))
+    {
+      fd = -1;
+      status = BADFILE;
+      return;
+    }
+  if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+      connect(fd, (struct sockaddr*) &addr, sizeof addr) < 0)
+    {
+      if (fd >= 0) ::close(fd);
+      fd = -1;
+      status = UNIXERR;
+      return;
+    }
+  status = OK;
+}
+
+QueryClient::~QueryClient()
+{
+  if (fd >= 0) ::close(fd);
+}
+
+void QueryClient::request(const int type, const int id,
+                          const void* req, const int reqLen,
+                          const void* extra, const int extraLen)
+{
+  RequestHdr hdr;
+  hdr.length = reqLen + extraLen;
+  hdr.type = type;
+  hdr.id = id;
+  out.insert(out.end(), (const char*) &hdr, (const char*) (&hdr + 1));
+  out.insert(out.end(), (const char*) req, (const char*) req + reqLen);
+  if (extraLen > 0)
+    out.insert(out.end(), (const char*) extra, (const char*) extra + extraLen);
+}
+
+const Status QueryClient::scan(const int id, const string & relName,
+                               const int offset, const int length,
+                               const Datatype type, const char* filter,
+                               const int filterLen, const Operator op)
+{
+  ScanRequest req;
+  if (relName.length() >= MAXNAMESIZE || filterLen < 0 ||
+      sizeof req + filterLen > (unsigned) MAXSCANREQUEST)
+    return BADREQUEST;
+  memset(&req, 0, sizeof req);
+  strcpy(req.relName, relName.c_str());
+  req.offset = offset;
+  req.length = length;
+  req.type = type;
+  req.op = op;
+  req.filterLen = filter == NULL ? 0 : filterLen;
+  request(REQSCAN, id, &req, sizeof req, filter, req.filterLen);
+  return OK;
+}
+
+const Status QueryClient::lookup(const int id, const string & relName,
+                                 const RID & rid)
+{
+  LookupRequest req;
+  if (relName.length() >= MAXNAMESIZE) return BADREQUEST;
+  memset(&req, 0, sizeof req);
+  strcpy(req.relName, relName.c_str());
+  req.rid = rid;
+  request(REQLOOKUP, id, &req, sizeof req, NULL, 0);
+  return OK;
+}
+
+const Status QueryClient::insert(const int id, const string & relName,
+                                 const Record & rec)
+{
+  InsertRequest req;
+  if (relName.length() >= MAXNAMESIZE || rec.length < 0 ||
+      sizeof req + rec.length > (unsigned) MAXREQUEST)
+    return BADREQUEST;
+  memset(&req, 0, sizeof req);
+  strcpy(req.relName, relName.c_str());
+  request(REQINSERT, id, &req, sizeof req, rec.data, rec.length);
+  return OK;
+}
+
+// send the buffered requests.  replies that arrive meanwhile are read
+// into the reply buffer, so a server blocked on writing them never
+// stops reading our requests
+const Status QueryClient::flush()
+{
+  size_t sent = 0;
+
+  if (fd < 0) return BADFILE;
+  while (sent < out.size())
+    {
+      struct pollfd pfd;
+      pfd.fd = fd;
+      pfd.events = POLLIN | POLLOUT;
+      if (poll(&pfd, 1, -1) < 0)
+	{
+	  if (errno == EINTR) continue;
+	  return UNIXERR;
+	}
+      if (pfd.revents & POLLIN)
+	{
+	  char buf[SERVERBUFSIZE];
+	  ssize_t n = ::read(fd, buf, sizeof buf);
+	  if (n < 0 && errno != EINTR) return UNIXERR;
+	  if (n == 0) return UNIXERR;
+	  if (n > 0) in.insert(in.end(), buf, buf + n);
+	}
+      if (pfd.revents & POLLOUT)
+	{
+	  ssize_t n = send(fd, &out[sent], out.size() - sent,
+	                   MSG_NOSIGNAL | MSG_DONTWAIT);
+	  if (n < 0 && errno != EINTR && errno != EAGAIN) return UNIXERR;
+	  if (n > 0) sent += n;
+	}
+      else if (pfd.revents & (POLLERR | POLLHUP))
+	return UNIXERR;
+    }
+  out.clear();
+  return OK;
+}
+
+const Status QueryClient::getReply(ReplyHdr & hdr, vector<char> & payload)
+{
+  Status status;
+
+  if ((status = flush()) != OK) return status;
+  while (true)
+    {
+      size_t avail = in.size() - inStart;
+      if (avail >= sizeof hdr)
+	{
+	  memcpy(&hdr, &in[inStart], sizeof hdr);
+	  if (avail >= sizeof hdr + hdr.length)
+	    {
+	      payload.assign(in.begin() + inStart + sizeof hdr,
+	                     in.begin() + inStart + sizeof hdr + hdr.length);
+	      inStart += sizeof hdr + hdr.length;
+	      return OK;
+	    }
+	}
+
+      if (inStart > 0)
+	{
+	  in.erase(in.begin(), in.begin() + inStart);
+	  inStart = 0;
+	}
+      char buf[SERVERBUFSIZE];
+      ssize_t n = ::read(fd, buf, sizeof buf);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return UNIXERR;
+      in.insert(in.end(), buf, buf + n);
+    }
+}
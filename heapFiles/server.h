@@ -0,0 +1,151 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <sys/uio.h>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "heapfile.h"
+
+// Query server.
+//
+// A QueryServer lets other processes on the machine use the DB and
+// buffer pool of the process that created it.  It listens on a Unix
+// domain socket and serves each connection with a thread of its own.
+// Requests are executed one at a time (a long scan gives way between
+// reply batches), so clients see the same semantics as callers of the
+// heap file classes inside the server process.  Scans are synchronized
+// scans, so concurrent scans of a relation share their page reads.
+//
+// The protocol is pipelined: a client may send any number of requests
+// before reading replies, and replies come back in request order,
+// tagged with the id of their request.  A scan is answered by a series
+// of replies of up to SERVERBATCH bytes of records each; all but the
+// last have more set.  The server reads requests in large chunks and
+// collects the replies to all requests it has read before writing them
+// out with one writev.
+//
+// Every message starts with a header giving the length of the payload
+// that follows.  Record payloads are a sequence of ReplyRec, each
+// followed by the record data padded to 4 bytes.
+
+const int SERVERBATCH = 64 * 1024;	// record bytes per scan reply
+const int SERVERBUFSIZE = 64 * 1024;	// socket read buffer
+const int MAXREQUEST = 2 * PAGESIZE;	// longest lookup or insert payload
+const int MAXIOV = 64;			// buffers gathered per write
+
+enum RequestType { REQSCAN = 1, REQLOOKUP, REQINSERT };
+
+struct RequestHdr
+{
+  int	length;			// payload length
+  int	type;			// a RequestType
+  int	id;			// echoed in the replies
+};
+
+// longest scan payload: a scan request may fill the read buffer, so
+// its IN list may hold some 16,000 INTEGERs
+const int MAXSCANREQUEST = SERVERBUFSIZE - sizeof(RequestHdr);
+
+// payload of REQSCAN; filterLen bytes of filter follow, none for a
+// scan without filter.  the filter of an IN scan is its list of values
+struct ScanRequest
+{
+  char	relName[MAXNAMESIZE];
+  int	offset;
+  int	length;
+  int	type;			// a Datatype
+  int	op;			// an Operator
+  int	filterLen;
+};
+
+// payload of REQLOOKUP
+struct LookupRequest
+{
+  char	relName[MAXNAMESIZE];
+  RID	rid;
+};
+
+// payload of REQINSERT; the record data follows
+struct InsertRequest
+{
+  char	relName[MAXNAMESIZE];
+};
+
+struct ReplyHdr
+{
+  int	length;			// payload length
+  int	id;			// id of request
+  int	status;			// a Status
+  int	recCnt;			// records in payload
+  int	more;			// more replies to this request follow
+};
+
+// one record in a reply payload; REQINSERT replies hold just the RID
+struct ReplyRec
+{
+  RID	rid;
+  int	length;
+};
+
+
+class QueryServer
+{
+public:
+  // start serving on socket path sockPath, replacing a stale socket
+  QueryServer(const string & sockPath, Status & status);
+
+  // stop accepting, close all connections and wait for their threads
+  ~QueryServer();
+
+private:
+  string		path;
+  int			listenFd;
+  thread		acceptor;
+  mutex			connMutex;	// guards the connection tables
+  map<int, thread>	conns;		// connection threads, by number
+  map<int, int>		connFds;	// sockets of open connections
+  vector<int>		finished;	// numbers of ended connections
+  int			nextConn;
+  bool			stopping;
+  mutex			execMutex;	// one request executes at a time
+
+  void acceptLoop();
+  void serve(const int connNo, const int fd);
+};
+
+
+// Client side of the protocol.  Requests are buffered until flush or
+// getReply is called, so many may travel in one write.
+
+class QueryClient
+{
+public:
+  QueryClient(const string & sockPath, Status & status);
+  ~QueryClient();
+
+  const Status scan(const int id, const string & relName,
+                    const int offset, const int length,
+                    const Datatype type, const char* filter,
+                    const int filterLen, const Operator op);
+  const Status lookup(const int id, const string & relName, const RID & rid);
+  const Status insert(const int id, const string & relName, const Record & rec);
+
+  // send all buffered requests
+  const Status flush();
+
+  // wait for the next reply; payload receives hdr.length bytes
+  const Status getReply(ReplyHdr & hdr, vector<char> & payload);
+
+private:
+  int		fd;
+  vector<char>	out;		// requests not yet sent
+  vector<char>	in;		// replies received but not yet returned
+  size_t	inStart;	// first byte of in not yet returned
+
+  void request(const int type, const int id,
+               const void* req, const int reqLen,
+               const void* extra, const int extraLen);
+};
+
+#endif
@@ -0,0 +1,361 @@
+#include <memory.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <iostream>
+#include <stdio.h>
+#include "page.h"
+#include "db.h"
+#include "buf.h"
+
+// tablespace implementation
+
+#define TSMAGIC     0x54535043
+
+// layout of physical page 0 of a tablespace
+struct TSHeader {
+  int magic;
+  int numPages;                         // physical pages in use
+  int firstDirPage;                     // first directory page, -1 if none
+  int freeList[TSMAXEXTENTS];           // first free extent of each size
+};
+
+// layout of a directory page; an entry with an empty name is unused
+struct TSDirEntry {
+  char name[TSNAMESIZE];
+  int  hdrPage;                         // physical page of DB header page
+};
+
+const int TSDIRENTRIES = (PAGESIZE - 2*sizeof(int)) / sizeof(TSDirEntry);
+
+struct TSDirPage {
+  int nextPage;                         // next directory page, -1 if last
+  int dummy;                            // for alignment purposes
+  TSDirEntry entry[TSDIRENTRIES];
+};
+
+#define DBP(p)      (*(DBPage*)&p)
+#define TSH(p)      (*(TSHeader*)&p)
+#define TSD(p)      (*(TSDirPage*)&p)
+#define TSR(p)      (*(TSRelHeader*)&p)
+
+// first logical page and size of extent k of a relation
+static inline int extentStart(const int k) { return TSEXTENTBASE * ((1 << k) - 1); }
+static inline int extentSize(const int k) { return TSEXTENTBASE << k; }
+
+
+// Create an empty tablespace file: just a header page.
+
+const Status Tablespace::create(const string & spaceName)
+{
+  int file;
+  if ((file = ::open(spaceName.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0666)) < 0)
+    {
+      if (errno == EEXIST)
+	return FILEEXISTS;
+      else
+	return UNIXERR;
+    }
+
+  Page header;
+  memset(&header, 0, sizeof header);
+  TSH(header).magic = TSMAGIC;
+  TSH(header).numPages = 1;
+  TSH(header).firstDirPage = -1;
+  for (int k = 0; k < TSMAXEXTENTS; k++)
+    TSH(header).freeList[k] = -1;
+  if (write(file, (char*)&header, sizeof header) != sizeof header)
+    return UNIXERR;
+
+  if (::close(file) < 0)
+    return UNIXERR;
+
+  return OK;
+}
+
+Tablespace::Tablespace(const string & name)
+{
+  spaceName = name;
+  unixFile = -1;
+  numPages = 0;
+  firstDirPage = -1;
+  numRelsOpen = 0;
+}
+
+Tablespace::~Tablespace()
+{
+  if (unixFile >= 0)
+    close();
+}
+
+
+// Open the tablespace file and read its header and directory into
+// memory, so that creating and opening relations needs no directory
+// search on disk.
+
+const Status Tablespace::open()
+{
+  Status status;
+  Page page;
+
+  if ((unixFile = ::open(spaceName.c_str(), O_RDWR)) < 0)
+    return UNIXERR;
+
+  if ((status = readPhys(0, &page)) != OK)
+    return status;
+  if (TSH(page).magic != TSMAGIC)
+    return BADFILE;
+
+  numPages = TSH(page).numPages;
+  firstDirPage = TSH(page).firstDirPage;
+  for (int k = 0; k < TSMAXEXTENTS; k++)
+    freeList[k] = TSH(page).freeList[k];
+
+  for (int dirPage = firstDirPage; dirPage != -1; dirPage = TSD(page).nextPage)
+    {
+      if ((status = readPhys(dirPage, &page)) != OK)
+	return status;
+      for (int i = 0; i < TSDIRENTRIES; i++)
+	{
+	  TSDirEntry& entry = TSD(page).entry[i];
+	  if (entry.name[0] == '\0')
+	    {
+	      freeSlots.push_back(make_pair(dirPage, i));
+	      continue;
+	    }
+	  DirLoc loc;
+	  loc.hdrPage = entry.hdrPage;
+	  loc.dirPage = dirPage;
+	  loc.dirSlot = i;
+	  dir[string(entry.name, strnlen(entry.name, TSNAMESIZE))] = loc;
+	}
+    }
+
+  return OK;
+}
+
+const Status Tablespace::close()
+{
+  if (unixFile < 0)
+    return FILENOTOPEN;
+  if (::close(unixFile) < 0)
+    return UNIXERR;
+  unixFile = -1;
+  return OK;
+}
+
+
+// Create relation relName: give it a first extent holding its DB
+// header page and enter it in the directory.
+
+const Status Tablespace::createRel(const string & relName)
+{
+  Status status;
+  int first;
+
+  if (relName.length() >= (unsigned) TSNAMESIZE)
+    return NAMETOOLONG;
+  if (dir.find(relName) != dir.end())
+    return FILEEXISTS;
+
+  if ((status = allocExtent(0, first)) != OK)
+    return status;
+
+  Page header;
+  memset(&header, 0, sizeof header);
+  TSR(header).db.nextFree = -1;
+  TSR(header).db.firstPage = -1;
+  TSR(header).db.numPages = 1;
+  TSR(header).numExtents = 1;
+  TSR(header).extent[0] = first;
+  if ((status = writePhys(first, &header)) != OK)
+    return status;
+
+  return addDirEntry(relName, first);
+}
+
+// enter relation relName in the directory, adding a directory page if
+// all entries are in use
+
+const Status Tablespace::addDirEntry(const string & relName, const int hdrPage)
+{
+  Status status;
+  Page page;
+
+  if (freeSlots.empty())
+    {
+      int newPage = numPages++;
+      memset(&page, 0, sizeof page);
+      TSD(page).nextPage = firstDirPage;
+      if ((status = writePhys(newPage, &page)) != OK)
+	return status;
+      firstDirPage = newPage;
+      if ((status = writeHeader()) != OK)
+	return status;
+      for (int i = TSDIRENTRIES - 1; i >= 0; i--)
+	freeSlots.push_back(make_pair(newPage, i));
+    }
+
+  DirLoc loc;
+  loc.hdrPage = hdrPage;
+  loc.dirPage = freeSlots.back().first;
+  loc.dirSlot = freeSlots.back().second;
+
+  if ((status = readPhys(loc.dirPage, &page)) != OK)
+    return status;
+  TSDirEntry& entry = TSD(page).entry[loc.dirSlot];
+  memset(entry.name, 0, TSNAMESIZE);
+  memcpy(entry.name, relName.c_str(), relName.length());
+  entry.hdrPage = hdrPage;
+  if ((status = writePhys(loc.dirPage, &page)) != OK)
+    return status;
+
+  freeSlots.pop_back();
+  dir[relName] = loc;
+  return OK;
+}
+
+
+// Destroy relation relName, returning its extents to the free lists.
+
+const Status Tablespace::destroyRel(const string & relName)
+{
+  Status status;
+  Page page;
+
+  map<string, DirLoc>::iterator it = dir.find(relName);
+  if (it == dir.end())
+    return UNIXERR;                     // as for a missing unix file
+  DirLoc loc = it->second;
+
+  if ((status = readPhys(loc.hdrPage, &page)) != OK)
+    return status;
+  int numExtents = TSR(page).numExtents;
+  int extent[TSMAXEXTENTS];
+  memcpy(extent, TSR(page).extent, sizeof extent);
+  for (int k = 0; k < numExtents; k++)
+    if ((status = freeExtent(k, extent[k])) != OK)
+      return status;
+
+  if ((status = readPhys(loc.dirPage, &page)) != OK)
+    return status;
+  memset(&TSD(page).entry[loc.dirSlot], 0, sizeof(TSDirEntry));
+  if ((status = writePhys(loc.dirPage, &page)) != OK)
+    return status;
+
+  freeSlots.push_back(make_pair(loc.dirPage, loc.dirSlot));
+  dir.erase(it);
+  return OK;
+}
+
+// return the physical page of the DB header page of relation relName
+
+const Status Tablespace::lookupRel(const string & relName, int& hdrPage) const
+{
+  map<string, DirLoc>::const_iterator it = dir.find(relName);
+  if (it == dir.end())
+    return UNIXERR;                     // as for a missing unix file
+  hdrPage = it->second.hdrPage;
+  return OK;
+}
+
+
+// Allocate an extent of TSEXTENTBASE << sizeClass pages, reusing a
+// free one of that size if there is one.
+
+const Status Tablespace::allocExtent(const int sizeClass, int& firstPage)
+{
+  Status status;
+
+  if (sizeClass >= TSMAXEXTENTS)
+    return FILETABFULL;
+
+  if (freeList[sizeClass] != -1)
+    {
+      Page page;
+      firstPage = freeList[sizeClass];
+      if ((status = readPhys(firstPage, &page)) != OK)
+	return status;
+      freeList[sizeClass] = DBP(page).nextFree;
+    }
+  else
+    {
+      firstPage = numPages;
+      numPages += extentSize(sizeClass);
+    }
+
+  return writeHeader();
+}
+
+// put an extent onto the free list of its size
+
+const Status Tablespace::freeExtent(const int sizeClass, const int firstPage)
+{
+  Status status;
+  Page page;
+
+  memset(&page, 0, sizeof page);
+  DBP(page).nextFree = freeList[sizeClass];
+  if ((status = writePhys(firstPage, &page)) != OK)
+    return status;
+  freeList[sizeClass] = firstPage;
+
+  return writeHeader();
+}
+
+const Status Tablespace::writeHeader()
+{
+  Page page;
+  memset(&page, 0, sizeof page);
+  TSH(page).magic = TSMAGIC;
+  TSH(page).numPages = numPages;
+  TSH(page).firstDirPage = firstDirPage;
+  for (int k = 0; k < TSMAXEXTENTS; k++)
+    TSH(page).freeList[k] = freeList[k];
+  return writePhys(0, &page);
+}
+
+const Status Tablespace::readPhys(const int pageNo, Page* pagePtr) const
+{
+  off_t offset = (off_t) pageNo * sizeof(Page);
+  if (pread(unixFile, (char*)pagePtr, sizeof(Page), offset) != sizeof(Page))
+    return UNIXERR;
+  return OK;
+}
+
+const Status Tablespace::writePhys(const int pageNo, const Page* pagePtr)
+{
+  off_t offset = (off_t) pageNo * sizeof(Page);
+  if (pwrite(unixFile, (char*)pagePtr, sizeof(Page), offset) != sizeof(Page))
+    return UNIXERR;
+  return OK;
+}
+
+
+// File methods for relations stored in a tablespace
+
+const int File::physPage(const int pageNo) const
+{
+  for (int k = 0; k < (int) extents.size(); k++)
+    if (pageNo < extentStart(k) + extentSize(k))
+      return extents[k] + pageNo - extentStart(k);
+  return -1;
+}
+
+const Status File::extendTo(const int pageNo)
+{
+  Status status;
+  int first;
+
+  while (physPage(pageNo) < 0)
+    {
+      if ((status = space->allocExtent(extents.size(), first)) != OK)
+	return status;
+      extents.push_back(first);
+    }
+
+  // the new extent table reaches disk with the next write of page 0,
+  // which the File layer always does after extending a file
+  return OK;
+}
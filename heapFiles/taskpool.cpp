@@ -0,0 +1,201 @@
+#include "taskpool.h"
+#include "error.h"
+
+// task pool implementation
+
+// tasks of one call of run not yet finished
+struct TaskPool::Batch
+{
+    mutex		mtx;
+    condition_variable	done;
+    int			pending;
+};
+
+TaskPool::TaskPool(const int threads)
+{
+    int n = threads < 1 ? 1 : threads;
+
+    queued = 0;
+    stopping = false;
+    steals = 0;
+    active = n;
+    for (int i = 0; i < n; i++)
+        workers.push_back(new Worker);
+    for (int i = 0; i < n; i++)
+        workers[i]->thr = thread(&TaskPool::work, this, i);
+}
+
+TaskPool::~TaskPool()
+{
+    {
+        lock_guard<mutex> lk(idleMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    // a worker that has not seen stopping yet may still look into the
+    // deques of the others
+    for (unsigned i = 0; i < workers.size(); i++)
+        workers[i]->thr.join();
+    for (unsigned i = 0; i < workers.size(); i++)
+        delete workers[i];
+}
+
+void TaskPool::setParallelism(const int n)
+{
+    {
+        lock_guard<mutex> lk(idleMutex);
+        active = n < 1 ? 1 : n > size() ? size() : n;
+    }
+    wake.notify_all();
+}
+
+void TaskPool::run(const vector<function<void(const int)> > & tasks)
+{
+    if (tasks.empty()) return;
+
+    Batch batch;
+    batch.pending = tasks.size();
+
+    // deal the tasks out in blocks, each pushed so that its first task
+    // is at the back, where its worker takes from
+    int n = tasks.size();
+    int dealt = active;
+    int block = (n + dealt - 1) / dealt;
+    for (int w = 0; w < dealt; w++)
+    {
+        lock_guard<mutex> lk(workers[w]->mtx);
+        int last = min(n, (w + 1) * block);
+        for (int i = last - 1; i >= w * block; i--)
+        {
+            Task task;
+            task.fn = &tasks[i];
+            task.batch = &batch;
+            workers[w]->tasks.push_back(task);
+        }
+    }
+    {
+        lock_guard<mutex> lk(idleMutex);
+        queued += n;
+    }
+    wake.notify_all();
+
+    unique_lock<mutex> lk(batch.mtx);
+    batch.done.wait(lk, [&batch]() { return batch.pending == 0; });
+}
+
+// take a task from the own deque or steal one
+const bool TaskPool::take(const int me, Task & task)
+{
+    int n = size();
+    for (int k = 0; k < n; k++)
+    {
+        Worker* w = workers[(me + k) % n];
+        lock_guard<mutex> lk(w->mtx);
+        if (w->tasks.empty()) continue;
+        if (k == 0)
+        {
+            task = w->tasks.back();
+            w->tasks.pop_back();
+        }
+        else
+        {
+            task = w->tasks.front();
+            w->tasks.pop_front();
+            steals++;
+        }
+        lock_guard<mutex> ilk(idleMutex);
+        queued--;
+        return true;
+    }
+    return false;
+}
+
+void TaskPool::work(const int me)
+{
+    Task task;
+
+    while (true)
+    {
+        if (me < active && take(me, task))
+        {
+            (*task.fn)(me);
+            lock_guard<mutex> lk(task.batch->mtx);
+            if (--task.batch->pending == 0) task.batch->done.notify_all();
+            continue;
+        }
+
+        unique_lock<mutex> lk(idleMutex);
+        wake.wait(lk, [this, me]() {
+                return stopping || (me < active && queued > 0); });
+        if (stopping) return;
+    }
+}
+
+
+// A heap file scan whose filter is applied by the morsel tasks.
+
+class MorselFile : public HeapFileScan
+{
+public:
+    MorselFile(const string & name, Status & status) : HeapFileScan(name, status) {}
+
+    File* file() const { return filePtr; }
+
+    // matchRec only reads the filter, so tasks may call it together
+    const bool matches(const Record & rec) const { return matchRec(rec); }
+};
+
+const Status morselScan(TaskPool & pool,
+                        const string & relName,
+                        const int offset,
+                        const int length,
+                        const Datatype type,
+                        const char* filter,
+                        const Operator op,
+                        const RecordVisitor & visit)
+{
+    Status status;
+    vector<int> pageNos;
+
+    MorselFile hf(relName, status);
+    if (status != OK) return status;
+    if ((status = hf.startScan(offset, length, type, filter, op)) != OK) return status;
+    if ((status = hf.getPageNos(pageNos)) != OK) return status;
+
+    mutex errMutex;
+    Status firstError = OK;
+    vector<function<void(const int)> > tasks;
+    for (unsigned first = 0; first < pageNos.size(); first += MORSELPAGES)
+    {
+        unsigned last = min((unsigned) pageNos.size(), first + MORSELPAGES);
+        tasks.push_back([&, first, last](const int worker) {
+            Status status = OK;
+            for (unsigned p = first; p < last && status == OK; p++)
+            {
+                Page* page;
+                RID rid, prevRid;
+                Record rec;
+
+                if ((status = bufMgr->readPage(hf.file(), pageNos[p], page)) != OK)
+                    break;
+                status = page->firstRecord(rid);
+                while (status == OK)
+                {
+                    page->getRecord(rid, rec);
+                    if (hf.matches(rec)) visit(worker, rid, rec);
+                    prevRid = rid;
+                    status = page->nextRecord(prevRid, rid);
+                }
+                status = bufMgr->unPinPage(hf.file(), pageNos[p], false);
+            }
+            if (status != OK)
+            {
+                lock_guard<mutex> lk(errMutex);
+                if (firstError == OK) firstError = status;
+            }
+        });
+    }
+    pool.run(tasks);
+    return firstError;
+}
@@ -0,0 +1,94 @@
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "heapfile.h"
+
+// Task pool and morsel-driven scans.
+//
+// A TaskPool is a fixed set of worker threads, each with a deque of
+// tasks.  A batch of tasks handed to run is dealt out in contiguous
+// blocks, one block per active worker.  A worker takes tasks from the
+// back of its own deque.  When that is empty it steals from the front
+// of another worker's deque, which holds the tasks furthest from what
+// that worker is doing.  A worker held up by an expensive task thus
+// has the rest of its block taken over, and no worker sits idle while
+// there is work queued.
+//
+// The parallelism (the number of workers that take tasks) may be
+// changed at any time, also while a batch is running.  Tasks queued at
+// a worker that is no longer active are stolen by the others.
+//
+// morselScan splits a relation into morsels of MORSELPAGES pages and
+// runs one task per morsel.  Filters, aggregates and the probe side of
+// joins are visitors that keep state per worker.
+
+const int MORSELPAGES = 16;		// pages in a morsel
+
+class TaskPool
+{
+public:
+    TaskPool(const int threads);
+    ~TaskPool();
+
+    const int size() const { return workers.size(); }
+
+    // make n (1 to size) workers take tasks
+    void setParallelism(const int n);
+    const int getParallelism() const { return active; }
+
+    // run fn(worker) for every fn of tasks and wait for all of them
+    void run(const vector<function<void(const int)> > & tasks);
+
+    // tasks taken from another worker's deque so far
+    const int getSteals() const { return steals; }
+
+private:
+    struct Batch;
+    struct Task
+    {
+        const function<void(const int)>*	fn;
+        Batch*					batch;
+    };
+    struct Worker
+    {
+        mutex		mtx;		// guards tasks
+        deque<Task>	tasks;
+        thread		thr;
+    };
+
+    vector<Worker*>	workers;
+    atomic<int>		active;		// workers that take tasks
+    atomic<int>		steals;
+    mutex		idleMutex;	// guards queued and stopping
+    condition_variable	wake;		// signalled when either changes
+    int			queued;		// tasks in the deques
+    bool		stopping;
+
+    const bool take(const int me, Task & task);
+    void work(const int me);
+};
+
+
+// called by morselScan for every matching record.  calls made at the
+// same time have different worker numbers
+typedef function<void(const int worker, const RID & rid, const Record & rec)>
+    RecordVisitor;
+
+// visit the records of relName that match the filter (as startScan
+// would select them) with the tasks of pool
+const Status morselScan(TaskPool & pool,
+                        const string & relName,
+                        const int offset,
+                        const int length,
+                        const Datatype type,
+                        const char* filter,
+                        const Operator op,
+                        const RecordVisitor & visit);
+
+#endif
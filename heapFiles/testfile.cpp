@@ -1,7 +1,27 @@
 #include <stdio.h>
 #include "heapfile.h"
+#include "packint.h"
+#include "catalog.h"
+#include "import.h"
+#include "export.h"
+#include "server.h"
+#include "changes.h"
+#include "aggview.h"
+#include "scancache.h"
+#include "topk.h"
+#include "jit.h"
+#include "taskpool.h"
+#include "memgov.h"
+#include <algorithm>
+#include <limits.h>
 #include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "stdlib.h"
+#include <thread>
+#include <vector>
 
 extern Status createHeapFile(string FileName);
 extern Status destroyHeapFile(string FileName);
@@ -9,6 +29,28 @@ extern Status destroyHeapFile(string FileName);
 // globals
 DB db;
 BufMgr* bufMgr;
+RelCatalog* relCat;
+
+// a heap file whose data pages can be inspected
+class PageSpace : public HeapFile
+{
+public:
+    PageSpace(const string & name, Status & status) : HeapFile(name, status) {}
+
+    // the free space of each data page, in file order
+    void freeSpace(vector<int> & out)
+    {
+        vector<int> pageNos;
+        Page* page;
+        getPageNos(pageNos);
+        for (unsigned i = 0; i < pageNos.size(); i++)
+            if (bufMgr->readPage(filePtr, pageNos[i], page) == OK)
+            {
+                out.push_back(page->getFreeSpace());
+                bufMgr->unPinPage(filePtr, pageNos[i], false);
+            }
+    }
+};
 
 int main(int argc, char **argv)
 {
@@ -37,6 +79,12 @@ int main(int argc, char **argv)
     RID		  rec2Rid;
 
     bufMgr = new BufMgr(101);
+    bufMgr->prefault(2);    // runs alongside the tests below
+    {
+        // no threads given means one
+        BufMgr small(10);
+        small.prefault(0);
+    }
 
     int i,j;
     int num = 10120;
@@ -623,6 +671,68 @@ int main(int argc, char **argv)
     delete scan1;
 	
 	
+    // repeat filtered scan #1 using a packed column on the i field
+    cout << endl << "Packed column scan matching i field GTE than " << filterVal1 << endl;
+    status = createPackedColumn("dummy.04", 0, "dummy.04.i");
+    if (status != OK) error.print(status);
+    PackedIntScan* pScan = new PackedIntScan("dummy.04", "dummy.04.i", status);
+    if (status != OK) error.print(status);
+    status = pScan->startScan(0, sizeof(int), INTEGER, (char *) &filterVal1, GTE);
+    if (status != OK) error.print(status);
+    else
+    {
+        if (!pScan->usingColumn())
+            cout << "Err0r.   packed column was not used by the scan" << endl;
+        i = 0;
+        while ((status = pScan->scanNext(rec2Rid)) != FILEEOF)
+        {
+            if (status != OK) { error.print(status); break; }
+            status = pScan->getRecord(dbrec2);
+            if (status != OK) break;
+            RECORD *currRec = (RECORD *) dbrec2.data;
+            if (! (currRec->i >= filterVal1))
+            {
+                cerr << "Err0r.   packed scan returned record that doesn't satisfy predicate "
+                     << "i val is " << currRec->i << endl;
+                exit(1);
+            }
+            i++;
+        }
+        cout << "packed scan saw " << i << " records " << endl;
+        if (i != num/4)
+            cout << "Err0r.   packed scan should have returned " << num/4 << " records!"
+                 << endl;
+
+        // the next scan after a change rebuilds the column, also when
+        // it is started through a HeapFileScan*
+        iScan = new InsertFileScan("dummy.04", status);
+        if (status != OK) error.print(status);
+        memset(&rec1, 0, sizeof rec1);
+        rec1.i = num;
+        dbrec1.data = &rec1;
+        dbrec1.length = sizeof rec1;
+        if ((status = iScan->insertRecord(dbrec1, newRid)) != OK) error.print(status);
+        delete iScan;
+        iScan = NULL;
+
+        HeapFileScan* hScan = pScan;
+        status = hScan->startScan(0, sizeof(int), INTEGER, (char *) &filterVal1, GTE);
+        if (status != OK) error.print(status);
+        if (!pScan->usingColumn())
+            cout << "Err0r.   packed column was not rebuilt" << endl;
+        for (i = 0; hScan->scanNext(rec2Rid) == OK; i++)
+        {
+            hScan->getRecord(dbrec2);
+            if (((RECORD *) dbrec2.data)->i == num && hScan->deleteRecord() != OK)
+                cout << "Err0r.   delete of the added record failed" << endl;
+        }
+        if (i != num/4 + 1)
+            cout << "Err0r.   packed scan after the insert returned " << i
+                 << " records, not " << num/4 + 1 << endl;
+    }
+    delete pScan;
+    if ((status = destroyPackedColumn("dummy.04.i")) != OK) error.print(status);
+
     // open up the heapFile
     file1 = new HeapFile("dummy.04", status);
     if (status != OK) 
@@ -671,6 +781,42 @@ int main(int argc, char **argv)
 
     delete scan1;
 
+    // records that fit no empty page, once the slot and the padding of
+    // aligned pages are counted, are refused without adding pages
+    for (int flags = 0; flags <= PAGE_ALIGNED; flags += PAGE_ALIGNED)
+    {
+        vector<int> before, after;
+
+        destroyHeapFile("dummy.21");
+        if ((status = createHeapFile("dummy.21", flags)) != OK) error.print(status);
+        iScan = new InsertFileScan("dummy.21", status);
+        if (status != OK) error.print(status);
+        if ((status = iScan->getPageNos(before)) != OK) error.print(status);
+        dbrec1.data = (void *) &bigdata;
+        for (int len = PAGESIZE - DPFIXED - sizeof(slot_t) + 1;
+             len <= (int) (PAGESIZE - DPFIXED); len++)
+        {
+            dbrec1.length = len;
+            if ((status = iScan->insertRecord(dbrec1, rec2Rid)) != INVALIDRECLEN)
+            {
+                cout << "Err0r.   insert of " << len << " bytes with flags "
+                     << flags << " returned" << endl;
+                error.print(status);
+            }
+        }
+        if ((status = iScan->getPageNos(after)) != OK) error.print(status);
+        if (after != before)
+            cout << "Err0r.   refused inserts added "
+                 << after.size() - before.size() << " pages" << endl;
+
+        // the largest record that fits still goes in
+        dbrec1.length = PAGESIZE - DPFIXED - sizeof(slot_t);
+        if ((status = iScan->insertRecord(dbrec1, rec2Rid)) != OK) error.print(status);
+        delete iScan;
+        if ((status = destroyHeapFile("dummy.21")) != OK) error.print(status);
+    }
+    cout << endl << "passed padded record length test" << endl;
+
     // MORE ERROR HANDLING TESTS HERE
   
     // get rid of the file
@@ -678,6 +824,1735 @@ int main(int argc, char **argv)
         cout << endl << "got err0r status return from destroy file" << endl;
         error.print(status);
     }
+    // many relations inside one tablespace file
+    cout << endl << "create 50 relations in tablespace dummy.ts" << endl;
+    db.destroyTablespace("dummy.ts");
+    status = db.createTablespace("dummy.ts");
+    if (status != OK) error.print(status);
+    for (j = 0; j < 50; j++)
+    {
+        char relName[32];
+        sprintf(relName, "dummy.ts:rel%02d", j);
+        if ((status = createHeapFile(relName)) != OK) { error.print(status); break; }
+        iScan = new InsertFileScan(relName, status);
+        if (status != OK) { error.print(status); break; }
+        // relation j gets j*20 records, so that some of them need
+        // several extents
+        for (i = 0; i < j * 20; i++) {
+            sprintf(rec1.s, "This is record %05d", i);
+            rec1.i = i;
+            rec1.f = j;
+            dbrec1.data = &rec1;
+            dbrec1.length = sizeof(RECORD);
+            status = iScan->insertRecord(dbrec1, newRid);
+            if (status != OK) { error.print(status); break; }
+        }
+        delete iScan;
+    }
+    int badRels = 0;
+    for (j = 0; j < 50; j++)
+    {
+        char relName[32];
+        sprintf(relName, "dummy.ts:rel%02d", j);
+        scan1 = new HeapFileScan(relName, status);
+        if (status != OK) { error.print(status); delete scan1; break; }
+        scan1->startScan(0, 0, STRING, NULL, EQ);
+        i = 0;
+        while ((status = scan1->scanNext(rec2Rid)) == OK)
+        {
+            scan1->getRecord(dbrec2);
+            RECORD *currRec = (RECORD *) dbrec2.data;
+            if (currRec->i != i || currRec->f != j) break;
+            i++;
+        }
+        if (status != FILEEOF || i != j * 20) badRels++;
+        delete scan1;
+        if ((status = destroyHeapFile(relName)) != OK) error.print(status);
+    }
+    cout << "scanned 50 relations in tablespace dummy.ts" << endl;
+    if (badRels != 0)
+        cout << "Err0r.   " << badRels << " relations in dummy.ts did not read back" << endl;
+    if ((status = db.destroyTablespace("dummy.ts")) != OK) error.print(status);
+
+    // temporary files are kept in memory, spilling to a scratch file
+    // once they outgrow the memory limit
+    cout << endl << "insert " << num << " records into temporary file tmp.01" << endl;
+    db.setTempMemLimit(num / 40);
+    status = createTempHeapFile("tmp.01");
+    if (status != OK) error.print(status);
+    if (createTempHeapFile("tmp.01") != TMP_RES_EXISTS)
+        cout << "Err0r.   second create of tmp.01 should return TMP_RES_EXISTS" << endl;
+    iScan = new InsertFileScan("tmp.01", status);
+    if (status != OK) error.print(status);
+    for(i = 0; i < num; i++) {
+        sprintf(rec1.s, "This is record %05d", i);
+        rec1.i = i;
+        rec1.f = i;
+        dbrec1.data = &rec1;
+        dbrec1.length = sizeof(RECORD);
+        status = iScan->insertRecord(dbrec1, newRid);
+        if (status != OK) { error.print(status); break; }
+    }
+    delete iScan;
+
+    scan1 = new HeapFileScan("tmp.01", status);
+    if (status != OK) error.print(status);
+    scan1->startScan(0, 0, STRING, NULL, EQ);
+    i = 0;
+    while ((status = scan1->scanNext(rec2Rid)) != FILEEOF)
+    {
+        sprintf(rec1.s, "This is record %05d", i);
+        rec1.i = i;
+        rec1.f = i;
+        status = scan1->getRecord(dbrec2);
+        if (status != OK) break;
+        if (memcmp(&rec1, dbrec2.data, sizeof(RECORD)) != 0)
+            cout << "err0r reading record " << i << " back" << endl;
+        i++;
+    }
+    delete scan1;
+    cout << "scan of tmp.01 saw " << i << " records" << endl;
+    if (i != num)
+        cout << "Err0r.   scan should have returned " << num << " records!" << endl;
+    if (access("tmp.01", F_OK) == 0)
+        cout << "Err0r.   temporary file tmp.01 appeared in the file system" << endl;
+    if ((status = destroyHeapFile("tmp.01")) != OK) error.print(status);
+
+    // relations created through the catalog; their descriptors are
+    // answered from memory and reopening them needs no I/O
+    cout << endl << "create relation dummy.05 through the catalog" << endl;
+    destroyHeapFile(RELCATNAME);
+    destroyHeapFile(ATTRCATNAME);
+    destroyHeapFile("dummy.05");
+    relCat = new RelCatalog(status);
+    if (status != OK) error.print(status);
+    {
+        AttrDesc attrs[3];
+        memset(attrs, 0, sizeof attrs);
+        strcpy(attrs[0].attrName, "i");
+        attrs[0].attrType = INTEGER;
+        attrs[0].attrLen = sizeof(int);
+        strcpy(attrs[1].attrName, "f");
+        attrs[1].attrType = FLOAT;
+        attrs[1].attrLen = sizeof(float);
+        strcpy(attrs[2].attrName, "s");
+        attrs[2].attrType = STRING;
+        attrs[2].attrLen = 64;
+        if ((status = relCat->createRel("dummy.05", 3, attrs)) != OK)
+            error.print(status);
+        if (relCat->createRel("dummy.05", 3, attrs) != RELEXISTS)
+            cout << "Err0r.   second create of dummy.05 should return RELEXISTS" << endl;
+        strcpy(attrs[1].attrName, "i");
+        if (relCat->createRel("dummy.06", 3, attrs) != DUPLATTR)
+            cout << "Err0r.   duplicate attribute should return DUPLATTR" << endl;
+    }
+
+    {
+        RelDesc rd;
+        AttrDesc ad;
+        status = relCat->getRelInfo("dummy.05", rd);
+        if (status != OK || rd.attrCnt != 3 || rd.recLen != (int) sizeof(RECORD))
+            cout << "Err0r.   wrong relcat entry for dummy.05" << endl;
+        status = relCat->getAttrInfo("dummy.05", "s", ad);
+        if (status != OK || ad.attrOffset != 8 || ad.attrLen != 64)
+            cout << "Err0r.   wrong attrcat entry for dummy.05.s" << endl;
+        if (relCat->getAttrInfo("dummy.05", "x", ad) != ATTRNOTFOUND)
+            cout << "Err0r.   lookup of dummy.05.x should return ATTRNOTFOUND" << endl;
+
+        iScan = new InsertFileScan("dummy.05", status);
+        if (status != OK) error.print(status);
+        for(i = 0; i < 1000; i++) {
+            sprintf(rec1.s, "This is record %05d", i);
+            rec1.i = i;
+            rec1.f = i;
+            dbrec1.data = &rec1;
+            dbrec1.length = rd.recLen;
+            status = iScan->insertRecord(dbrec1, newRid);
+            if (status != OK) { error.print(status); break; }
+        }
+        delete iScan;
+
+        // reopen: the catalog holds the file open and both pages that
+        // the open reads are in the buffer pool
+        int reads = bufMgr->getBufStats().diskreads;
+        file1 = new HeapFile("dummy.05", status);
+        if (status != OK) error.print(status);
+        if (file1->getRecCnt() != 1000)
+            cout << "Err0r.   dummy.05 should hold 1000 records" << endl;
+        delete file1;
+        if (bufMgr->getBufStats().diskreads != reads)
+            cout << "Err0r.   reopen of dummy.05 read from disk" << endl;
+    }
+
+    // the descriptors survive a restart of the catalog, and the pages
+    // of dummy.05 are read back in from the warm list saved when the
+    // catalog shut down
+    unlink("dummy.warm");
+    relCat->setWarmList("dummy.warm");
+    delete relCat;
+    relCat = new RelCatalog(status);
+    if (status != OK) error.print(status);
+    if ((status = relCat->warmUp("dummy.warm")) != OK) error.print(status);
+    bufMgr->waitPrefetch();
+    {
+        int reads = bufMgr->getBufStats().diskreads;
+        scan1 = new HeapFileScan("dummy.05", status);
+        if (status != OK) error.print(status);
+        scan1->startScan(0, 0, STRING, NULL, EQ);
+        i = 0;
+        while ((status = scan1->scanNext(rec2Rid)) == OK)
+            i++;
+        delete scan1;
+        cout << "scan of warmed dummy.05 saw " << i << " records with "
+             << bufMgr->getBufStats().diskreads - reads << " disk reads" << endl;
+        if (i != 1000)
+            cout << "Err0r.   scan should have returned 1000 records!" << endl;
+        if (bufMgr->getBufStats().diskreads != reads)
+            cout << "Err0r.   scan of warmed dummy.05 read from disk" << endl;
+    }
+
+    // threads asking for the same page at once share a single read
+    {
+        File* f05;
+        int hdrPageNo;
+        relCat->getHeaderPage("dummy.05", hdrPageNo);
+        if ((status = db.openFile("dummy.05", f05)) != OK) error.print(status);
+        if ((status = bufMgr->flushFile(f05)) != OK) error.print(status);
+        int reads = bufMgr->getBufStats().diskreads;
+        vector<thread> readers;
+        for (j = 0; j < 8; j++)
+            readers.push_back(thread([f05, hdrPageNo]() {
+                Page* p;
+                if (bufMgr->readPage(f05, hdrPageNo, p) == OK)
+                    bufMgr->unPinPage(f05, hdrPageNo, false);
+            }));
+        for (j = 0; j < 8; j++)
+            readers[j].join();
+        if (bufMgr->getBufStats().diskreads - reads != 1)
+            cout << "Err0r.   8 concurrent requests for a page read it "
+                 << bufMgr->getBufStats().diskreads - reads << " times" << endl;
+        db.closeFile(f05);
+    }
+    // bulk import a CSV and a binary file with 4 loader threads
+    cout << endl << "import 5000 CSV and 1000 binary records into dummy.07" << endl;
+    {
+        AttrDesc attrs[3];
+        memset(attrs, 0, sizeof attrs);
+        strcpy(attrs[0].attrName, "i");
+        attrs[0].attrType = INTEGER;
+        attrs[0].attrLen = sizeof(int);
+        strcpy(attrs[1].attrName, "f");
+        attrs[1].attrType = FLOAT;
+        attrs[1].attrLen = sizeof(float);
+        strcpy(attrs[2].attrName, "s");
+        attrs[2].attrType = STRING;
+        attrs[2].attrLen = 64;
+        if ((status = relCat->createRel("dummy.07", 3, attrs)) != OK)
+            error.print(status);
+
+        FILE* csv = fopen("dummy.csv", "w");
+        for (i = 0; i < 5000; i++)
+        {
+            if (i == 1234)
+                fprintf(csv, "%d,%d.5,\"a, \"\"quoted\"\" one\"\r\n", i, i);
+            else
+                fprintf(csv, "%d,%d.5,record %05d\n", i, i, i);
+        }
+        fclose(csv);
+        int loaded;
+        if ((status = importRel("dummy.07", "dummy.csv", CSVFORMAT, 4, loaded)) != OK)
+            error.print(status);
+        if (loaded != 5000)
+            cout << "Err0r.   CSV import loaded " << loaded << " records" << endl;
+
+        FILE* bin = fopen("dummy.bin", "w");
+        for (i = 0; i < 1000; i++)
+        {
+            memset(&rec1, 0, sizeof rec1);
+            rec1.i = 5000 + i;
+            rec1.f = rec1.i + 0.5;
+            sprintf(rec1.s, "record %05d", rec1.i);
+            fwrite(&rec1, sizeof rec1, 1, bin);
+        }
+        fclose(bin);
+        if ((status = importRel("dummy.07", "dummy.bin", BINARYFORMAT, 4, loaded)) != OK)
+            error.print(status);
+        if (loaded != 1000)
+            cout << "Err0r.   binary import loaded " << loaded << " records" << endl;
+
+        csv = fopen("dummy.csv", "w");
+        fprintf(csv, "1,1.5,fine\n2,two,bad\n");
+        fclose(csv);
+        if (importRel("dummy.07", "dummy.csv", CSVFORMAT, 1, loaded) != BADIMPORTREC
+            || loaded != 1)
+            cout << "Err0r.   import of a bad CSV line should return BADIMPORTREC" << endl;
+        unlink("dummy.csv");
+        unlink("dummy.bin");
+
+        vector<char> seen(6000, 0);
+        scan1 = new HeapFileScan("dummy.07", status);
+        if (status != OK) error.print(status);
+        scan1->startScan(0, 0, STRING, NULL, EQ);
+        j = 0;
+        while ((status = scan1->scanNext(rec2Rid)) == OK)
+        {
+            scan1->getRecord(dbrec2);
+            memcpy(&rec2, dbrec2.data, sizeof rec2);
+            j++;
+            if (rec2.i == 1 && strcmp(rec2.s, "fine") == 0) continue;
+            if (rec2.i < 0 || rec2.i >= 6000 || rec2.f != rec2.i + 0.5)
+                continue;
+            sprintf(rec1.s, "record %05d", rec2.i);
+            if (rec2.i == 1234 ? strcmp(rec2.s, "a, \"quoted\" one") == 0
+                               : strcmp(rec2.s, rec1.s) == 0)
+                seen[rec2.i]++;
+        }
+        delete scan1;
+        for (i = 0; i < 6000 && seen[i] == 1; i++) ;
+        if (j != 6001 || i != 6000)
+            cout << "Err0r.   dummy.07 holds " << j << " records, record "
+                 << i << " wrong or not seen once" << endl;
+
+        // export it as an Arrow stream, to a file and to shared memory
+        int exported;
+        size_t shmSize;
+        if ((status = exportRel("dummy.07", "dummy.arrow", 4, exported)) != OK)
+            error.print(status);
+        if (exported != 6001)
+            cout << "Err0r.   export of dummy.07 wrote " << exported << " records" << endl;
+        if ((status = exportRelShm("dummy.07", "/dummy.arrow", 4, shmSize)) != OK)
+            error.print(status);
+        {
+            // both must hold the same stream: schema message first, end
+            // of stream marker last
+            struct stat st;
+            int fd = open("dummy.arrow", O_RDONLY);
+            int shmFd = shm_open("/dummy.arrow", O_RDONLY, 0);
+            if (fd < 0 || shmFd < 0 || fstat(fd, &st) < 0 || (size_t) st.st_size != shmSize)
+                cout << "Err0r.   Arrow file and shared memory differ in size" << endl;
+            else
+            {
+                char* f = (char*) mmap(NULL, shmSize, PROT_READ, MAP_SHARED, fd, 0);
+                char* m = (char*) mmap(NULL, shmSize, PROT_READ, MAP_SHARED, shmFd, 0);
+                int eos[2] = { -1, 0 };
+                if (*(int*) f != -1 || memcmp(f + shmSize - 8, eos, 8) != 0)
+                    cout << "Err0r.   dummy.arrow is not an Arrow stream" << endl;
+                if (memcmp(f, m, shmSize) != 0)
+                    cout << "Err0r.   Arrow file and shared memory differ" << endl;
+                munmap(f, shmSize);
+                munmap(m, shmSize);
+            }
+            if (fd >= 0) close(fd);
+            if (shmFd >= 0) close(shmFd);
+            shm_unlink("/dummy.arrow");
+            unlink("dummy.arrow");
+        }
+        if ((status = relCat->destroyRel("dummy.07")) != OK) error.print(status);
+    }
+
+    // a view created midway must agree with the relation after more
+    // inserts and deletes, among them the minimum of every group
+    cout << endl << "maintain COUNT/SUM/MIN/MAX of dummy.11 grouped by g" << endl;
+    {
+        AttrDesc attrs[2];
+        int rec2[2];
+        memset(attrs, 0, sizeof attrs);
+        strcpy(attrs[0].attrName, "g");
+        strcpy(attrs[1].attrName, "v");
+        attrs[0].attrType = attrs[1].attrType = INTEGER;
+        attrs[0].attrLen = attrs[1].attrLen = sizeof(int);
+        if ((status = relCat->createRel("dummy.11", 2, attrs)) != OK)
+            error.print(status);
+
+        dbrec1.data = rec2;
+        dbrec1.length = sizeof rec2;
+        iScan = new InsertFileScan("dummy.11", status);
+        if (status != OK) error.print(status);
+        for (i = 0; i < 2000; i++)
+        {
+            // the view sees what is there when it is created and what
+            // the insert scan, open all along, adds after that
+            if (i == 1000 &&
+                (status = createAggView("dummy.11v", "dummy.11", "g", "v")) != OK)
+                error.print(status);
+            rec2[0] = i < 1500 ? i % 10 : 10 + i % 3;
+            rec2[1] = i;
+            if ((status = iScan->insertRecord(dbrec1, newRid)) != OK)
+                error.print(status);
+        }
+        delete iScan;
+        iScan = NULL;
+        {
+            int lim = 100;
+            scan1 = new HeapFileScan("dummy.11", status);
+            if (status == OK)
+                status = scan1->startScan(sizeof(int), sizeof(int), INTEGER,
+                                          (char*) &lim, LT);
+            while (status == OK && (status = scan1->scanNext(rec2Rid)) == OK)
+                status = scan1->deleteRecord();
+            if (status != FILEEOF) error.print(status);
+            delete scan1;
+            scan1 = NULL;
+        }
+        if ((status = refreshAggView("dummy.11v")) != OK) error.print(status);
+
+        // brute force
+        map<int, vector<int> > want;
+        scan1 = new HeapFileScan("dummy.11", status);
+        if (status == OK) status = scan1->startScan(0, 0, STRING, NULL, EQ);
+        while (status == OK && (status = scan1->scanNext(rec2Rid)) == OK)
+        {
+            scan1->getRecord(dbrec2);
+            int g = ((int*) dbrec2.data)[0];
+            int v = ((int*) dbrec2.data)[1];
+            if (want.find(g) == want.end())
+                want[g] = vector<int>({ 0, 0, v, v });
+            vector<int> & a = want[g];
+            a[0]++;
+            a[1] += v;
+            a[2] = min(a[2], v);
+            a[3] = max(a[3], v);
+        }
+        delete scan1;
+        scan1 = NULL;
+
+        int groups = 0;
+        scan1 = new HeapFileScan("dummy.11v", status);
+        if (status == OK) status = scan1->startScan(0, 0, STRING, NULL, EQ);
+        while (status == OK && (status = scan1->scanNext(rec2Rid)) == OK)
+        {
+            scan1->getRecord(dbrec2);
+            int* row = (int*) dbrec2.data;
+            groups++;
+            if (dbrec2.length != 5 * sizeof(int) || want.find(row[0]) == want.end() ||
+                vector<int>(row + 1, row + 5) != want[row[0]])
+                cout << "Err0r.   view row of group " << row[0] << " is wrong" << endl;
+        }
+        delete scan1;
+        scan1 = NULL;
+        if (groups != (int) want.size() || groups != 13)
+            cout << "Err0r.   view holds " << groups << " groups, not "
+                 << want.size() << endl;
+
+        if ((status = destroyAggView("dummy.11v")) != OK) error.print(status);
+        if (refreshAggView("dummy.11v") != RELNOTFOUND)
+            cout << "Err0r.   dummy.11v still there after destroyAggView" << endl;
+        if ((status = relCat->destroyRel("dummy.11")) != OK) error.print(status);
+    }
+
+    // STRING keys group up to the first NUL, and a sum too large for
+    // INTEGER fails the refresh instead of wrapping around
+    cout << endl << "group dummy.11 by STRING keys with bytes after the NUL" << endl;
+    {
+        AttrDesc attrs[2];
+        struct { char s[8]; int v; } row;
+        memset(attrs, 0, sizeof attrs);
+        strcpy(attrs[0].attrName, "s");
+        strcpy(attrs[1].attrName, "v");
+        attrs[0].attrType = STRING;
+        attrs[0].attrLen = sizeof row.s;
+        attrs[1].attrType = INTEGER;
+        attrs[1].attrLen = sizeof(int);
+        if ((status = relCat->createRel("dummy.11", 2, attrs)) != OK)
+            error.print(status);
+        if ((status = createAggView("dummy.11v", "dummy.11", "s", "v")) != OK)
+            error.print(status);
+
+        dbrec1.data = &row;
+        dbrec1.length = sizeof row;
+        iScan = new InsertFileScan("dummy.11", status);
+        if (status != OK) error.print(status);
+        for (i = 0; i < 6; i++)
+        {
+            memset(&row, 0, sizeof row);
+            strcpy(row.s, "ab");
+            row.s[3 + i % 3] = 'x';		// garbage after the NUL
+            row.v = i < 3 ? i : INT_MAX;
+            if (i >= 3) strcpy(row.s, "big");
+            if ((status = iScan->insertRecord(dbrec1, newRid)) != OK)
+                error.print(status);
+        }
+        delete iScan;
+        iScan = NULL;
+        if ((status = refreshAggView("dummy.11v")) != VALOVERFLOW)
+        {
+            cout << "Err0r.   refresh of an overflowing sum returned" << endl;
+            error.print(status);
+        }
+
+        // take out the minimum of "ab", which is the only stale group
+        // then, and after that two of the big values
+        for (int pass = 0; pass < 2; pass++)
+        {
+            scan1 = new HeapFileScan("dummy.11", status);
+            if (status == OK) status = scan1->startScan(0, 0, STRING, NULL, EQ);
+            j = 0;
+            while (status == OK && (status = scan1->scanNext(rec2Rid)) == OK)
+            {
+                scan1->getRecord(dbrec2);
+                memcpy(&row, dbrec2.data, sizeof row);
+                if (pass == 0 ? row.v == 0 : row.v == INT_MAX && j++ < 2)
+                    status = scan1->deleteRecord();
+            }
+            if (status != FILEEOF) error.print(status);
+            delete scan1;
+            scan1 = NULL;
+            if ((status = refreshAggView("dummy.11v")) != (pass == 0 ? VALOVERFLOW : OK))
+                error.print(status);
+        }
+
+        int groups = 0;
+        scan1 = new HeapFileScan("dummy.11v", status);
+        if (status == OK) status = scan1->startScan(0, 0, STRING, NULL, EQ);
+        while (status == OK && (status = scan1->scanNext(rec2Rid)) == OK)
+        {
+            int agg[4];
+            scan1->getRecord(dbrec2);
+            memcpy(agg, (char*) dbrec2.data + sizeof row.s, sizeof agg);
+            groups++;
+            bool ab = strcmp((char*) dbrec2.data, "ab") == 0;
+            if (ab ? (agg[0] != 2 || agg[1] != 3 || agg[2] != 1 || agg[3] != 2)
+                   : (agg[0] != 1 || agg[1] != INT_MAX || agg[2] != INT_MAX))
+                cout << "Err0r.   view row of group " << (char*) dbrec2.data
+                     << " is wrong" << endl;
+        }
+        delete scan1;
+        scan1 = NULL;
+        if (groups != 2)
+            cout << "Err0r.   view holds " << groups << " groups, not 2" << endl;
+
+        if ((status = destroyAggView("dummy.11v")) != OK) error.print(status);
+        if ((status = relCat->destroyRel("dummy.11")) != OK) error.print(status);
+    }
+
+    unlink("dummy.warm");
+    {
+        RelDesc rd;
+        AttrDesc ad;
+        if (relCat->getAttrInfo("dummy.05", "f", ad) != OK || ad.attrType != FLOAT)
+            cout << "Err0r.   dummy.05.f lost from catalog" << endl;
+        if ((status = relCat->destroyRel("dummy.05")) != OK) error.print(status);
+        if (relCat->getRelInfo("dummy.05", rd) != RELNOTFOUND)
+            cout << "Err0r.   dummy.05 still in catalog after destroyRel" << endl;
+    }
+    delete relCat;
+    relCat = NULL;
+    destroyHeapFile(RELCATNAME);
+    destroyHeapFile(ATTRCATNAME);
+
+    // loader threads each insert through their own insert scan; no
+    // record may be lost and the header must count all of them
+    cout << endl << "insert 12000 records into dummy.06 from 4 threads" << endl;
+    destroyHeapFile("dummy.06");
+    if ((status = createHeapFile("dummy.06")) != OK) error.print(status);
+    {
+        vector<InsertFileScan*> loaders;
+        vector<thread> threads;
+        for (j = 0; j < 4; j++)
+        {
+            loaders.push_back(new InsertFileScan("dummy.06", status));
+            if (status != OK) error.print(status);
+        }
+        for (j = 0; j < 4; j++)
+            threads.push_back(thread([j, &loaders]() {
+                RECORD r;
+                Record dbr;
+                RID rid;
+                memset(&r, 0, sizeof r);
+                dbr.data = &r;
+                dbr.length = sizeof r;
+                for (int k = 0; k < 3000; k++)
+                {
+                    r.i = j * 3000 + k;
+                    sprintf(r.s, "loader %d record %05d", j, k);
+                    if (loaders[j]->insertRecord(dbr, rid) != OK)
+                    {
+                        cout << "Err0r.   insert of loader " << j << " failed" << endl;
+                        break;
+                    }
+                }
+            }));
+        for (j = 0; j < 4; j++)
+        {
+            threads[j].join();
+            delete loaders[j];
+        }
+
+        vector<char> seen(12000, 0);
+        scan1 = new HeapFileScan("dummy.06", status);
+        if (status != OK) error.print(status);
+        if (scan1->getRecCnt() != 12000)
+            cout << "Err0r.   dummy.06 header counts " << scan1->getRecCnt()
+                 << " records" << endl;
+        scan1->startScan(0, 0, STRING, NULL, EQ);
+        i = 0;
+        while ((status = scan1->scanNext(rec2Rid)) == OK)
+        {
+            scan1->getRecord(dbrec2);
+            memcpy(&rec2, dbrec2.data, sizeof rec2);
+            if (rec2.i >= 0 && rec2.i < 12000) seen[rec2.i]++;
+            i++;
+        }
+        delete scan1;
+        for (j = 0; j < 12000 && seen[j] == 1; j++) ;
+        if (i != 12000 || j != 12000)
+            cout << "Err0r.   scan of dummy.06 returned " << i
+                 << " records, record " << j << " not seen once" << endl;
+    }
+    if ((status = destroyHeapFile("dummy.06")) != OK) error.print(status);
+
+    // an insert scan that closes on the full last page of the file must
+    // not make the scans still open fail with NOSPACE
+    cout << endl << "insert into dummy.06 after a scan closed on a full page" << endl;
+    if ((status = createHeapFile("dummy.06")) != OK) error.print(status);
+    {
+        InsertFileScan* first = new InsertFileScan("dummy.06", status);
+        if (status != OK) error.print(status);
+        iScan = new InsertFileScan("dummy.06", status);
+        if (status != OK) error.print(status);
+        memset(&rec1, 0, sizeof rec1);
+        dbrec1.data = &rec1;
+        dbrec1.length = sizeof rec1;
+
+        // the second scan's chunk is linked last and filled completely
+        if ((status = first->insertRecord(dbrec1, newRid)) != OK) error.print(status);
+        for (i = 0; i < 8 * 13; i++)
+            if ((status = iScan->insertRecord(dbrec1, newRid)) != OK) error.print(status);
+        delete iScan;
+        iScan = NULL;
+        for (i = 0; i < 500; i++)
+            if ((status = first->insertRecord(dbrec1, newRid)) != OK)
+            {
+                cout << "Err0r.   insert " << i << " failed" << endl;
+                error.print(status);
+                break;
+            }
+        delete first;
+
+        scan1 = new HeapFileScan("dummy.06", status);
+        if (status != OK) error.print(status);
+        if (scan1->getRecCnt() != 1 + 8 * 13 + 500)
+            cout << "Err0r.   dummy.06 header counts " << scan1->getRecCnt()
+                 << " records" << endl;
+        delete scan1;
+        scan1 = NULL;
+    }
+    if ((status = destroyHeapFile("dummy.06")) != OK) error.print(status);
+
+    // two clients pipeline inserts, lookups and scans through a query
+    // server on a Unix domain socket
+    cout << endl << "serve 2 clients inserting 1000 records each into dummy.08" << endl;
+    destroyHeapFile("dummy.08");
+    if ((status = createHeapFile("dummy.08")) != OK) error.print(status);
+    {
+        QueryServer* server = new QueryServer("dummy.sock", status);
+        if (status != OK) error.print(status);
+        vector<thread> clients;
+        for (j = 0; j < 2; j++)
+            clients.push_back(thread([j]() {
+                Status st;
+                QueryClient client("dummy.sock", st);
+                if (st != OK) { cout << "Err0r.   connect failed" << endl; return; }
+                RECORD r;
+                Record dbr;
+                ReplyHdr hdr;
+                vector<char> payload;
+                vector<RID> rids(1000);
+                memset(&r, 0, sizeof r);
+                dbr.data = &r;
+                dbr.length = sizeof r;
+                for (int k = 0; k < 1000; k++)
+                {
+                    r.i = j * 1000 + k;
+                    sprintf(r.s, "client %d record %05d", j, k);
+                    client.insert(k, "dummy.08", dbr);
+                }
+                for (int k = 0; k < 1000; k++)
+                {
+                    if (client.getReply(hdr, payload) != OK || hdr.id != k ||
+                        hdr.status != OK || hdr.length != sizeof(RID))
+                    {
+                        cout << "Err0r.   bad reply to insert " << k << endl;
+                        return;
+                    }
+                    memcpy(&rids[k], &payload[0], sizeof(RID));
+                }
+                for (int k = 0; k < 1000; k++)
+                    client.lookup(k, "dummy.08", rids[k]);
+                client.lookup(1000, "dummy.nosuch", rids[0]);
+                for (int k = 0; k < 1000; k++)
+                {
+                    RECORD got;
+                    if (client.getReply(hdr, payload) != OK || hdr.id != k ||
+                        hdr.status != OK || hdr.recCnt != 1)
+                    {
+                        cout << "Err0r.   bad reply to lookup " << k << endl;
+                        return;
+                    }
+                    memcpy(&got, &payload[sizeof(ReplyRec)], sizeof got);
+                    if (got.i != j * 1000 + k)
+                        cout << "Err0r.   lookup " << k << " returned " << got.i << endl;
+                }
+                if (client.getReply(hdr, payload) != OK || hdr.id != 1000 ||
+                    hdr.status == OK)
+                    cout << "Err0r.   lookup in a missing relation should fail" << endl;
+            }));
+        for (j = 0; j < 2; j++)
+            clients[j].join();
+
+        // scan with filter i >= 500; the reply comes in several batches
+        QueryClient client("dummy.sock", status);
+        if (status != OK) error.print(status);
+        int filterVal = 500;
+        ReplyHdr hdr;
+        vector<char> payload;
+        client.scan(7, "dummy.08", 0, sizeof(int), INTEGER,
+                    (char*) &filterVal, sizeof filterVal, GTE);
+        int batches = 0, recs = 0;
+        long sum = 0;
+        do
+        {
+            if (client.getReply(hdr, payload) != OK || hdr.id != 7 || hdr.status != OK)
+            {
+                cout << "Err0r.   bad scan reply" << endl;
+                break;
+            }
+            batches++;
+            recs += hdr.recCnt;
+            for (unsigned off = 0; off < payload.size(); )
+            {
+                ReplyRec rr;
+                memcpy(&rr, &payload[off], sizeof rr);
+                memcpy(&rec2, &payload[off + sizeof rr], sizeof rec2);
+                sum += rec2.i;
+                off += (sizeof rr + rr.length + 3) & ~3;
+            }
+        } while (hdr.more);
+        cout << "scan returned " << recs << " records in " << batches << " batches" << endl;
+        if (recs != 1500 || sum != 1500L * (500 + 1999) / 2 || batches < 2)
+            cout << "Err0r.   scan of dummy.08 through the server returned "
+                 << recs << " records" << endl;
+
+        // an IN list of 10,000 values fits in one scan request
+        vector<int> values(10000);
+        for (i = 0; i < 10000; i++) values[i] = 2 * i;
+        if ((status = client.scan(8, "dummy.08", 0, sizeof(int), INTEGER,
+                                  (char*) &values[0], values.size() * sizeof(int),
+                                  IN)) != OK)
+            error.print(status);
+        recs = 0;
+        do
+        {
+            if (client.getReply(hdr, payload) != OK || hdr.id != 8 || hdr.status != OK)
+            {
+                cout << "Err0r.   bad reply to a scan with an IN list" << endl;
+                break;
+            }
+            recs += hdr.recCnt;
+        } while (hdr.more);
+        if (recs != 1000)
+            cout << "Err0r.   IN list of 10000 values matched " << recs
+                 << " records through the server" << endl;
+        delete server;
+    }
+    if ((status = destroyHeapFile("dummy.08")) != OK) error.print(status);
+
+    // a synchronized scan started while another is halfway through
+    // joins it there and wraps around, sharing the reads of the rest
+    cout << endl << "synchronized scans of dummy.09" << endl;
+    destroyHeapFile("dummy.09");
+    if ((status = createHeapFile("dummy.09")) != OK) error.print(status);
+    {
+        File* f09;
+        iScan = new InsertFileScan("dummy.09", status);
+        if (status != OK) error.print(status);
+        for (i = 0; i < 3000; i++)
+        {
+            memset(&rec1, 0, sizeof rec1);
+            rec1.i = i;
+            sprintf(rec1.s, "sync record %05d", i);
+            dbrec1.data = &rec1;
+            dbrec1.length = sizeof rec1;
+            if ((status = iScan->insertRecord(dbrec1, newRid)) != OK)
+            {
+                error.print(status);
+                break;
+            }
+        }
+        delete iScan;
+        if ((status = db.openFile("dummy.09", f09)) != OK) error.print(status);
+
+        // one scan on its own
+        bufMgr->flushFile(f09);
+        int reads = bufMgr->getBufStats().diskreads;
+        scan1 = new HeapFileScan("dummy.09", status);
+        scan1->startScan(0, 0, STRING, NULL, EQ);
+        while (scan1->scanNext(rec2Rid) == OK) ;
+        delete scan1;
+        int soloReads = bufMgr->getBufStats().diskreads - reads;
+
+        // the second scan starts when the first has returned 1500
+        bufMgr->flushFile(f09);
+        reads = bufMgr->getBufStats().diskreads;
+        scan1 = new HeapFileScan("dummy.09", status);
+        scan2 = new HeapFileScan("dummy.09", status);
+        scan1->syncScan(true);
+        scan2->syncScan(true);
+        scan1->startScan(0, 0, STRING, NULL, EQ);
+        for (i = 0; i < 1500 && scan1->scanNext(rec2Rid) == OK; i++) ;
+        scan2->startScan(0, 0, STRING, NULL, EQ);
+        vector<char> seen(3000, 0);
+        int first = -1, n1 = i, n2 = 0;
+        bool more1 = true, more2 = true;
+        while (more1 || more2)
+        {
+            if (more1 && (more1 = scan1->scanNext(rec2Rid) == OK)) n1++;
+            if (more2 && (more2 = scan2->scanNext(rec2Rid) == OK))
+            {
+                scan2->getRecord(dbrec2);
+                memcpy(&rec2, dbrec2.data, sizeof rec2);
+                if (first == -1) first = rec2.i;
+                if (rec2.i >= 0 && rec2.i < 3000) seen[rec2.i]++;
+                n2++;
+            }
+        }
+        delete scan1;
+        delete scan2;
+        int pairReads = bufMgr->getBufStats().diskreads - reads;
+        cout << "one scan read " << soloReads << " pages, two synchronized scans "
+             << pairReads << ", the second starting at record " << first << endl;
+        for (j = 0; j < 3000 && seen[j] == 1; j++) ;
+        if (n1 != 3000 || n2 != 3000 || j != 3000)
+            cout << "Err0r.   synchronized scans returned " << n1 << " and " << n2
+                 << " records" << endl;
+        if (first <= 0 || pairReads > soloReads * 16 / 10)
+            cout << "Err0r.   second scan did not join the first" << endl;
+        db.closeFile(f09);
+    }
+    if ((status = destroyHeapFile("dummy.09")) != OK) error.print(status);
+
+    // inserts and deletes of a file with a change log are logged in
+    // order, also by a scan opened before the log; a reader resumes
+    // from a saved position
+    cout << endl << "change log of dummy.10" << endl;
+    destroyHeapFile("dummy.10");
+    if ((status = createHeapFile("dummy.10")) != OK) error.print(status);
+    {
+        iScan = new InsertFileScan("dummy.10", status);
+        if (status != OK) error.print(status);
+        if ((status = createChangeLog("dummy.10")) != OK) error.print(status);
+        for (i = 0; i < 100; i++)
+        {
+            memset(&rec1, 0, sizeof rec1);
+            rec1.i = i;
+            sprintf(rec1.s, "change %05d", i);
+            dbrec1.data = &rec1;
+            dbrec1.length = sizeof rec1;
+            if ((status = iScan->insertRecord(dbrec1, newRid)) != OK) error.print(status);
+        }
+        delete iScan;
+
+        int filterVal = 0;
+        scan1 = new HeapFileScan("dummy.10", status);
+        if (status != OK) error.print(status);
+        deleted = 0;
+        scan1->startScan(0, sizeof(int), INTEGER, (char*) &filterVal, EQ);
+        while (scan1->scanNext(rec2Rid) == OK)
+            if (scan1->deleteRecord() == OK) deleted++;
+        delete scan1;
+
+        ChangeReader reader("dummy.10", LOGSTART, status);
+        if (status != OK) error.print(status);
+        ChangeEntry ce;
+        Record cr;
+        ChangePos half = LOGSTART;
+        int inserts = 0, deletes = 0, bad = 0;
+        long long seq = 0;
+        while (reader.next(ce, cr) == OK)
+        {
+            RECORD* r = (RECORD*) cr.data;
+            if (ce.seq != ++seq || cr.length != sizeof(RECORD)) bad++;
+            if (ce.op == CHGINSERT && r->i != inserts++) bad++;
+            if (ce.op == CHGDELETE && (r->i != 0 || deletes++ > 0)) bad++;
+            if (ce.seq == 50) half = reader.getPos();
+        }
+        if (seq != 101 || inserts != 100 || deletes != 1 || deleted != 1 || bad != 0)
+            cout << "Err0r.   change log holds " << seq << " entries, "
+                 << bad << " wrong" << endl;
+
+        // more inserts show up at the reader that reached the end, and
+        // a reader started at the saved position sees only what followed
+        iScan = new InsertFileScan("dummy.10", status);
+        if (status != OK) error.print(status);
+        for (i = 100; i < 105; i++)
+        {
+            rec1.i = i;
+            if ((status = iScan->insertRecord(dbrec1, newRid)) != OK) error.print(status);
+        }
+        delete iScan;
+        for (j = 0; reader.next(ce, cr) == OK; j++)
+            if (ce.seq != 102 + j || ((RECORD*) cr.data)->i != 100 + j) bad++;
+        ChangeReader resumed("dummy.10", half, status);
+        if (status != OK) error.print(status);
+        for (i = 0; resumed.next(ce, cr) == OK; i++)
+            if (ce.seq != 51 + i) bad++;
+        if (j != 5 || i != 56 || bad != 0)
+            cout << "Err0r.   change log readers saw " << j << " and " << i
+                 << " new entries" << endl;
+    }
+    if ((status = destroyHeapFile("dummy.10")) != OK) error.print(status);
+    if (access("dummy.10.chg", F_OK) == 0)
+        cout << "Err0r.   change log of dummy.10 left behind" << endl;
+
+    // a repeated scan is answered from the cache; after a delete and
+    // some inserts only the pages they touched are read again
+    cout << endl << "cache scans of dummy.12" << endl;
+    destroyHeapFile("dummy.12");
+    if ((status = createHeapFile("dummy.12")) != OK) error.print(status);
+    {
+        iScan = new InsertFileScan("dummy.12", status);
+        if (status != OK) error.print(status);
+        memset(&rec1, 0, sizeof rec1);
+        dbrec1.data = &rec1;
+        dbrec1.length = sizeof rec1;
+        for (i = 0; i < 1000; i++)
+        {
+            rec1.i = i;
+            sprintf(rec1.s, "cached %05d", i);
+            if ((status = iScan->insertRecord(dbrec1, newRid)) != OK) error.print(status);
+        }
+        delete iScan;
+
+        // what a plain scan returns
+        auto plainScan = [&](int val) {
+            vector<RID> rids;
+            HeapFileScan scan("dummy.12", status);
+            if (status == OK &&
+                scan.startScan(0, sizeof(int), INTEGER, (char*) &val, GTE) == OK)
+                while (scan.scanNext(rec2Rid) == OK)
+                    rids.push_back(rec2Rid);
+            return rids;
+        };
+        auto sameRids = [](const vector<RID> & a, const vector<RID> & b) {
+            if (a.size() != b.size()) return false;
+            for (unsigned k = 0; k < a.size(); k++)
+                if (a[k].pageNo != b[k].pageNo || a[k].slotNo != b[k].slotNo)
+                    return false;
+            return true;
+        };
+
+        ScanResult res;
+        ScanCacheStats before = getScanCacheStats(), after;
+        int filterVal = 900;
+        if ((status = cachedScan("dummy.12", 0, sizeof(int), INTEGER,
+                                 (char*) &filterVal, GTE, res)) != OK)
+            error.print(status);
+        int bad = 0;
+        for (i = 0; i < res.size(); i++)
+            if (((RECORD*) res.record(i).data)->i != 900 + i) bad++;
+        if (res.size() != 100 || bad != 0 || !sameRids(res.rids, plainScan(filterVal)))
+            cout << "Err0r.   cached scan returned " << res.size() << " records" << endl;
+
+        after = getScanCacheStats();
+        int pagesRead = after.pagesRead;
+        if (after.misses != before.misses + 1)
+            cout << "Err0r.   first cached scan was not a miss" << endl;
+        if ((status = cachedScan("dummy.12", 0, sizeof(int), INTEGER,
+                                 (char*) &filterVal, GTE, res)) != OK)
+            error.print(status);
+        after = getScanCacheStats();
+        if (after.hits != before.hits + 1 || after.pagesRead != pagesRead || res.size() != 100)
+            cout << "Err0r.   repeated cached scan was not a hit" << endl;
+
+        // delete record 950, insert 10 more
+        int delVal = 950;
+        scan1 = new HeapFileScan("dummy.12", status);
+        scan1->startScan(0, sizeof(int), INTEGER, (char*) &delVal, EQ);
+        while (scan1->scanNext(rec2Rid) == OK)
+            if ((status = scan1->deleteRecord()) != OK) error.print(status);
+        delete scan1;
+        iScan = new InsertFileScan("dummy.12", status);
+        for (i = 2000; i < 2010; i++)
+        {
+            rec1.i = i;
+            if ((status = iScan->insertRecord(dbrec1, newRid)) != OK) error.print(status);
+        }
+        delete iScan;
+        iScan = NULL;
+
+        if ((status = cachedScan("dummy.12", 0, sizeof(int), INTEGER,
+                                 (char*) &filterVal, GTE, res)) != OK)
+            error.print(status);
+        after = getScanCacheStats();
+        if (after.updates != before.updates + 1 || after.pagesRead - pagesRead > 3)
+            cout << "Err0r.   cached scan read " << after.pagesRead - pagesRead
+                 << " pages after a delete and 10 inserts" << endl;
+        if (res.size() != 109 || !sameRids(res.rids, plainScan(filterVal)))
+            cout << "Err0r.   updated cached scan returned " << res.size()
+                 << " records" << endl;
+    }
+    if ((status = destroyHeapFile("dummy.12")) != OK) error.print(status);
+
+    // a limited scan stops where it has enough records; top-K returns
+    // the same records whatever the number of threads
+    cout << endl << "limit scans and select the top 10 of dummy.13" << endl;
+    destroyHeapFile("dummy.13");
+    if ((status = createHeapFile("dummy.13")) != OK) error.print(status);
+    {
+        iScan = new InsertFileScan("dummy.13", status);
+        if (status != OK) error.print(status);
+        memset(&rec1, 0, sizeof rec1);
+        dbrec1.data = &rec1;
+        dbrec1.length = sizeof rec1;
+        for (i = 0; i < 2000; i++)
+        {
+            rec1.i = (i * 7919) % 2000;
+            rec1.f = i % 100;
+            sprintf(rec1.s, "top %05d", rec1.i);
+            if ((status = iScan->insertRecord(dbrec1, newRid)) != OK) error.print(status);
+        }
+        delete iScan;
+        iScan = NULL;
+
+        scan1 = new HeapFileScan("dummy.13", status);
+        if (status != OK) error.print(status);
+        scan1->setLimit(5);
+        int accesses = bufMgr->getBufStats().accesses;
+        scan1->startScan(0, 0, STRING, NULL, EQ);
+        for (j = 0; scan1->scanNext(rec2Rid) == OK; j++) ;
+        if (j != 5 || bufMgr->getBufStats().accesses != accesses ||
+            scan1->scanNext(rec2Rid) != FILEEOF)
+            cout << "Err0r.   scan limited to 5 returned " << j << " records and made "
+                 << bufMgr->getBufStats().accesses - accesses << " page accesses" << endl;
+        scan1->startScan(0, 0, STRING, NULL, EQ);
+        for (j = 0; scan1->scanNext(rec2Rid) == OK; j++) ;
+        if (j != 5) cout << "Err0r.   restarted limited scan returned " << j << endl;
+        scan1->setLimit(0);
+        scan1->startScan(0, 0, STRING, NULL, EQ);
+        for (j = 0; scan1->scanNext(rec2Rid) == OK; j++) ;
+        if (j != 2000) cout << "Err0r.   unlimited scan returned " << j << endl;
+
+        // compiled and packed scans keep to the limit too, and a
+        // synchronized JitScan joins scan1 midway and wraps around
+        int lim = 1000;
+        vector<ScanPred> preds(1);
+        preds[0].offset = 0;
+        preds[0].length = sizeof(int);
+        preds[0].type = INTEGER;
+        preds[0].op = LT;
+        preds[0].filter = (char*) &lim;
+        JitScan* jScan = new JitScan("dummy.13", status);
+        if (status != OK) error.print(status);
+        jScan->useJit(false);
+        jScan->setLimit(5);
+        jScan->startScan(preds);
+        for (j = 0; jScan->scanNext(rec2Rid) == OK; j++) ;
+        if (j != 5) cout << "Err0r.   JitScan limited to 5 returned " << j << endl;
+
+        scan1->syncScan(true);
+        scan1->startScan(0, 0, STRING, NULL, EQ);
+        for (j = 0; j < 600 && scan1->scanNext(rec2Rid) == OK; j++) ;
+        jScan->setLimit(0);
+        jScan->syncScan(true);
+        jScan->startScan(preds);
+        vector<char> seen(lim, 0);
+        for (j = 0; jScan->scanNext(rec2Rid) == OK; j++)
+        {
+            jScan->getRecord(dbrec2);
+            seen[((RECORD*) dbrec2.data)->i]++;
+        }
+        if (j != lim || count(seen.begin(), seen.end(), 1) != lim)
+            cout << "Err0r.   synchronized JitScan returned " << j << " records" << endl;
+        delete jScan;
+        delete scan1;
+        scan1 = NULL;
+
+        if ((status = createPackedColumn("dummy.13", 0, "dummy.13.i")) != OK)
+            error.print(status);
+        pScan = new PackedIntScan("dummy.13", "dummy.13.i", status);
+        if (status != OK) error.print(status);
+        pScan->setLimit(5);
+        pScan->startScan(0, sizeof(int), INTEGER, (char*) &lim, LT);
+        if (!pScan->usingColumn())
+            cout << "Err0r.   packed column was not used by the scan" << endl;
+        for (j = 0; pScan->scanNext(rec2Rid) == OK; j++) ;
+        if (j != 5) cout << "Err0r.   packed scan limited to 5 returned " << j << endl;
+        delete pScan;
+        if ((status = destroyPackedColumn("dummy.13.i")) != OK) error.print(status);
+
+        ScanResult top1, top4;
+        if ((status = topK("dummy.13", 0, sizeof(int), INTEGER, 10, true, 1, top1)) != OK)
+            error.print(status);
+        if ((status = topK("dummy.13", 0, sizeof(int), INTEGER, 10, true, 4, top4)) != OK)
+            error.print(status);
+        int bad = 0;
+        for (i = 0; i < top4.size(); i++)
+            if (((RECORD*) top4.record(i).data)->i != 1999 - i ||
+                top1.rids[i].pageNo != top4.rids[i].pageNo ||
+                top1.rids[i].slotNo != top4.rids[i].slotNo)
+                bad++;
+        if (top1.size() != 10 || top4.size() != 10 || bad != 0)
+            cout << "Err0r.   top 10 of dummy.13 wrong in " << bad << " places" << endl;
+
+        // ties are broken in file order
+        if ((status = topK("dummy.13", sizeof(int), sizeof(float), FLOAT, 3, false, 4, top4)) != OK)
+            error.print(status);
+        for (i = 0, bad = 0; i < top4.size(); i++)
+            if (((RECORD*) top4.record(i).data)->f != 0 ||
+                ((RECORD*) top4.record(i).data)->i != (i * 100 * 7919) % 2000)
+                bad++;
+        if (top4.size() != 3 || bad != 0)
+            cout << "Err0r.   bottom 3 of dummy.13 wrong in " << bad << " places" << endl;
+        if (topK("dummy.13", 0, sizeof(int), INTEGER, 0, true, 4, top4) != BADSCANPARM)
+            cout << "Err0r.   top 0 accepted" << endl;
+    }
+    if ((status = destroyHeapFile("dummy.13")) != OK) error.print(status);
+
+    // IN predicates over each type, with duplicate and missing values
+    cout << endl << "scan dummy.14 for IN lists" << endl;
+    destroyHeapFile("dummy.14");
+    if ((status = createHeapFile("dummy.14")) != OK) error.print(status);
+    {
+        iScan = new InsertFileScan("dummy.14", status);
+        if (status != OK) error.print(status);
+        memset(&rec1, 0, sizeof rec1);
+        dbrec1.data = &rec1;
+        dbrec1.length = sizeof rec1;
+        for (i = 0; i < 3000; i++)
+        {
+            rec1.i = i;
+            rec1.f = i - 1500;
+            sprintf(rec1.s, "in %05d", i);
+            if ((status = iScan->insertRecord(dbrec1, newRid)) != OK) error.print(status);
+        }
+        delete iScan;
+        iScan = NULL;
+
+        vector<int> ints;
+        for (i = 0; i < 1000; i++) ints.push_back(3 * i);
+        for (i = 0; i < 100; i++) ints.push_back(6 * i);		// again
+        for (i = 0; i < 100; i++) ints.push_back(-1 - i);	// absent
+        float floats[3] = { -0.0f, 2.0f, 1e9f };
+        char strs[3][64];
+        memset(strs, 0, sizeof strs);
+        strcpy(strs[0], "in 00007");
+        strcpy(strs[1], "in 02999");
+        strcpy(strs[2], "in 3");
+
+        scan1 = new HeapFileScan("dummy.14", status);
+        if (status != OK) error.print(status);
+        int bad = 0;
+        if ((status = scan1->startScan(0, sizeof(int), INTEGER, (char*) &ints[0],
+                                       ints.size())) != OK)
+            error.print(status);
+        for (j = 0; scan1->scanNext(rec2Rid) == OK; j++)
+        {
+            scan1->getRecord(dbrec2);
+            if (((RECORD*) dbrec2.data)->i % 3 != 0) bad++;
+        }
+        if (j != 1000 || bad != 0)
+            cout << "Err0r.   IN list of 1200 integers matched " << j << " records" << endl;
+
+        scan1->endScan();
+        if ((status = scan1->startScan(sizeof(int), sizeof(float), FLOAT,
+                                       (char*) floats, 3)) != OK)
+            error.print(status);
+        for (j = 0; scan1->scanNext(rec2Rid) == OK; j++) ;
+        if (j != 2) cout << "Err0r.   IN list of floats matched " << j << " records" << endl;
+
+        scan1->endScan();
+        if ((status = scan1->startScan(2 * sizeof(int), 64, STRING,
+                                       (char*) strs, 3)) != OK)
+            error.print(status);
+        for (j = 0; scan1->scanNext(rec2Rid) == OK; j++) ;
+        if (j != 2) cout << "Err0r.   IN list of strings matched " << j << " records" << endl;
+
+        if (scan1->startScan(0, sizeof(int), INTEGER, (char*) &ints[0], 0) != BADSCANPARM ||
+            scan1->startScan(0, sizeof(int), INTEGER, (char*) &ints[0], IN) != BADSCANPARM)
+            cout << "Err0r.   IN scan without values accepted" << endl;
+        delete scan1;
+        scan1 = NULL;
+    }
+    if ((status = destroyHeapFile("dummy.14")) != OK) error.print(status);
+
+    // pattern operators agree with a plain C evaluation of each record
+    cout << endl << "scan dummy.15 for string patterns" << endl;
+    destroyHeapFile("dummy.15");
+    if ((status = createHeapFile("dummy.15")) != OK) error.print(status);
+    {
+        const char* verbs[3] = { "GET", "PUT", "DELETE" };
+        iScan = new InsertFileScan("dummy.15", status);
+        if (status != OK) error.print(status);
+        memset(&rec1, 0, sizeof rec1);
+        dbrec1.data = &rec1;
+        dbrec1.length = sizeof rec1;
+        for (i = 0; i < 2000; i++)
+        {
+            memset(rec1.s, 0, sizeof rec1.s);
+            rec1.i = i;
+            sprintf(rec1.s, "host%02d %s /api/v%d/items/%d %d", i % 17, verbs[i % 3],
+                    i % 4, i, i % 10 == 0 ? 404 : 200);
+            if ((status = iScan->insertRecord(dbrec1, newRid)) != OK) error.print(status);
+        }
+        delete iScan;
+        iScan = NULL;
+
+        struct { Operator op; const char* pat; } cases[] = {
+            { PREFIX, "host03 " }, { SUFFIX, " 404" }, { SUBSTR, "/v2/items/1" },
+            { SUBSTR, "" }, { LIKE, "host1_ PUT %404" }, { LIKE, "%DELETE%/v3/%" },
+            { LIKE, "host1_ GET /api/v_/items/12 2__" }, { LIKE, "%" }, { LIKE, "%1_0 %" },
+        };
+        scan1 = new HeapFileScan("dummy.15", status);
+        if (status != OK) error.print(status);
+        for (unsigned c = 0; c < sizeof cases / sizeof cases[0]; c++)
+        {
+            char pat[64];
+            memset(pat, 0, sizeof pat);
+            strcpy(pat, cases[c].pat);
+            scan1->endScan();
+            if ((status = scan1->startScan(2 * sizeof(int), 64, STRING, pat,
+                                           cases[c].op)) != OK)
+                error.print(status);
+            int got = 0, want = 0;
+            while (scan1->scanNext(rec2Rid) == OK) got++;
+            for (i = 0; i < 2000; i++)
+            {
+                char s[64], v[16];
+                sprintf(s, "host%02d %s /api/v%d/items/%d %d", i % 17, verbs[i % 3],
+                        i % 4, i, i % 10 == 0 ? 404 : 200);
+                string str(s), p(cases[c].pat);
+                sprintf(v, "%d", i);
+                bool hit = false;
+                switch (c) {
+                case 0: hit = str.compare(0, p.size(), p) == 0; break;
+                case 1: hit = i % 10 == 0; break;
+                case 2: hit = str.find(p) != string::npos; break;
+                case 3: case 7: hit = true; break;
+                case 4: hit = i % 17 >= 10 && i % 3 == 1 && i % 10 == 0; break;
+                case 5: hit = i % 3 == 2 && i % 4 == 3; break;
+                case 6: hit = i == 12; break;
+                case 8: hit = strlen(v) >= 3 && v[strlen(v) - 1] == '0' &&
+                              v[strlen(v) - 3] == '1'; break;
+                }
+                if (hit) want++;
+            }
+            if (got != want)
+                cout << "Err0r.   pattern \"" << cases[c].pat << "\" matched " << got
+                     << " records, not " << want << endl;
+        }
+        if (scan1->startScan(0, sizeof(int), INTEGER, "1", PREFIX) != BADSCANPARM)
+            cout << "Err0r.   PREFIX accepted on an INTEGER" << endl;
+        delete scan1;
+        scan1 = NULL;
+    }
+    if ((status = destroyHeapFile("dummy.15")) != OK) error.print(status);
+
+    // a compiled scan returns what interpreting the same predicate does,
+    // and what a plain scan filtering on one comparison and testing the
+    // others on each record returns
+    cout << endl << "compiled, interpreted and plain scans of dummy.16" << endl;
+    destroyHeapFile("dummy.16");
+    if ((status = createHeapFile("dummy.16")) != OK) error.print(status);
+    {
+        iScan = new InsertFileScan("dummy.16", status);
+        if (status != OK) error.print(status);
+        memset(&rec1, 0, sizeof rec1);
+        dbrec1.data = &rec1;
+        dbrec1.length = sizeof rec1;
+        for (i = 0; i < 3000; i++)
+        {
+            rec1.i = i;
+            rec1.f = i * 0.5;
+            sprintf(rec1.s, "jit %05d", (i * 7) % 3000);
+            if ((status = iScan->insertRecord(dbrec1, newRid)) != OK) error.print(status);
+        }
+        delete iScan;
+        iScan = NULL;
+
+        int lo = 500, hi = 2500;
+        float skip = 600.0;
+        char str[64];
+        memset(str, 0, sizeof str);
+        strcpy(str, "jit 01000");
+        ScanPred preds[4] = {
+            { 0, sizeof(int), INTEGER, GTE, (char*) &lo },
+            { 0, sizeof(int), INTEGER, LT, (char*) &hi },
+            { sizeof(int), sizeof(float), FLOAT, NE, (char*) &skip },
+            { 2 * sizeof(int), 64, STRING, GT, str },
+        };
+        vector<ScanPred> pv(preds, preds + 4);
+        int want = 0;
+        for (i = 500; i < 2500; i++)
+            if (i != 1200 && (i * 7) % 3000 > 1000) want++;
+
+        for (int round = 0; round < 3; round++)
+        {
+            JitScan jscan("dummy.16", status);
+            if (status != OK) error.print(status);
+            jscan.useJit(round != 1);
+            if (round == 2) hi = 1000;		// same shape, other values
+            if ((status = jscan.startScan(pv)) != OK) error.print(status);
+            if (jscan.compiled() != (round != 1))
+                cout << "Err0r.   scan " << round << " compiled: " << jscan.compiled() << endl;
+            int bad = 0;
+            for (j = 0; jscan.scanNext(rec2Rid) == OK; j++)
+            {
+                jscan.getRecord(dbrec2);
+                RECORD* r = (RECORD*) dbrec2.data;
+                if (r->i < lo || r->i >= hi || r->f == skip || strcmp(r->s, str) <= 0)
+                    bad++;
+            }
+            if (round == 2)
+                for (want = 0, i = 500; i < 1000; i++)
+                    if ((i * 7) % 3000 > 1000) want++;
+            if (j != want || bad != 0)
+                cout << "Err0r.   scan " << round << " returned " << j << " records, not "
+                     << want << ", " << bad << " wrong" << endl;
+        }
+
+        // no predicates select every record
+        for (int round = 0; round < 2; round++)
+        {
+            JitScan jscan("dummy.16", status);
+            if (status != OK) error.print(status);
+            jscan.useJit(round == 0);
+            if ((status = jscan.startScan(vector<ScanPred>())) != OK) error.print(status);
+            for (j = 0; jscan.scanNext(rec2Rid) == OK; j++) ;
+            if (j != 3000)
+                cout << "Err0r.   scan without predicates returned " << j << " records" << endl;
+        }
+
+        hi = 2500;
+        for (want = 0, i = 500; i < 2500; i++)
+            if (i != 1200 && (i * 7) % 3000 > 1000) want++;
+        scan1 = new HeapFileScan("dummy.16", status);
+        if (status != OK) error.print(status);
+        if ((status = scan1->startScan(0, sizeof(int), INTEGER, (char*) &lo, GTE)) != OK)
+            error.print(status);
+        j = 0;
+        while (scan1->scanNext(rec2Rid) == OK)
+        {
+            scan1->getRecord(dbrec2);
+            RECORD* r = (RECORD*) dbrec2.data;
+            if (r->i < hi && r->f != skip && strncmp(r->s, str, 64) > 0) j++;
+        }
+        delete scan1;
+        scan1 = NULL;
+        if (j != want)
+            cout << "Err0r.   plain scan returned " << j << " records, not " << want << endl;
+    }
+    if ((status = destroyHeapFile("dummy.16")) != OK) error.print(status);
+
+    // a morsel scan sees every matching record once, whatever the
+    // parallelism, and idle workers steal the tasks of a busy one
+    cout << endl << "morsel scans of dummy.17" << endl;
+    destroyHeapFile("dummy.17");
+    if ((status = createHeapFile("dummy.17")) != OK) error.print(status);
+    {
+        iScan = new InsertFileScan("dummy.17", status);
+        if (status != OK) error.print(status);
+        memset(&rec1, 0, sizeof rec1);
+        dbrec1.data = &rec1;
+        dbrec1.length = sizeof rec1;
+        for (i = 0; i < 3000; i++)
+        {
+            rec1.i = i;
+            rec1.f = i;
+            sprintf(rec1.s, "morsel %05d", i);
+            if ((status = iScan->insertRecord(dbrec1, newRid)) != OK) error.print(status);
+        }
+        delete iScan;
+        iScan = NULL;
+
+        TaskPool pool(4);
+        int lo = 1000;
+        for (int dop = 4; dop >= 1; dop -= 3)
+        {
+            // count, sum and group by i % 10 with a partial result per
+            // worker; the first records cost far more than the rest
+            pool.setParallelism(dop);
+            vector<long long> sums(pool.size(), 0);
+            vector<vector<int> > groups(pool.size(), vector<int>(10, 0));
+            vector<int> counts(pool.size(), 0);
+            vector<int> seen(3000, 0);
+            status = morselScan(pool, "dummy.17", 0, sizeof(int), INTEGER,
+                                (char*) &lo, GTE,
+                                [&](const int w, const RID & rid, const Record & rec) {
+                RECORD* r = (RECORD*) rec.data;
+                if (r->i < 1200) usleep(100);
+                sums[w] += r->i;
+                groups[w][r->i % 10]++;
+                counts[w]++;
+                seen[r->i]++;
+            });
+            if (status != OK) error.print(status);
+            long long sum = 0;
+            int count = 0, used = 0, bad = 0;
+            for (i = 0; i < pool.size(); i++)
+            {
+                sum += sums[i];
+                count += counts[i];
+                if (counts[i] > 0) used++;
+            }
+            for (j = 0; j < 10; j++)
+            {
+                int g = 0;
+                for (i = 0; i < pool.size(); i++) g += groups[i][j];
+                if (g != 200) bad++;
+            }
+            for (i = 0; i < 3000; i++)
+                if (seen[i] != (i >= lo ? 1 : 0)) bad++;
+            if (count != 2000 || sum != 1999LL * 2000 / 2 + 1000LL * 2000 || bad != 0)
+                cout << "Err0r.   parallelism " << dop << ": " << count
+                     << " records, sum " << sum << ", " << bad << " wrong" << endl;
+            if (dop == 1 && used != 1)
+                cout << "Err0r.   " << used << " workers used at parallelism 1" << endl;
+        }
+
+        // the first task of worker 1 waits for all the others, so the
+        // task behind it must be stolen
+        pool.setParallelism(4);
+        atomic<int> finished(0);
+        vector<int> ranOn(8, -1);
+        vector<function<void(const int)> > tasks;
+        for (i = 0; i < 8; i++)
+            tasks.push_back([&, i](const int w) {
+                for (int t = 0; i == 2 && finished < 7 && t < 5000; t++)
+                    usleep(1000);
+                ranOn[i] = w;
+                finished++;
+            });
+        int steals = pool.getSteals();
+        pool.run(tasks);
+        if (finished != 8 || ranOn[2] == -1 || ranOn[3] == 1 || pool.getSteals() == steals)
+            cout << "Err0r.   task 3 ran on worker " << ranOn[3] << ", "
+                 << pool.getSteals() - steals << " steals" << endl;
+    }
+    if ((status = destroyHeapFile("dummy.17")) != OK) error.print(status);
+
+    // operators share one memory budget with the buffer pool; a refused
+    // reservation asks the biggest holders to spill
+    cout << endl << "reserve memory and borrow frames while scanning dummy.18" << endl;
+    destroyHeapFile("dummy.18");
+    if ((status = createHeapFile("dummy.18")) != OK) error.print(status);
+    {
+        iScan = new InsertFileScan("dummy.18", status);
+        if (status != OK) error.print(status);
+        memset(&rec1, 0, sizeof rec1);
+        dbrec1.data = &rec1;
+        dbrec1.length = sizeof rec1;
+        for (i = 0; i < 1000; i++)
+        {
+            rec1.i = i;
+            if ((status = iScan->insertRecord(dbrec1, newRid)) != OK) error.print(status);
+        }
+        delete iScan;
+        iScan = NULL;
+
+        size_t pool = (size_t) bufMgr->getNumBufs() * PAGESIZE;
+        setMemoryBudget(pool + 1024 * 1024);
+        {
+            MemGrant g1, g2;
+            if (g1.reserve(600 * 1024) != OK || g2.reserve(600 * 1024) != INSUFMEM)
+                cout << "Err0r.   reservations beyond the budget were granted" << endl;
+            if (!g1.mustSpill() || g2.mustSpill())
+                cout << "Err0r.   the wrong grant was asked to spill" << endl;
+            g1.release(300 * 1024);
+            if (g1.mustSpill() || g2.reserve(600 * 1024) != OK)
+                cout << "Err0r.   memory released by a spill was not granted" << endl;
+            if (getMemoryStats().reserved < 900 * 1024)
+                cout << "Err0r.   " << getMemoryStats().reserved << " bytes reserved" << endl;
+        }
+        if (getMemoryStats().reserved > (size_t) SCANCACHESIZE)
+            cout << "Err0r.   grants were not given back" << endl;
+
+        // borrowed frames are out of the pool until returned; pages can
+        // still be read in the rest of it
+        {
+            MemGrant g;
+            if (g.borrowFrames(bufMgr->getNumBufs()) != BUFFEREXCEEDED ||
+                bufMgr->getBorrowed() != 0)
+                cout << "Err0r.   the whole pool was lent" << endl;
+            if ((status = g.borrowFrames(bufMgr->getNumBufs() / 4)) != OK) error.print(status);
+            for (unsigned k = 0; k < g.frames().size(); k++)
+                memset((void*) g.frames()[k], 0xa5, PAGESIZE);
+            scan1 = new HeapFileScan("dummy.18", status);
+            scan1->startScan(0, 0, STRING, NULL, EQ);
+            for (j = 0; scan1->scanNext(rec2Rid) == OK; j++)
+            {
+                scan1->getRecord(dbrec2);
+                if (((RECORD*) dbrec2.data)->i != j) break;
+            }
+            delete scan1;
+            scan1 = NULL;
+            if (j != 1000 || getMemoryStats().framesLent != bufMgr->getNumBufs() / 4)
+                cout << "Err0r.   scan with frames lent returned " << j << " records" << endl;
+        }
+        if (bufMgr->getBorrowed() != 0 || getMemoryStats().framesLent != 0)
+            cout << "Err0r.   borrowed frames were not returned" << endl;
+
+        // with no memory to spare the scan cache keeps nothing
+        setMemoryBudget(pool);
+        ScanResult res;
+        int filterVal = 500;
+        ScanCacheStats before = getScanCacheStats();
+        for (int round = 0; round < 2; round++)
+            if ((status = cachedScan("dummy.18", 0, sizeof(int), INTEGER,
+                                     (char*) &filterVal, GTE, res)) != OK)
+                error.print(status);
+        if (res.size() != 500 || getScanCacheStats().hits != before.hits ||
+            getMemoryStats().reserved != 0)
+            cout << "Err0r.   scan cache held " << getMemoryStats().reserved
+                 << " bytes over the budget" << endl;
+        setMemoryBudget(MEMBUDGET);
+    }
+    if ((status = destroyHeapFile("dummy.18")) != OK) error.print(status);
+
+    // deleting the odd records a page at a time leaves the pages as
+    // deleting them one by one does
+    cout << endl << "delete the odd records of dummy.19 with deleteWhere" << endl;
+    {
+        auto build = [&](const string & name, const int flags) {
+            destroyHeapFile(name);
+            if ((status = createHeapFile(name, flags)) != OK) error.print(status);
+            iScan = new InsertFileScan(name, status);
+            if (status != OK) error.print(status);
+            memset(&rec1, 0, sizeof rec1);
+            for (i = 0; i < 4000; i++)
+            {
+                rec1.i = i;
+                rec1.f = i;
+                sprintf(rec1.s, "delete %05d", i);
+                // vary the length so records move by different amounts
+                dbrec1.data = &rec1;
+                dbrec1.length = sizeof rec1 - (i % 5) * 4;
+                if ((status = iScan->insertRecord(dbrec1, newRid)) != OK) error.print(status);
+            }
+            delete iScan;
+            iScan = NULL;
+        };
+        // the rids and i fields of the records left, the free space of
+        // the pages, then the rids of 500 more records
+        auto layout = [&](const string & name, vector<int> & out) {
+            scan1 = new HeapFileScan(name, status);
+            scan1->startScan(0, 0, STRING, NULL, EQ);
+            while (scan1->scanNext(rec2Rid) == OK)
+            {
+                scan1->getRecord(dbrec2);
+                out.push_back(rec2Rid.pageNo);
+                out.push_back(rec2Rid.slotNo);
+                out.push_back(((RECORD*) dbrec2.data)->i);
+            }
+            out.push_back(scan1->getRecCnt());
+            delete scan1;
+            scan1 = NULL;
+            PageSpace(name, status).freeSpace(out);
+            iScan = new InsertFileScan(name, status);
+            dbrec1.data = &rec1;
+            dbrec1.length = sizeof rec1;
+            for (i = 0; i < 500; i++)
+            {
+                rec1.i = 10000 + i;
+                iScan->insertRecord(dbrec1, newRid);
+                out.push_back(newRid.pageNo);
+                out.push_back(newRid.slotNo);
+            }
+            delete iScan;
+            iScan = NULL;
+        };
+        auto odd = [](const Record & rec) { return ((RECORD*) rec.data)->i % 2 != 0; };
+
+        for (int flags = 0; flags <= PAGE_ALIGNED; flags += PAGE_ALIGNED)
+        {
+            // one by one
+            vector<int> want, got;
+            int above = 1000;
+            build("dummy.19", flags);
+            scan1 = new HeapFileScan("dummy.19", status);
+            scan1->startScan(0, sizeof(int), INTEGER, (char*) &above, GTE);
+            for (j = 0; scan1->scanNext(rec2Rid) == OK; )
+            {
+                scan1->getRecord(dbrec2);
+                if (odd(dbrec2))
+                {
+                    if ((status = scan1->deleteRecord()) != OK) error.print(status);
+                    j++;
+                }
+            }
+            delete scan1;
+            scan1 = NULL;
+            layout("dummy.19", want);
+            if ((status = destroyHeapFile("dummy.19")) != OK) error.print(status);
+
+            // a page at a time, by one thread and by four
+            for (int threads = 1; threads <= 4; threads += 3)
+            {
+                build("dummy.19", flags);
+                scan1 = new HeapFileScan("dummy.19", status);
+                scan1->startScan(0, sizeof(int), INTEGER, (char*) &above, GTE);
+                int deleted;
+                if ((status = scan1->deleteWhere(deleted, threads, odd)) != OK)
+                    error.print(status);
+                if (deleted != j || scan1->scanNext(rec2Rid) != OK)
+                    cout << "Err0r.   deleteWhere deleted " << deleted << " records, not "
+                         << j << endl;
+                delete scan1;
+                scan1 = NULL;
+                got.clear();
+                layout("dummy.19", got);
+                if (got != want)
+                    cout << "Err0r.   pages differ after deleteWhere with " << threads
+                         << " threads, flags " << flags << endl;
+                if ((status = destroyHeapFile("dummy.19")) != OK) error.print(status);
+            }
+        }
+    }
+
+    // deleteWhere deletes what the scan selects, also when a compiled
+    // or a packed scan does the selecting
+    cout << endl << "delete with the predicates of a JitScan and a PackedIntScan" << endl;
+    destroyHeapFile("dummy.19");
+    if ((status = createHeapFile("dummy.19")) != OK) error.print(status);
+    {
+        iScan = new InsertFileScan("dummy.19", status);
+        if (status != OK) error.print(status);
+        memset(&rec1, 0, sizeof rec1);
+        dbrec1.data = &rec1;
+        dbrec1.length = sizeof rec1;
+        for (i = 0; i < 100; i++)
+        {
+            rec1.i = i;
+            if ((status = iScan->insertRecord(dbrec1, newRid)) != OK) error.print(status);
+        }
+        delete iScan;
+        iScan = NULL;
+
+        int lim = 5, deleted;
+        vector<ScanPred> preds(1);
+        preds[0].offset = 0;
+        preds[0].length = sizeof(int);
+        preds[0].type = INTEGER;
+        preds[0].op = LT;
+        preds[0].filter = (char*) &lim;
+        JitScan* jScan = new JitScan("dummy.19", status);
+        if (status != OK) error.print(status);
+        if ((status = jScan->startScan(preds)) != OK) error.print(status);
+        if ((status = jScan->deleteWhere(deleted)) != OK) error.print(status);
+        if (deleted != 5 || jScan->getRecCnt() != 95)
+            cout << "Err0r.   JitScan deleteWhere deleted " << deleted << " records, "
+                 << jScan->getRecCnt() << " left" << endl;
+        delete jScan;
+
+        lim = 20;
+        if ((status = createPackedColumn("dummy.19", 0, "dummy.19.i")) != OK)
+            error.print(status);
+        pScan = new PackedIntScan("dummy.19", "dummy.19.i", status);
+        if (status != OK) error.print(status);
+        pScan->startScan(0, sizeof(int), INTEGER, (char*) &lim, LT);
+        if ((status = pScan->deleteWhere(deleted)) != OK) error.print(status);
+        if (deleted != 15 || pScan->getRecCnt() != 80)
+            cout << "Err0r.   packed deleteWhere deleted " << deleted << " records, "
+                 << pScan->getRecCnt() << " left" << endl;
+        delete pScan;
+        if ((status = destroyPackedColumn("dummy.19.i")) != OK) error.print(status);
+
+        scan1 = new HeapFileScan("dummy.19", status);
+        scan1->startScan(0, 0, STRING, NULL, EQ);
+        for (j = 0; scan1->scanNext(rec2Rid) == OK; j++)
+        {
+            scan1->getRecord(dbrec2);
+            if (((RECORD*) dbrec2.data)->i < lim)
+                cout << "Err0r.   record " << ((RECORD*) dbrec2.data)->i
+                     << " was not deleted" << endl;
+        }
+        if (j != 80) cout << "Err0r.   " << j << " records left, not 80" << endl;
+        delete scan1;
+        scan1 = NULL;
+    }
+    if ((status = destroyHeapFile("dummy.19")) != OK) error.print(status);
+
+    // frames of a closed file are reused before any page is evicted,
+    // and the sweeper keeps eviction victims ready while pages churn
+    cout << endl << "reuse freed frames and queue victims for dummy.20" << endl;
+    destroyHeapFile("dummy.20");
+    if ((status = createHeapFile("dummy.20")) != OK) error.print(status);
+    {
+        int sweeps = bufMgr->getBufStats().sweeps;
+        iScan = new InsertFileScan("dummy.20", status);
+        if (status != OK) error.print(status);
+        memset(&rec1, 0, sizeof rec1);
+        dbrec1.data = &rec1;
+        dbrec1.length = sizeof rec1;
+        for (i = 0; i < 3000; i++)
+        {
+            rec1.i = i;
+            if ((status = iScan->insertRecord(dbrec1, newRid)) != OK) error.print(status);
+        }
+        delete iScan;
+        iScan = NULL;
+
+        scan1 = new HeapFileScan("dummy.20", status);
+        scan1->startScan(0, 0, STRING, NULL, EQ);
+        for (j = 0; scan1->scanNext(rec2Rid) == OK; j++) ;
+        delete scan1;
+        scan1 = NULL;
+        // the sweeper has the latch when the scan leaves it alone
+        for (int t = 0; t < 1000 && bufMgr->getBufStats().sweeps == sweeps; t++)
+            usleep(1000);
+        if (j != 3000 || bufMgr->getBufStats().sweeps == sweeps ||
+            bufMgr->getQueuedVictims() == 0)
+            cout << "Err0r.   " << bufMgr->getBufStats().sweeps - sweeps
+                 << " sweeps, " << bufMgr->getQueuedVictims() << " victims queued" << endl;
+
+        // the file is closed, so its frames are free: 40 new pages fit
+        // without writing out any other
+        iScan = new InsertFileScan("dummy.20", status);
+        int writes = bufMgr->getBufStats().diskwrites;
+        for (i = 0; i < 500; i++)
+            if ((status = iScan->insertRecord(dbrec1, newRid)) != OK) error.print(status);
+        if (bufMgr->getBufStats().diskwrites != writes)
+            cout << "Err0r.   " << bufMgr->getBufStats().diskwrites - writes
+                 << " pages written while free frames were left" << endl;
+        delete iScan;
+        iScan = NULL;
+    }
+    if ((status = destroyHeapFile("dummy.20")) != OK) error.print(status);
+
+    // log from several threads at once; every line must reach the log
+    // file once the log is flushed
+    cout << endl << "log 4000 lines from 4 threads into dummy.log" << endl;
+    unlink("dummy.log");
+    if (!logOpen("dummy.log"))
+        cout << "Err0r.   could not open dummy.log" << endl;
+    logSetLevel(LLINFO);
+    {
+        vector<thread> loggers;
+        for (j = 0; j < 4; j++)
+            loggers.push_back(thread([j]() {
+                for (int k = 0; k < 1000; k++)
+                    LOGINFO("thread " << j << " line " << k);
+            }));
+        for (j = 0; j < 4; j++)
+            loggers[j].join();
+    }
+    LOGDEBUG("this line is filtered at runtime");
+    logFlush();
+    logSetLevel(LLWARN);
+    logOpen("");
+    {
+        FILE* logFile = fopen("dummy.log", "r");
+        char line[LOGLINESIZE];
+        int lines = 0;
+        while (logFile != NULL && fgets(line, sizeof line, logFile) != NULL)
+            lines++;
+        if (logFile != NULL) fclose(logFile);
+        cout << "dummy.log holds " << lines << " lines, " << logDropped()
+             << " dropped" << endl;
+        if (lines + logDropped() != 4000)
+            cout << "Err0r.   dummy.log should hold 4000 lines!" << endl;
+    }
+    unlink("dummy.log");
+
     delete bufMgr;
 
     cout << endl << "Done testing." << endl;
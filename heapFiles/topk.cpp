@@ -0,0 +1,193 @@
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include "topk.h"
+#include "error.h"
+
+// top-K selection implementation
+
+// a record among the best seen so far
+struct Candidate
+{
+  double	num;		// key of an INTEGER or FLOAT attribute
+  string	str;		// key of a STRING attribute
+  int		pageIdx;	// position of its page in the file
+  RID		rid;
+  string	data;		// the record
+};
+
+// orders candidates best first: by key, then in file order
+struct Better
+{
+  Datatype	type;
+  int		length;
+  bool		largest;
+
+  bool operator()(const Candidate & a, const Candidate & b) const
+  {
+    int c;
+    if (type == STRING)
+      c = strncmp(a.str.data(), b.str.data(), length);
+    else
+      c = a.num < b.num ? -1 : a.num > b.num ? 1 : 0;
+    if (c != 0) return largest ? c > 0 : c < 0;
+    if (a.pageIdx != b.pageIdx) return a.pageIdx < b.pageIdx;
+    return a.rid.slotNo < b.rid.slotNo;
+  }
+};
+
+// with Better as its ordering the top of the heap is the worst kept
+typedef priority_queue<Candidate, vector<Candidate>, Better> TopHeap;
+
+// a heap file opened for selection; hands its pages to the threads
+class TopKFile : public HeapFile
+{
+public:
+  TopKFile(const string & name, Status & status) : HeapFile(name, status) {}
+
+  File* file() const { return filePtr; }
+};
+
+struct TopKState
+{
+  File*			file;
+  const vector<int>*	pageNos;
+  atomic<int>		next;		// next page to take
+  int			offset;
+  int			k;
+  mutex			mtx;		// guards status
+  Status		status;
+};
+
+// keep the best k records of the pages taken in heap
+static void selector(TopKState* st, const Better better, TopHeap* heap)
+{
+  Status status = OK;
+  Candidate cand;
+  int p;
+
+  while (status == OK && (p = st->next++) < (int) st->pageNos->size())
+    {
+      Page* page;
+      RID rid, prevRid;
+      Record rec;
+      int pageNo = (*st->pageNos)[p];
+
+      if ((status = bufMgr->readPage(st->file, pageNo, page)) != OK) break;
+      cand.pageIdx = p;
+      status = page->firstRecord(rid);
+      while (status == OK)
+	{
+	  page->getRecord(rid, rec);
+	  if (rec.length >= st->offset + better.length)
+	    {
+	      const char* attr = (const char*) rec.data + st->offset;
+	      if (better.type == INTEGER)
+		{
+		  int i;
+		  memcpy(&i, attr, sizeof i);
+		  cand.num = i;
+		}
+	      else if (better.type == FLOAT)
+		{
+		  float f;
+		  memcpy(&f, attr, sizeof f);
+		  cand.num = f;
+		}
+	      else
+		cand.str.assign(attr, better.length);
+	      cand.rid = rid;
+
+	      // copy the record only if it makes the cut
+	      if ((int) heap->size() < st->k || better(cand, heap->top()))
+		{
+		  cand.data.assign((const char*) rec.data, rec.length);
+		  heap->push(cand);
+		  if ((int) heap->size() > st->k) heap->pop();
+		}
+	    }
+	  prevRid = rid;
+	  status = page->nextRecord(prevRid, rid);
+	}
+      status = bufMgr->unPinPage(st->file, pageNo, false);
+    }
+
+  if (status != OK)
+    {
+      lock_guard<mutex> lk(st->mtx);
+      st->status = status;
+      st->next = st->pageNos->size();	// stop the others
+    }
+}
+
+
+// Select the best k records with threads threads.
+
+const Status topK(const string & relName,
+                  const int offset,
+                  const int length,
+                  const Datatype type,
+                  const int k,
+                  const bool largest,
+                  const int threads,
+                  ScanResult & result)
+{
+  Status status;
+  vector<int> pageNos;
+  int i;
+
+  if (k < 1 || offset < 0 || length < 1 ||
+      (type != STRING && type != INTEGER && type != FLOAT) ||
+      (type == INTEGER && length != sizeof(int)) ||
+      (type == FLOAT && length != sizeof(float)))
+    return BADSCANPARM;
+
+  TopKFile hf(relName, status);
+  if (status != OK) return status;
+  if ((status = hf.getPageNos(pageNos)) != OK) return status;
+
+  Better better;
+  better.type = type;
+  better.length = length;
+  better.largest = largest;
+
+  TopKState st;
+  st.file = hf.file();
+  st.pageNos = &pageNos;
+  st.next = 0;
+  st.offset = offset;
+  st.k = k;
+  st.status = OK;
+
+  int n = threads < 1 ? 1 : threads;
+  vector<TopHeap> heaps(n, TopHeap(better));
+  vector<thread> selectors;
+  for (i = 0; i < n; i++)
+    selectors.push_back(thread(selector, &st, better, &heaps[i]));
+  for (i = 0; i < n; i++)
+    selectors[i].join();
+  if (st.status != OK) return st.status;
+
+  // merge the heaps of the threads
+  vector<Candidate> best;
+  for (i = 0; i < n; i++)
+    for (; !heaps[i].empty(); heaps[i].pop())
+      best.push_back(heaps[i].top());
+  sort(best.begin(), best.end(), better);
+  if ((int) best.size() > k) best.resize(k);
+
+  result.rids.clear();
+  result.offsets.clear();
+  result.data.clear();
+  for (unsigned j = 0; j < best.size(); j++)
+    {
+      result.rids.push_back(best[j].rid);
+      result.offsets.push_back(result.data.size());
+      result.data.insert(result.data.end(), best[j].data.begin(), best[j].data.end());
+    }
+  result.offsets.push_back(result.data.size());
+  return OK;
+}
@@ -0,0 +1,27 @@
+#ifndef TOPK_H
+#define TOPK_H
+
+#include "scancache.h"
+
+// Top-K selection.
+//
+// topK returns the k records of a relation with the largest (or the
+// smallest) value of a key attribute, best first; records with equal
+// keys come in file order.  Each thread takes pages of the relation in
+// turn and keeps the best k records it has seen in a bounded heap, so
+// memory is O(k) per thread and a record is copied only while it is
+// among the best so far.  The heaps of the threads are merged at the
+// end.  Records too short to hold the key are skipped.
+
+const int TOPKTHREADS = 4;		// default number of threads
+
+const Status topK(const string & relName,
+                  const int offset,
+                  const int length,
+                  const Datatype type,
+                  const int k,
+                  const bool largest,
+                  const int threads,
+                  ScanResult & result);
+
+#endif